@@ -206,7 +206,13 @@ void usage()
   fprintf(stderr," -r matchingThreshold   sets the radius R (refer to article) or matching threshold\n");
   fprintf(stderr," -c matchingNumber   sets the minimum cardinality (refer to article) or number of matches\n");
   fprintf(stderr," -uf updateFactor   sets the update factor for the update mechanism\n");
+  fprintf(stderr," -t numberOfThreads   sets the number of threads (1 by default)\n");
+  fprintf(stderr," -b blockSize   shares the samples among blocks of blockSize x blockSize pixels (1 by default)\n");
+  fprintf(stderr," -q format   stores the samples of color images on 16 bits: 565 or 555 (888 by default)\n");
   fprintf(stderr," --frameDiff   applies three-frame difference for quick ghost and shadow elimination\n");
+  fprintf(stderr," --moveToFront   keeps the samples of every pixel in the order of their last match\n");
+  fprintf(stderr," -load file   starts from the model saved in file instead of the first image\n");
+  fprintf(stderr," -save file   saves the model in file after the last image\n");
   fprintf(stderr,"\n");
   fprintf(stderr,"The output images are stored with the same name and path as");
   fprintf(stderr," the\ninput images but adding the suffix '_mask.png'.");
@@ -223,13 +229,27 @@ void usage()
 int main(int argc, char ** argv)
 {
   int X, Y, C, F, n;
+  int width = 0, height = 0, channels = 0;
   vibeModel_Sequential_t *model = NULL;
   uint8_t *segmentation_map = NULL;
-  int numberOfSamples = atoi(get_option_arg(&argc,&argv,"-s","20"));
-  int matchingThreshold = atoi(get_option_arg(&argc,&argv,"-r","20"));
-  int matchingNumber = atoi(get_option_arg(&argc,&argv,"-c","2"));
-  int updateFactor = atoi(get_option_arg(&argc,&argv,"-uf","16"));
+  /* The parameters given explicitly are applied to a loaded model, whose own values are kept otherwise. */
+  char *numberOfSamplesArg = get_option_arg(&argc,&argv,"-s",NULL);
+  char *matchingThresholdArg = get_option_arg(&argc,&argv,"-r",NULL);
+  char *matchingNumberArg = get_option_arg(&argc,&argv,"-c",NULL);
+  char *updateFactorArg = get_option_arg(&argc,&argv,"-uf",NULL);
+  int numberOfSamples = atoi(numberOfSamplesArg ? numberOfSamplesArg : "20");
+  int matchingThreshold = atoi(matchingThresholdArg ? matchingThresholdArg : "20");
+  int matchingNumber = atoi(matchingNumberArg ? matchingNumberArg : "2");
+  int updateFactor = atoi(updateFactorArg ? updateFactorArg : "16");
+  int numberOfThreads = atoi(get_option_arg(&argc,&argv,"-t","1"));
+  char *sampleBlockSizeArg = get_option_arg(&argc,&argv,"-b",NULL);
+  char *sampleFormatArg = get_option_arg(&argc,&argv,"-q",NULL);
+  int sampleBlockSize = atoi(sampleBlockSizeArg ? sampleBlockSizeArg : "1");
+  int sampleFormat = atoi(sampleFormatArg ? sampleFormatArg : "888");
   int frameDiff = get_option(&argc,&argv,"--frameDiff");
+  int moveToFront = get_option(&argc,&argv,"--moveToFront");
+  char *loadFile = get_option_arg(&argc,&argv,"-load",NULL);
+  char *saveFile = get_option_arg(&argc,&argv,"-save",NULL);
 
   /* Frame differencing variables*/
   vibeFrameDifference_t *fDmodel = NULL;
@@ -240,11 +260,15 @@ int main(int argc, char ** argv)
   if( argc < 3 ) usage();
 
   /* read input */
-  if( numberOfSamples < matchingNumber) error("Number of samples must be greater or equal than the matching number");
+  if( !loadFile && (numberOfSamples < matchingNumber) ) error("Number of samples must be greater or equal than the matching number");
   if( numberOfSamples <= 0 ) error("Number of samples must be greater than 0");
   if( matchingThreshold <= 0 ) error("Matching threshold must be greater than 0");
   if( matchingNumber <= 0 ) error("Matching number must be greater than 0");
   if( updateFactor <= 0 ) error("Update factor must be greater than 0");
+  if( numberOfThreads <= 0 ) error("Number of threads must be greater than 0");
+  if( sampleBlockSize <= 0 ) error("Block size must be greater than 0");
+  if( (sampleFormat != 888) && (sampleFormat != 565) && (sampleFormat != 555) ) error("Sample format must be 888, 565 or 555");
+  if( loadFile && (sampleBlockSizeArg || sampleFormatArg) ) error("The block size and the sample format are those of the loaded model");
   F = argc - 1;
 
   /* Start execution time tracking */
@@ -261,15 +285,44 @@ int main(int argc, char ** argv)
 
     if( !n )
     {
+      /* Grayscale, RGB or RGBA images (the alpha channel is ignored). */
+      if( (C != 1) && (C != 3) && (C != 4) ) error("Input images must have 1, 3 or 4 channels");
+      if( frameDiff && (C != 3) ) error("Frame difference needs RGB images");
+      width = X;
+      height = Y;
+      channels = C;
+
       /* Initialize ViBe model and set the parameters */
       model = (vibeModel_Sequential_t *)libvibeModel_Sequential_New();
       libvibeModel_Sequential_SetNumberOfSamples(model, numberOfSamples);
       libvibeModel_Sequential_SetMatchingThreshold(model, matchingThreshold);
       libvibeModel_Sequential_SetMatchingNumber(model, matchingNumber);
+      libvibeModel_Sequential_SetNumberOfThreads(model, numberOfThreads);
+      libvibeModel_Sequential_SetSampleBlockSize(model, sampleBlockSize);
+      if( moveToFront ) libvibeModel_Sequential_SetSampleOrdering(model, VIBE_ORDERING_MOVE_TO_FRONT);
+      if( C != 1 ) libvibeModel_Sequential_SetSampleFormat(model, (sampleFormat == 565) ? VIBE_SAMPLE_RGB565 : ((sampleFormat == 555) ? VIBE_SAMPLE_RGB555 : VIBE_SAMPLE_RGB888));
 
-      /* Allocates the model and initialize it with the first image. */
-      libvibeModel_Sequential_AllocInit_8u_C3R(model, image, X, Y);
-      libvibeModel_Sequential_SetUpdateFactor(model, updateFactor);
+      /* Allocates the model and initialize it with the first image, or loads a saved model. */
+      if( loadFile )
+      {
+        if( libvibeModel_Sequential_Load(model, loadFile) != 0 ) error("Cannot load the model");
+        if( (libvibeModel_Sequential_GetWidth(model) != (uint32_t)X) || (libvibeModel_Sequential_GetHeight(model) != (uint32_t)Y) ) error("The loaded model does not have the size of the images");
+        if( libvibeModel_Sequential_GetInputChannels(model) != (uint32_t)C ) error("The loaded model does not have the number of channels of the images");
+
+        if( (numberOfSamplesArg || matchingNumberArg) && (libvibeModel_Sequential_Resize(model,
+              numberOfSamplesArg ? (uint32_t)numberOfSamples : libvibeModel_Sequential_GetNumberOfSamples(model),
+              matchingNumberArg ? (uint32_t)matchingNumber : libvibeModel_Sequential_GetMatchingNumber(model)) != 0) )
+          error("The loaded model cannot take this number of samples and matching number");
+        if( matchingThresholdArg ) libvibeModel_Sequential_SetMatchingThreshold(model, matchingThreshold);
+        if( updateFactorArg ) libvibeModel_Sequential_SetUpdateFactor(model, updateFactor);
+      }
+      else
+      {
+        if( C == 1 ) libvibeModel_Sequential_AllocInit_8u_C1R(model, image, X, Y);
+        else if( C == 3 ) libvibeModel_Sequential_AllocInit_8u_C3R(model, image, X, Y);
+        else libvibeModel_Sequential_AllocInit_8u_C4R(model, image, X, Y);
+        libvibeModel_Sequential_SetUpdateFactor(model, updateFactor);
+      }
 
       if (frameDiff){
         /* Initialize frame differencing model */
@@ -278,13 +331,15 @@ int main(int argc, char ** argv)
       }
     }
 
+    if( (X != width) || (Y != height) || (C != channels) ) error("All the images must have the same size and number of channels");
+
     segmentation_map = (uint8_t*)malloc(X * Y * sizeof(uint8_t));
     frame_difference_map = (uint8_t*)malloc(X * Y * sizeof(uint8_t));
 
-    /* Segmentation step: produces the output mask. */
-    libvibeModel_Sequential_Segmentation_8u_C3R(model, image, segmentation_map);
-
     if (frameDiff){
+      /* Segmentation step: produces the output mask. */
+      libvibeModel_Sequential_Segmentation_8u_C3R(model, image, segmentation_map);
+
       /* Get three-frame difference map */
       vibeFrameDifference_Add_Frame(fDmodel, image);
 
@@ -293,10 +348,16 @@ int main(int argc, char ** argv)
         // Compute frame diff and store it in frame_difference_map
         vibeFrameDifference_ComputeFrameDifference(fDmodel, segmentation_map, frame_difference_map);
       } // if
-    } // if
 
-    /* Next, we update the model. This step is optional. */
-    libvibeModel_Sequential_Update_8u_C3R(model, image, segmentation_map);
+      /* The model is updated with the mask cleaned by the frame difference. */
+      libvibeModel_Sequential_Update_8u_C3R(model, image, segmentation_map);
+    } // if
+    else {
+      /* Segmentation and update of the model in a single pass: produces the output mask. */
+      if( C == 1 ) libvibeModel_Sequential_Process_8u_C1R(model, image, segmentation_map);
+      else if( C == 3 ) libvibeModel_Sequential_Process_8u_C3R(model, image, segmentation_map);
+      else libvibeModel_Sequential_Process_8u_C4R(model, image, segmentation_map);
+    } // else
 
     /* Write mask */
     char filename[512];
@@ -310,6 +371,20 @@ int main(int argc, char ** argv)
     free( (void *) image );
   }
 
+  /* Saves the model for the next run. */
+  if( saveFile && (libvibeModel_Sequential_Save(model, saveFile) != 0) ) error("Cannot save the model");
+
+  /* Counters of the hot paths (built with -DVIBE_STATS only). */
+  vibeStats_t stats;
+
+  if( (libvibeModel_Sequential_GetStats(model, &stats) == 0) && (stats.segmentedPixels > 0) ) {
+    printf("Tail: %.2f%% of the pixels  |  %.2f samples tested per pixel  |  %llu swaps  |  %llu moves\n",
+      100.0 * stats.tailPixels / stats.segmentedPixels, (double)stats.testedSamples / stats.segmentedPixels,
+      (unsigned long long)stats.swappedSamples, (unsigned long long)stats.movedSamples);
+    printf("Update: %llu writes, %llu of them into neighbors\n",
+      (unsigned long long)stats.updateWrites, (unsigned long long)stats.neighborWrites);
+  }
+
   /* Cleanup allocated memory. */
   libvibeModel_Sequential_Free(model);
 
@@ -0,0 +1,100 @@
+/**
+ * Changes of the matching number of an allocated model on a static scene: a
+ * matching number below the number of historyImages is rejected, and every
+ * accepted change keeps the whole scene in the background.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "vibe-background-sequential.h"
+
+#define WIDTH  64
+#define HEIGHT 48
+
+static int failures = 0;
+
+static void check(int condition, const char *message)
+{
+  if (!condition) {
+    fprintf(stderr, "FAILED: %s\n", message);
+    ++failures;
+  }
+}
+
+/* Number of foreground pixels after a few frames of the static scene. */
+static uint32_t foreground(vibeModel_Sequential_t *model, const uint8_t *image, uint32_t channels)
+{
+  static uint8_t segmentation_map[WIDTH * HEIGHT];
+  uint32_t count = 0;
+
+  for (int n = 0; n < 4; ++n) {
+    if (channels == 1) libvibeModel_Sequential_Process_8u_C1R(model, image, segmentation_map);
+    else libvibeModel_Sequential_Process_8u_C3R(model, image, segmentation_map);
+  }
+
+  for (int i = 0; i < WIDTH * HEIGHT; ++i)
+    count += (segmentation_map[i] != 0);
+
+  return count;
+}
+
+static void testChannels(const uint8_t *image, uint32_t channels)
+{
+  vibeModel_Sequential_t *model;
+
+  /* Decreasing the matching number below the number of historyImages (4 by default) is rejected. */
+  model = libvibeModel_Sequential_New();
+  libvibeModel_Sequential_SetMatchingNumber(model, 4);
+  if (channels == 1) libvibeModel_Sequential_AllocInit_8u_C1R(model, image, WIDTH, HEIGHT);
+  else libvibeModel_Sequential_AllocInit_8u_C3R(model, image, WIDTH, HEIGHT);
+
+  check(foreground(model, image, channels) == 0, "static scene in the background");
+  check(libvibeModel_Sequential_SetMatchingNumber(model, 2) != 0, "matching number below the historyImages rejected");
+  check(libvibeModel_Sequential_GetMatchingNumber(model) == 4, "matching number kept");
+  check(foreground(model, image, channels) == 0, "static scene in the background after a rejected decrease");
+  libvibeModel_Sequential_Free(model);
+
+  /* With fewer historyImages, the matching number decreases down to their number. */
+  model = libvibeModel_Sequential_New();
+  libvibeModel_Sequential_SetMatchingNumber(model, 4);
+  libvibeModel_Sequential_SetNumberOfHistoryImages(model, 2);
+  if (channels == 1) libvibeModel_Sequential_AllocInit_8u_C1R(model, image, WIDTH, HEIGHT);
+  else libvibeModel_Sequential_AllocInit_8u_C3R(model, image, WIDTH, HEIGHT);
+
+  check(libvibeModel_Sequential_SetMatchingNumber(model, 2) == 0, "matching number down to the historyImages accepted");
+  check(foreground(model, image, channels) == 0, "static scene in the background after a decrease");
+  check(libvibeModel_Sequential_SetMatchingNumber(model, 1) != 0, "matching number below the historyImages rejected");
+  check(foreground(model, image, channels) == 0, "static scene in the background after a rejected decrease");
+  libvibeModel_Sequential_Free(model);
+
+  /* More historyImages than the matching number are limited to it. */
+  model = libvibeModel_Sequential_New();
+  libvibeModel_Sequential_SetMatchingNumber(model, 2);
+  libvibeModel_Sequential_SetNumberOfHistoryImages(model, 4);
+  if (channels == 1) libvibeModel_Sequential_AllocInit_8u_C1R(model, image, WIDTH, HEIGHT);
+  else libvibeModel_Sequential_AllocInit_8u_C3R(model, image, WIDTH, HEIGHT);
+
+  check(libvibeModel_Sequential_GetNumberOfHistoryImages(model) == 2, "historyImages limited to the matching number");
+  check(foreground(model, image, channels) == 0, "static scene in the background with the historyImages limited");
+  libvibeModel_Sequential_Free(model);
+}
+
+int main(void)
+{
+  static uint8_t image[WIDTH * HEIGHT * 3];
+
+  /* A textured static scene. */
+  for (int i = 0; i < WIDTH * HEIGHT * 3; ++i)
+    image[i] = (uint8_t)((i * 7 + (i / (WIDTH * 3)) * 13) & 255);
+
+  testChannels(image, 1);
+  testChannels(image, 3);
+
+  if (failures != 0)
+    return(EXIT_FAILURE);
+
+  printf("test_matching_number: OK\n");
+
+  return(0);
+}
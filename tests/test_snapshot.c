@@ -0,0 +1,187 @@
+/**
+ * Snapshots of models: a loaded model gives the masks of the saved one (with
+ * the image step of the caller, not the one of the saved model), and Load
+ * rejects with -1 the files whose header or buffers with random values are
+ * corrupted, leaving the model unchanged.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "vibe-background-sequential.h"
+
+#define WIDTH   64
+#define HEIGHT  48
+#define PADDING 16
+#define FRAMES  10
+
+#define SAVED     "test_snapshot.bin"
+#define CORRUPTED "test_snapshot_corrupted.bin"
+
+/* Offsets (in bytes) of some fields of the header of a snapshot (version 4). */
+enum {
+  MATCHING_NUMBER            = 36,
+  UPDATE_FACTOR              = 40,
+  LAST_HISTORY_IMAGE_SWAPPED = 52,
+  LAYOUT                     = 56,
+  BUFFER_LAYOUT              = 60,
+  BUFFER_PIXEL_STRIDE        = 72,
+  RANDOM                     = 104,
+  SECTION_OFFSETS            = 120
+};
+
+static int failures = 0;
+
+static void check(int condition, const char *message)
+{
+  if (!condition) {
+    fprintf(stderr, "FAILED: %s\n", message);
+    ++failures;
+  }
+}
+
+/* Frame n of a textured scene with a moving square, with rows of step bytes. */
+static void makeFrame(uint8_t *image, uint32_t channels, uint32_t step, int n)
+{
+  for (uint32_t y = 0; y < HEIGHT; ++y) {
+    for (uint32_t x = 0; x < step; ++x) {
+      uint32_t column = x / channels;
+      int inside = (column >= 4 * n) && (column < 4 * n + 12) && (y >= 10) && (y < 22);
+
+      image[y * step + x] = (uint8_t)(inside ? 255 - x : ((x * 7 + y * 13) & 127));
+    }
+  }
+}
+
+static void process(vibeModel_Sequential_t *model, const uint8_t *image, uint32_t channels, uint8_t *segmentation_map)
+{
+  if (channels == 1) libvibeModel_Sequential_Process_8u_C1R(model, image, segmentation_map);
+  else libvibeModel_Sequential_Process_8u_C3R(model, image, segmentation_map);
+}
+
+/* The saved model, fed with padded frames, and the loaded one, fed with packed frames, give the same masks. */
+static void testRoundTrip(uint32_t channels, vibeModelLayout_t layout)
+{
+  static uint8_t padded[HEIGHT * (WIDTH * 3 + PADDING)];
+  static uint8_t packed[HEIGHT * WIDTH * 3];
+  static uint8_t savedMap[WIDTH * HEIGHT];
+  static uint8_t loadedMap[WIDTH * HEIGHT];
+  uint32_t step = WIDTH * channels + PADDING;
+
+  vibeModel_Sequential_t *saved = libvibeModel_Sequential_New();
+  libvibeModel_Sequential_SetLayout(saved, layout);
+  libvibeModel_Sequential_SetImageStep(saved, step);
+  makeFrame(padded, channels, step, 0);
+  if (channels == 1) libvibeModel_Sequential_AllocInit_8u_C1R(saved, padded, WIDTH, HEIGHT);
+  else libvibeModel_Sequential_AllocInit_8u_C3R(saved, padded, WIDTH, HEIGHT);
+
+  for (int n = 1; n < FRAMES / 2; ++n) {
+    makeFrame(padded, channels, step, n);
+    process(saved, padded, channels, savedMap);
+  }
+
+  check(libvibeModel_Sequential_Save(saved, SAVED) == 0, "model saved");
+
+  vibeModel_Sequential_t *loaded = libvibeModel_Sequential_New();
+  check(libvibeModel_Sequential_Load(loaded, SAVED) == 0, "model loaded");
+
+  int same = 1;
+
+  for (int n = FRAMES / 2; n < FRAMES; ++n) {
+    makeFrame(padded, channels, step, n);
+    makeFrame(packed, channels, WIDTH * channels, n);
+    process(saved, padded, channels, savedMap);
+    process(loaded, packed, channels, loadedMap);
+    same = same && (memcmp(savedMap, loadedMap, sizeof(savedMap)) == 0);
+  }
+
+  check(same, "same masks after the round trip");
+
+  libvibeModel_Sequential_Free(saved);
+  libvibeModel_Sequential_Free(loaded);
+}
+
+/* Copy of the saved file with "size" bytes at "offset" replaced by "value". */
+static int loadCorrupted(const uint8_t *file, long fileSize, long offset, const void *value, size_t size)
+{
+  uint8_t *copy = (uint8_t *)malloc(fileSize);
+  memcpy(copy, file, fileSize);
+  memcpy(copy + offset, value, size);
+
+  FILE *stream = fopen(CORRUPTED, "wb");
+  fwrite(copy, 1, fileSize, stream);
+  fclose(stream);
+  free(copy);
+
+  vibeModel_Sequential_t *model = libvibeModel_Sequential_New();
+  int32_t result = libvibeModel_Sequential_Load(model, CORRUPTED);
+
+  /* The model is left unchanged: it still loads a valid file. */
+  if (result != 0)
+    check(libvibeModel_Sequential_Load(model, SAVED) == 0, "model unchanged by a rejected file");
+
+  libvibeModel_Sequential_Free(model);
+
+  return result;
+}
+
+static void testCorruptedFiles(void)
+{
+  static uint8_t image[WIDTH * HEIGHT];
+
+  /* A C1R model with 2 historyImages and 18 samples in the historyBuffer. */
+  vibeModel_Sequential_t *model = libvibeModel_Sequential_New();
+  makeFrame(image, 1, WIDTH, 0);
+  libvibeModel_Sequential_AllocInit_8u_C1R(model, image, WIDTH, HEIGHT);
+  check(libvibeModel_Sequential_Save(model, SAVED) == 0, "model saved");
+  libvibeModel_Sequential_Free(model);
+
+  FILE *stream = fopen(SAVED, "rb");
+  fseek(stream, 0, SEEK_END);
+  long fileSize = ftell(stream);
+  fseek(stream, 0, SEEK_SET);
+  uint8_t *file = (uint8_t *)malloc(fileSize);
+  check(fread(file, 1, fileSize, stream) == (size_t)fileSize, "model read");
+  fclose(stream);
+
+  /* Sections of the jump, neighbor and position buffers. */
+  uint64_t offsets[5];
+  memcpy(offsets, file + SECTION_OFFSETS, sizeof(offsets));
+
+  uint32_t one = 1, zero = 0, two = 2, stride = 100000, numberOfSamples = 20;
+  uint32_t random[4] = { 0, 0, 0, 0 };
+  int32_t farNeighbor = 1 << 20;
+
+  check(loadCorrupted(file, fileSize, 0, file, 1) == 0, "intact file loaded");
+  check(loadCorrupted(file, fileSize, MATCHING_NUMBER, &one, sizeof(one)) != 0, "matching number below the historyImages rejected");
+  check(loadCorrupted(file, fileSize, UPDATE_FACTOR, &zero, sizeof(zero)) != 0, "update factor of 0 rejected");
+  check(loadCorrupted(file, fileSize, LAST_HISTORY_IMAGE_SWAPPED, &two, sizeof(two)) != 0, "last historyImage swapped out of range rejected");
+  check(loadCorrupted(file, fileSize, LAYOUT, &two, sizeof(two)) != 0, "unknown layout rejected");
+  check(loadCorrupted(file, fileSize, BUFFER_LAYOUT, &two, sizeof(two)) != 0, "unknown buffer layout rejected");
+  check(loadCorrupted(file, fileSize, BUFFER_PIXEL_STRIDE, &stride, sizeof(stride)) != 0, "wrong stride rejected");
+  check(loadCorrupted(file, fileSize, RANDOM, random, sizeof(random)) != 0, "null random state rejected");
+  check(loadCorrupted(file, fileSize, (long)offsets[2], &zero, sizeof(zero)) != 0, "jump of 0 rejected");
+  check(loadCorrupted(file, fileSize, (long)offsets[3], &farNeighbor, sizeof(farNeighbor)) != 0, "far neighbor rejected");
+  check(loadCorrupted(file, fileSize, (long)offsets[4], &numberOfSamples, sizeof(numberOfSamples)) != 0, "position out of the samples rejected");
+
+  free(file);
+}
+
+int main(void)
+{
+  testRoundTrip(1, VIBE_LAYOUT_INTERLEAVED);
+  testRoundTrip(3, VIBE_LAYOUT_INTERLEAVED);
+  testRoundTrip(3, VIBE_LAYOUT_PLANAR);
+  testCorruptedFiles();
+
+  remove(SAVED);
+  remove(CORRUPTED);
+
+  if (failures != 0)
+    return(EXIT_FAILURE);
+
+  printf("test_snapshot: OK\n");
+
+  return(0);
+}
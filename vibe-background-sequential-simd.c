@@ -0,0 +1,2685 @@
+/**
+    @file vibe-background-sequential-simd.c
+    @brief Implementation of vibe-background-sequential-simd.h
+
+    @details
+
+  For color images, the pixels are stored as RGBRGB..., which makes the
+  computation of the L1 distance awkward for SIMD units. The kernels load 16
+  pixels (48 bytes) per 128-bit lane, compute the absolute differences byte
+  per byte on the interleaved data and only then deinterleave them with byte
+  shuffles, so that the three differences of a pixel end up in the same lane.
+  The sums are computed on 16 bits (at most 3 * 255) and compared with the
+  integer equivalent of the "4.5 * threshold" test of the reference code.
+
+  For planar models, only the input pixels need to be deinterleaved: this is
+  done once per group of pixels, before the loop on the historyImages.
+
+  The AVX2 kernels use the same shuffles: each 128-bit lane of the 256-bit
+  registers processes its own group of 16 pixels.
+
+  The 16u kernels (16-bit samples) follow the same scheme on 16-bit lanes (8
+  pixels per 128-bit lane for the color images); the sums of the color
+  differences saturate at 65535, which keeps the test exact for the thresholds
+  below 65535 (the larger ones use the scalar kernel). The per-pixel masks are
+  packed into bytes, so that the counters are the same 8-bit counters as for
+  the 8u kernels.
+
+  The samples of 16 bits (RGB565 or RGB555) of a C3R historyBuffer are
+  searched pixel by pixel: the samples of a pixel are contiguous, 8 (SSE4.1)
+  or 16 (AVX2) of them per register, and their channels are extracted with
+  shifts and masks to the centers of their quantization bins before the L1
+  distance is computed on 16-bit lanes.
+
+  The YUV 4:2:0 kernels compare 16 luma bytes with the 8 chroma pairs (UVUV...)
+  of the same pixels: the chroma differences of a pair are summed with a
+  multiply-add by ones and repeated for both pixels before being added to the
+  luma differences.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+
+#include "vibe-background-sequential-simd.h"
+#include "vibe-background-sequential.h"
+
+#ifdef VIBE_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define VIBE_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define VIBE_FORCE_INLINE inline
+#endif
+
+/* Calls kernel(numberOfHistoryImages, ...) with a constant number of
+ * historyImages for the common values 1 to 4, so that the loop on the
+ * historyImages is unrolled in each of these specializations.
+ */
+#define VIBE_SPECIALIZE_HISTORY_IMAGES(kernel, ...) \
+  switch (numberOfHistoryImages) { \
+    case 1:  return kernel(1, __VA_ARGS__); \
+    case 2:  return kernel(2, __VA_ARGS__); \
+    case 3:  return kernel(3, __VA_ARGS__); \
+    case 4:  return kernel(4, __VA_ARGS__); \
+    default: return kernel(numberOfHistoryImages, __VA_ARGS__); \
+  }
+
+// -----------------------------------------------------------------------------
+// Scalar kernels
+// -----------------------------------------------------------------------------
+/* L1 distance between the RGB pixel a and the pixel b, whose channels are channelStride bytes apart. */
+static inline int32_t sad_8u_C3R(const uint8_t *a, const uint8_t *b, size_t channelStride)
+{
+  int32_t dr = a[0] - b[0];
+  int32_t dg = a[1] - b[channelStride];
+  int32_t db = a[2] - b[2 * channelStride];
+
+  return ((dr >= 0) ? dr : -dr) + ((dg >= 0) ? dg : -dg) + ((db >= 0) ? db : -db);
+}
+
+/* L1 distance between two RGB pixels of 16-bit samples. */
+static inline int32_t sad_16u_C3R(const uint16_t *a, const uint16_t *b)
+{
+  int32_t dr = a[0] - b[0];
+  int32_t dg = a[1] - b[1];
+  int32_t db = a[2] - b[2];
+
+  return ((dr >= 0) ? dr : -dr) + ((dg >= 0) ? dg : -dg) + ((db >= 0) ? db : -db);
+}
+
+/* Shifts the indices found by a kernel called on the pixels following "offset". */
+static inline uint32_t offsetTails(uint32_t *tailIndex, uint32_t numberOfTails, uint32_t offset)
+{
+  for (uint32_t i = 0; i < numberOfTails; ++i)
+    tailIndex[i] += offset;
+
+  return(numberOfTails);
+}
+
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_C1R_scalar_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  uint32_t numberOfTails = 0;
+
+  for (uint32_t index = 0; index < numberOfPixels; ++index) {
+    int32_t value = image_data[index];
+    int32_t distance = value - historyImage[index];
+    uint8_t count = (((distance >= 0) ? distance : -distance) > matchingThreshold) ? matchingNumber : matchingNumber - 1;
+
+    for (uint32_t i = 1; i < numberOfHistoryImages; ++i) {
+      distance = value - historyImage[i * planeSize + index];
+
+      if (((distance >= 0) ? distance : -distance) <= matchingThreshold)
+        --count;
+    }
+
+    counts[index] = count;
+
+    if (count != 0)
+      tailIndex[numberOfTails++] = index;
+  }
+
+  return(numberOfTails);
+}
+
+static uint32_t historyCount_8u_C1R_scalar(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_C1R_scalar_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_C3R_scalar_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  int32_t threshold = vibe_threshold_8u_C3R(matchingThreshold);
+  uint32_t numberOfTails = 0;
+
+  for (uint32_t index = 0; index < numberOfPixels; ++index) {
+    uint8_t count = (sad_8u_C3R(image_data + 3 * index, historyImage + 3 * index, 1) > threshold) ? matchingNumber : matchingNumber - 1;
+
+    for (uint32_t i = 1; i < numberOfHistoryImages; ++i) {
+      if (sad_8u_C3R(image_data + 3 * index, historyImage + i * planeSize + 3 * index, 1) <= threshold)
+        --count;
+    }
+
+    counts[index] = count;
+
+    if (count != 0)
+      tailIndex[numberOfTails++] = index;
+  }
+
+  return(numberOfTails);
+}
+
+static uint32_t historyCount_8u_C3R_scalar(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_C3R_scalar_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_P3R_scalar_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t channelSize,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  int32_t threshold = vibe_threshold_8u_C3R(matchingThreshold);
+  uint32_t numberOfTails = 0;
+
+  for (uint32_t index = 0; index < numberOfPixels; ++index) {
+    uint8_t count = matchingNumber;
+
+    for (uint32_t i = 0; i < numberOfHistoryImages; ++i) {
+      if (sad_8u_C3R(image_data + 3 * index, historyImage + i * planeSize + index, channelSize) <= threshold)
+        --count;
+    }
+
+    counts[index] = count;
+
+    if (count != 0)
+      tailIndex[numberOfTails++] = index;
+  }
+
+  return(numberOfTails);
+}
+
+static uint32_t historyCount_8u_P3R_scalar(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t channelSize,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_P3R_scalar_n,
+    image_data, historyImage, channelSize, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+static VIBE_FORCE_INLINE uint32_t historyCount_16u_C1R_scalar_n(
+  uint32_t numberOfHistoryImages,
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  uint32_t numberOfTails = 0;
+
+  for (uint32_t index = 0; index < numberOfPixels; ++index) {
+    int32_t value = image_data[index];
+    int32_t distance = value - historyImage[index];
+    uint8_t count = (((distance >= 0) ? distance : -distance) > matchingThreshold) ? matchingNumber : matchingNumber - 1;
+
+    for (uint32_t i = 1; i < numberOfHistoryImages; ++i) {
+      distance = value - historyImage[i * planeSize + index];
+
+      if (((distance >= 0) ? distance : -distance) <= matchingThreshold)
+        --count;
+    }
+
+    counts[index] = count;
+
+    if (count != 0)
+      tailIndex[numberOfTails++] = index;
+  }
+
+  return(numberOfTails);
+}
+static uint32_t historyCount_16u_C1R_scalar(
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_16u_C1R_scalar_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+static VIBE_FORCE_INLINE uint32_t historyCount_16u_C3R_scalar_n(
+  uint32_t numberOfHistoryImages,
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  int32_t threshold = vibe_threshold_16u_C3R(matchingThreshold);
+  uint32_t numberOfTails = 0;
+
+  for (uint32_t index = 0; index < numberOfPixels; ++index) {
+    uint8_t count = (sad_16u_C3R(image_data + 3 * index, historyImage + 3 * index) > threshold) ? matchingNumber : matchingNumber - 1;
+
+    for (uint32_t i = 1; i < numberOfHistoryImages; ++i) {
+      if (sad_16u_C3R(image_data + 3 * index, historyImage + i * planeSize + 3 * index) <= threshold)
+        --count;
+    }
+
+    counts[index] = count;
+
+    if (count != 0)
+      tailIndex[numberOfTails++] = index;
+  }
+
+  return(numberOfTails);
+}
+static uint32_t historyCount_16u_C3R_scalar(
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_16u_C3R_scalar_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+/* L1 distance between the pixel (y, uv[0], uv[1]) and the luma and chroma samples of a YUV 4:2:0 model. */
+static inline int32_t sad_8u_420(int32_t y, const uint8_t *uv, uint8_t luma, const uint8_t *chroma)
+{
+  int32_t dy = y - luma;
+  int32_t du = uv[0] - chroma[0];
+  int32_t dv = uv[1] - chroma[1];
+
+  return ((dy >= 0) ? dy : -dy) + ((du >= 0) ? du : -du) + ((dv >= 0) ? dv : -dv);
+}
+
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_420_scalar_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *luma,
+  const uint8_t *chroma,
+  const uint8_t *historyLuma,
+  const uint8_t *historyChroma,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  int32_t threshold = vibe_threshold_8u_C3R(matchingThreshold);
+  uint32_t numberOfTails = 0;
+
+  for (uint32_t index = 0; index < numberOfPixels; ++index) {
+    /* The chroma of the pixel pair. */
+    uint32_t pair = index & ~1u;
+    uint8_t count = (sad_8u_420(luma[index], chroma + pair, historyLuma[index], historyChroma + pair) > threshold) ? matchingNumber : matchingNumber - 1;
+
+    for (uint32_t i = 1; i < numberOfHistoryImages; ++i) {
+      if (sad_8u_420(luma[index], chroma + pair, historyLuma[i * planeSize + index], historyChroma + i * planeSize + pair) <= threshold)
+        --count;
+    }
+
+    counts[index] = count;
+
+    if (count != 0)
+      tailIndex[numberOfTails++] = index;
+  }
+
+  return(numberOfTails);
+}
+
+static uint32_t historyCount_8u_420_scalar(
+  const uint8_t *luma,
+  const uint8_t *chroma,
+  const uint8_t *historyLuma,
+  const uint8_t *historyChroma,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_420_scalar_n,
+    luma, chroma, historyLuma, historyChroma, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+static void deinterleave_8u_C3P3R_scalar(
+  const uint8_t *image_data,
+  uint8_t *image_planes,
+  size_t channelSize,
+  uint32_t numberOfPixels
+) {
+  for (uint32_t index = 0; index < numberOfPixels; ++index) {
+    image_planes[index]                   = image_data[3 * index];
+    image_planes[channelSize + index]     = image_data[3 * index + 1];
+    image_planes[2 * channelSize + index] = image_data[3 * index + 2];
+  }
+}
+
+static void tailSearch_8u_C1R_scalar(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+) {
+  for (uint32_t t = 0; t < numberOfTails; ++t) {
+    uint32_t index = tailIndex[t];
+    int32_t value = image_data[index];
+    uint8_t *sample = historyBuffer + index;
+
+    for (uint32_t i = 0; i < numberOfTests; ++i, sample += planeSize) {
+      int32_t distance = value - *sample;
+
+      VIBE_COUNT(++tailCounts->testedSamples);
+
+      if (((distance >= 0) ? distance : -distance) <= matchingThreshold) {
+        --segmentation_map[index];
+        VIBE_COUNT(++tailCounts->swappedSamples);
+
+        /* Swaping: Putting found value in history image buffer. */
+        uint8_t temp = swappingImage[index];
+        swappingImage[index] = *sample;
+        *sample = temp;
+
+        if (segmentation_map[index] == 0) break;
+      }
+    }
+
+    if (segmentation_map[index] > 0) segmentation_map[index] = COLOR_FOREGROUND;
+  }
+}
+
+/* Shared by the interleaved (channelStride = 1, pixelStride = 3) and planar (pixelStride = 1) models. */
+static inline void tailSearch_8u_C3R_generic(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t pixelStride,
+  size_t channelStride,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+) {
+  int32_t threshold = vibe_threshold_8u_C3R(matchingThreshold);
+
+  for (uint32_t t = 0; t < numberOfTails; ++t) {
+    uint32_t index = tailIndex[t];
+    const uint8_t *pixel = image_data + 3 * index;
+    uint8_t *swapping = swappingImage + pixelStride * index;
+    uint8_t *sample = historyBuffer + pixelStride * index;
+
+    for (uint32_t i = 0; i < numberOfTests; ++i, sample += planeSize) {
+      if (sad_8u_C3R(pixel, sample, channelStride) <= threshold)
+        --segmentation_map[index];
+
+      /* Swaping: every tested sample goes to the history image. */
+      VIBE_COUNT(++tailCounts->testedSamples; ++tailCounts->swappedSamples);
+
+      for (int c = 0; c < 3; ++c) {
+        uint8_t temp = swapping[c * channelStride];
+        swapping[c * channelStride] = sample[c * channelStride];
+        sample[c * channelStride] = temp;
+      }
+
+      if (segmentation_map[index] == 0) break;
+    }
+
+    if (segmentation_map[index] > 0) segmentation_map[index] = COLOR_FOREGROUND;
+  }
+}
+
+static void tailSearch_8u_C3R_scalar(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+) {
+  tailSearch_8u_C3R_generic(
+    image_data, swappingImage, historyBuffer, 3, 1, planeSize, numberOfTests,
+    matchingThreshold, segmentation_map, tailIndex, numberOfTails, tailCounts
+  );
+}
+
+static void tailSearch_8u_P3R_scalar(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t channelSize,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+) {
+  tailSearch_8u_C3R_generic(
+    image_data, swappingImage, historyBuffer, 1, channelSize, planeSize, numberOfTests,
+    matchingThreshold, segmentation_map, tailIndex, numberOfTails, tailCounts
+  );
+}
+
+/* Turns the sorted list of pixels tailIndex into the list of the (full) groups
+ * of blockSize pixels that contain them, in place. Returns the number of groups;
+ * the pixels of the last, incomplete, group are left at tailIndex[*first...].
+ */
+static inline uint32_t tailBlocks(uint32_t *tailIndex, uint32_t numberOfTails, uint32_t numberOfPixels, uint32_t blockSize, uint32_t *first)
+{
+  uint32_t fullPixels = numberOfPixels - numberOfPixels % blockSize;
+  uint32_t numberOfBlocks = 0;
+  uint32_t t = 0;
+
+  for (; (t < numberOfTails) && (tailIndex[t] < fullPixels); ++t) {
+    uint32_t block = tailIndex[t] - tailIndex[t] % blockSize;
+
+    if ((numberOfBlocks == 0) || (tailIndex[numberOfBlocks - 1] != block))
+      tailIndex[numberOfBlocks++] = block;
+  }
+
+  *first = t;
+
+  return(numberOfBlocks);
+}
+
+static void pack_8u1u_C1R_scalar(const uint8_t *segmentation_map, uint8_t *mask, uint32_t numberOfPixels)
+{
+  for (uint32_t index = 0; index < numberOfPixels; index += 8) {
+    uint8_t bits = 0;
+
+    for (uint32_t b = 0; (b < 8) && (index + b < numberOfPixels); ++b)
+      bits |= (segmentation_map[index + b] != 0) << b;
+
+    mask[index / 8] = bits;
+  }
+}
+
+static void convert_8u_C4C3R_scalar(const uint8_t *image_data, uint8_t *pixels, uint32_t numberOfPixels)
+{
+  for (uint32_t index = 0; index < numberOfPixels; ++index) {
+    pixels[3 * index]     = image_data[4 * index];
+    pixels[3 * index + 1] = image_data[4 * index + 1];
+    pixels[3 * index + 2] = image_data[4 * index + 2];
+  }
+}
+
+static void sums_8u_scalar(const uint8_t *data, uint32_t n, uint16_t *sums)
+{
+  for (uint32_t i = 0; i < n; i += 8) {
+    uint16_t sum = 0;
+
+    for (uint32_t b = i; (b < i + 8) && (b < n); ++b)
+      sum += data[b];
+
+    sums[i / 8] = sum;
+  }
+}
+
+static void noise_8u_scalar(const uint8_t *data, uint8_t *samples, uint32_t n, uint32_t key, uint32_t first)
+{
+  for (uint32_t i = 0; i < n; ++i) {
+    int32_t value = data[i] + vibe_noise_8u(key, first + i);
+
+    samples[i] = (value < 0) ? 0 : ((value > 255) ? 255 : value);
+  }
+}
+
+static uint32_t matches_8u_Q3R_scalar(const uint16_t *samples, uint32_t numberOfSamples, const uint8_t *pixel, int32_t threshold, uint32_t greenBits)
+{
+  uint32_t matches = 0;
+
+  for (uint32_t i = 0; i < numberOfSamples; ++i) {
+    uint8_t sample[3];
+
+    vibe_dequantize_8u_Q3R(samples[i], greenBits, &sample[0], &sample[1], &sample[2]);
+    matches |= (uint32_t)(sad_8u_C3R(pixel, sample, 1) <= threshold) << i;
+  }
+
+  return(matches);
+}
+
+static const vibeKernels_t kernels_scalar = {
+  VIBE_SIMD_NONE,
+  historyCount_8u_C1R_scalar,
+  historyCount_8u_C3R_scalar,
+  historyCount_8u_P3R_scalar,
+  deinterleave_8u_C3P3R_scalar,
+  tailSearch_8u_C1R_scalar,
+  tailSearch_8u_C3R_scalar,
+  tailSearch_8u_P3R_scalar,
+  pack_8u1u_C1R_scalar,
+  historyCount_16u_C1R_scalar,
+  historyCount_16u_C3R_scalar,
+  convert_8u_C4C3R_scalar,
+  historyCount_8u_420_scalar,
+  sums_8u_scalar,
+  noise_8u_scalar,
+  matches_8u_Q3R_scalar
+};
+
+#ifdef VIBE_HAVE_X86_SIMD
+
+// -----------------------------------------------------------------------------
+// SSE4.1 kernels
+// -----------------------------------------------------------------------------
+#ifndef VIBE_DISABLE_SSE41
+
+#define VIBE_TARGET_SSE41 __attribute__((target("sse4.1")))
+
+/* Absolute difference of unsigned bytes. */
+VIBE_TARGET_SSE41
+static inline __m128i absdiff_epu8_sse41(__m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+/* Appends the indices of the pixels whose counter is not zero. */
+VIBE_TARGET_SSE41
+static inline uint32_t collectTails_sse41(__m128i count, uint32_t index, uint32_t *tailIndex, uint32_t numberOfTails)
+{
+  uint32_t bits = (~_mm_movemask_epi8(_mm_cmpeq_epi8(count, _mm_setzero_si128()))) & 0xFFFF;
+
+  for (; bits != 0; bits &= bits - 1)
+    tailIndex[numberOfTails++] = index + __builtin_ctz(bits);
+
+  return(numberOfTails);
+}
+
+/* Returns 0xFF where |a - b| <= threshold, 0x00 otherwise. */
+VIBE_TARGET_SSE41
+static inline __m128i close_8u_C1R_sse41(__m128i a, const uint8_t *b, __m128i threshold)
+{
+  __m128i d = absdiff_epu8_sse41(a, _mm_loadu_si128((const __m128i *)b));
+  return _mm_cmpeq_epi8(_mm_subs_epu8(d, threshold), _mm_setzero_si128());
+}
+
+/* Splits 16 RGB pixels (or their differences) into three planes. */
+VIBE_TARGET_SSE41
+static inline void deinterleave_8u_C3R_sse41(__m128i v0, __m128i v1, __m128i v2, __m128i *r, __m128i *g, __m128i *b)
+{
+  *r = _mm_or_si128(
+    _mm_or_si128(
+      _mm_shuffle_epi8(v0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1))
+    ),
+    _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13))
+  );
+  *g = _mm_or_si128(
+    _mm_or_si128(
+      _mm_shuffle_epi8(v0, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))
+    ),
+    _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14))
+  );
+  *b = _mm_or_si128(
+    _mm_or_si128(
+      _mm_shuffle_epi8(v0, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))
+    ),
+    _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15))
+  );
+}
+
+/* Repeats every byte of a per-pixel mask three times, to match 16 RGB pixels. */
+VIBE_TARGET_SSE41
+static inline void expand_8u_C3R_sse41(__m128i m, __m128i *m0, __m128i *m1, __m128i *m2)
+{
+  *m0 = _mm_shuffle_epi8(m, _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5));
+  *m1 = _mm_shuffle_epi8(m, _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10));
+  *m2 = _mm_shuffle_epi8(m, _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15));
+}
+
+/* Sums the three planes of differences on 16 bits; returns 0xFF where the sum is above the threshold. */
+VIBE_TARGET_SSE41
+static inline __m128i notClose_sum_sse41(__m128i r, __m128i g, __m128i b, __m128i threshold)
+{
+  const __m128i zero = _mm_setzero_si128();
+
+  __m128i sumLo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero)), _mm_unpacklo_epi8(b, zero));
+  __m128i sumHi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero)), _mm_unpackhi_epi8(b, zero));
+
+  return _mm_packs_epi16(_mm_cmpgt_epi16(sumLo, threshold), _mm_cmpgt_epi16(sumHi, threshold));
+}
+
+/* Returns 0xFF for the pixels of (a0, a1, a2) that are NOT close to (b0, b1, b2), 0x00 otherwise. */
+VIBE_TARGET_SSE41
+static inline __m128i notClose_8u_C3R_sse41(
+  __m128i a0, __m128i a1, __m128i a2,
+  const uint8_t *b, __m128i threshold
+) {
+  __m128i d0 = absdiff_epu8_sse41(a0, _mm_loadu_si128((const __m128i *)(b)));
+  __m128i d1 = absdiff_epu8_sse41(a1, _mm_loadu_si128((const __m128i *)(b + 16)));
+  __m128i d2 = absdiff_epu8_sse41(a2, _mm_loadu_si128((const __m128i *)(b + 32)));
+
+  __m128i r, g, bl;
+  deinterleave_8u_C3R_sse41(d0, d1, d2, &r, &g, &bl);
+
+  return notClose_sum_sse41(r, g, bl, threshold);
+}
+
+/* Returns 0xFF for the pixels of (r, g, b) that are NOT close to the 16 pixels of the planes at p, 0x00 otherwise. */
+VIBE_TARGET_SSE41
+static inline __m128i notClose_8u_P3R_sse41(__m128i r, __m128i g, __m128i b, const uint8_t *p, size_t channelSize, __m128i threshold)
+{
+  return notClose_sum_sse41(
+    absdiff_epu8_sse41(r, _mm_loadu_si128((const __m128i *)(p))),
+    absdiff_epu8_sse41(g, _mm_loadu_si128((const __m128i *)(p + channelSize))),
+    absdiff_epu8_sse41(b, _mm_loadu_si128((const __m128i *)(p + 2 * channelSize))),
+    threshold
+  );
+}
+
+/* Absolute difference of unsigned 16-bit values. */
+VIBE_TARGET_SSE41
+static inline __m128i absdiff_epu16_sse41(__m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_subs_epu16(a, b), _mm_subs_epu16(b, a));
+}
+
+/* Returns 0xFFFF where |a - b| <= threshold, 0x0000 otherwise (8 samples of 16 bits). */
+VIBE_TARGET_SSE41
+static inline __m128i close_16u_C1R_sse41(__m128i a, const uint16_t *b, __m128i threshold)
+{
+  __m128i d = absdiff_epu16_sse41(a, _mm_loadu_si128((const __m128i *)b));
+  return _mm_cmpeq_epi16(_mm_subs_epu16(d, threshold), _mm_setzero_si128());
+}
+
+/* Splits 8 RGB pixels of 16-bit samples (or their differences) into three planes. */
+VIBE_TARGET_SSE41
+static inline void deinterleave_16u_C3R_sse41(__m128i v0, __m128i v1, __m128i v2, __m128i *r, __m128i *g, __m128i *b)
+{
+  *r = _mm_or_si128(
+    _mm_or_si128(
+      _mm_shuffle_epi8(v0, _mm_setr_epi8(0, 1, 6, 7, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 3, 8, 9, 14, 15, -1, -1, -1, -1))
+    ),
+    _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 4, 5, 10, 11))
+  );
+  *g = _mm_or_si128(
+    _mm_or_si128(
+      _mm_shuffle_epi8(v0, _mm_setr_epi8(2, 3, 8, 9, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 4, 5, 10, 11, -1, -1, -1, -1, -1, -1))
+    ),
+    _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 6, 7, 12, 13))
+  );
+  *b = _mm_or_si128(
+    _mm_or_si128(
+      _mm_shuffle_epi8(v0, _mm_setr_epi8(4, 5, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, 0, 1, 6, 7, 12, 13, -1, -1, -1, -1, -1, -1))
+    ),
+    _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 3, 8, 9, 14, 15))
+  );
+}
+
+/* Returns 0xFFFF for the 8 RGB pixels (a0, a1, a2) that are close to the 8 pixels at b.
+ * The sums saturate at 65535, which does not change the test for a threshold below 65535.
+ */
+VIBE_TARGET_SSE41
+static inline __m128i close_16u_C3R_sse41(__m128i a0, __m128i a1, __m128i a2, const uint16_t *b, __m128i threshold)
+{
+  __m128i r, g, bl;
+
+  deinterleave_16u_C3R_sse41(
+    absdiff_epu16_sse41(a0, _mm_loadu_si128((const __m128i *)(b))),
+    absdiff_epu16_sse41(a1, _mm_loadu_si128((const __m128i *)(b + 8))),
+    absdiff_epu16_sse41(a2, _mm_loadu_si128((const __m128i *)(b + 16))),
+    &r, &g, &bl
+  );
+
+  return _mm_cmpeq_epi16(_mm_subs_epu16(_mm_adds_epu16(_mm_adds_epu16(r, g), bl), threshold), _mm_setzero_si128());
+}
+
+VIBE_TARGET_SSE41
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_C1R_sse41_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  const __m128i threshold = _mm_set1_epi8((char)((matchingThreshold > 255) ? 255 : matchingThreshold));
+  const __m128i initial = _mm_set1_epi8((char)matchingNumber);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 16 <= numberOfPixels; index += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(image_data + index));
+
+    /* matchingNumber minus one per close historyImage (wrapping, as the reference code). */
+    __m128i count = _mm_add_epi8(initial, close_8u_C1R_sse41(a, historyImage + index, threshold));
+
+    for (uint32_t i = 1; i < numberOfHistoryImages; ++i)
+      count = _mm_add_epi8(count, close_8u_C1R_sse41(a, historyImage + i * planeSize + index, threshold));
+
+    _mm_storeu_si128((__m128i *)(counts + index), count);
+
+    numberOfTails = collectTails_sse41(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_8u_C1R_scalar(
+      image_data + index, historyImage + index, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+
+VIBE_TARGET_SSE41
+static uint32_t historyCount_8u_C1R_sse41(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_C1R_sse41_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+VIBE_TARGET_SSE41
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_C3R_sse41_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  const __m128i threshold = _mm_set1_epi16((short)vibe_threshold_8u_C3R(matchingThreshold));
+  const __m128i initial = _mm_set1_epi8((char)(matchingNumber - 1));
+  const __m128i minusOne = _mm_set1_epi8(-1);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 16 <= numberOfPixels; index += 16) {
+    const uint8_t *pixels = image_data + 3 * index;
+    __m128i a0 = _mm_loadu_si128((const __m128i *)(pixels));
+    __m128i a1 = _mm_loadu_si128((const __m128i *)(pixels + 16));
+    __m128i a2 = _mm_loadu_si128((const __m128i *)(pixels + 32));
+
+    /* First historyImage: matchingNumber - 1, or matchingNumber if not close. */
+    __m128i count = _mm_sub_epi8(initial, notClose_8u_C3R_sse41(a0, a1, a2, historyImage + 3 * index, threshold));
+
+    /* Next historyImages: one less if close. */
+    for (uint32_t i = 1; i < numberOfHistoryImages; ++i) {
+      __m128i notClose = notClose_8u_C3R_sse41(a0, a1, a2, historyImage + i * planeSize + 3 * index, threshold);
+      count = _mm_sub_epi8(_mm_add_epi8(count, minusOne), notClose);
+    }
+
+    _mm_storeu_si128((__m128i *)(counts + index), count);
+    numberOfTails = collectTails_sse41(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_8u_C3R_scalar(
+      image_data + 3 * index, historyImage + 3 * index, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+
+VIBE_TARGET_SSE41
+static uint32_t historyCount_8u_C3R_sse41(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_C3R_sse41_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+VIBE_TARGET_SSE41
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_P3R_sse41_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t channelSize,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  const __m128i threshold = _mm_set1_epi16((short)vibe_threshold_8u_C3R(matchingThreshold));
+  const __m128i initial = _mm_set1_epi8((char)(matchingNumber - 1));
+  const __m128i minusOne = _mm_set1_epi8(-1);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 16 <= numberOfPixels; index += 16) {
+    const uint8_t *pixels = image_data + 3 * index;
+    __m128i r, g, b;
+    __m128i count = initial;
+
+    deinterleave_8u_C3R_sse41(
+      _mm_loadu_si128((const __m128i *)(pixels)),
+      _mm_loadu_si128((const __m128i *)(pixels + 16)),
+      _mm_loadu_si128((const __m128i *)(pixels + 32)),
+      &r, &g, &b
+    );
+
+    for (uint32_t i = 0; i < numberOfHistoryImages; ++i) {
+      __m128i notClose = notClose_8u_P3R_sse41(r, g, b, historyImage + i * planeSize + index, channelSize, threshold);
+
+      /* First historyImage: matchingNumber - 1 or matchingNumber; next ones: one less if close. */
+      count = (i == 0) ? _mm_sub_epi8(count, notClose) : _mm_sub_epi8(_mm_add_epi8(count, minusOne), notClose);
+    }
+
+    _mm_storeu_si128((__m128i *)(counts + index), count);
+    numberOfTails = collectTails_sse41(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_8u_P3R_scalar(
+      image_data + 3 * index, historyImage + index, channelSize, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+
+VIBE_TARGET_SSE41
+static uint32_t historyCount_8u_P3R_sse41(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t channelSize,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_P3R_sse41_n,
+    image_data, historyImage, channelSize, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+VIBE_TARGET_SSE41
+static VIBE_FORCE_INLINE uint32_t historyCount_16u_C1R_sse41_n(
+  uint32_t numberOfHistoryImages,
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  const __m128i threshold = _mm_set1_epi16((short)((matchingThreshold > 65535) ? 65535 : matchingThreshold));
+  const __m128i initial = _mm_set1_epi8((char)matchingNumber);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 16 <= numberOfPixels; index += 16) {
+    __m128i a0 = _mm_loadu_si128((const __m128i *)(image_data + index));
+    __m128i a1 = _mm_loadu_si128((const __m128i *)(image_data + index + 8));
+    __m128i count = initial;
+
+    /* The 16-bit masks of the close historyImages are packed into bytes (0xFF = minus one). */
+    for (uint32_t i = 0; i < numberOfHistoryImages; ++i) {
+      const uint16_t *p = historyImage + i * planeSize + index;
+      count = _mm_add_epi8(count, _mm_packs_epi16(close_16u_C1R_sse41(a0, p, threshold), close_16u_C1R_sse41(a1, p + 8, threshold)));
+    }
+
+    _mm_storeu_si128((__m128i *)(counts + index), count);
+
+    numberOfTails = collectTails_sse41(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_16u_C1R_scalar(
+      image_data + index, historyImage + index, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+VIBE_TARGET_SSE41
+static uint32_t historyCount_16u_C1R_sse41(
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_16u_C1R_sse41_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+VIBE_TARGET_SSE41
+static VIBE_FORCE_INLINE uint32_t historyCount_16u_C3R_sse41_n(
+  uint32_t numberOfHistoryImages,
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  int32_t bound = vibe_threshold_16u_C3R(matchingThreshold);
+
+  /* The saturated sums cannot be compared with the largest thresholds. */
+  if (bound >= 65535)
+    return historyCount_16u_C3R_scalar(image_data, historyImage, planeSize, numberOfHistoryImages, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex);
+
+  const __m128i threshold = _mm_set1_epi16((short)bound);
+  const __m128i initial = _mm_set1_epi8((char)matchingNumber);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 16 <= numberOfPixels; index += 16) {
+    const uint16_t *pixels = image_data + 3 * index;
+    __m128i a[6];
+    __m128i count = initial;
+
+    for (int k = 0; k < 6; ++k)
+      a[k] = _mm_loadu_si128((const __m128i *)(pixels + 8 * k));
+
+    for (uint32_t i = 0; i < numberOfHistoryImages; ++i) {
+      const uint16_t *p = historyImage + i * planeSize + 3 * index;
+      count = _mm_add_epi8(count, _mm_packs_epi16(
+        close_16u_C3R_sse41(a[0], a[1], a[2], p, threshold),
+        close_16u_C3R_sse41(a[3], a[4], a[5], p + 24, threshold)
+      ));
+    }
+
+    _mm_storeu_si128((__m128i *)(counts + index), count);
+
+    numberOfTails = collectTails_sse41(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_16u_C3R_scalar(
+      image_data + 3 * index, historyImage + 3 * index, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+VIBE_TARGET_SSE41
+static uint32_t historyCount_16u_C3R_sse41(
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_16u_C3R_sse41_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+/* Returns 0xFF for the 16 pixels (y, uv) that are NOT close to the luma and chroma samples at p and q, 0x00 otherwise. */
+VIBE_TARGET_SSE41
+static inline __m128i notClose_8u_420_sse41(__m128i y, __m128i uv, const uint8_t *p, const uint8_t *q, __m128i threshold)
+{
+  const __m128i zero = _mm_setzero_si128();
+
+  __m128i dy = absdiff_epu8_sse41(y, _mm_loadu_si128((const __m128i *)p));
+  __m128i duv = absdiff_epu8_sse41(uv, _mm_loadu_si128((const __m128i *)q));
+
+  /* |U - U'| + |V - V'| of the 8 pairs, then repeated for both pixels of a pair. */
+  __m128i c = _mm_maddubs_epi16(duv, _mm_set1_epi8(1));
+
+  __m128i sumLo = _mm_add_epi16(_mm_unpacklo_epi8(dy, zero), _mm_unpacklo_epi16(c, c));
+  __m128i sumHi = _mm_add_epi16(_mm_unpackhi_epi8(dy, zero), _mm_unpackhi_epi16(c, c));
+
+  return _mm_packs_epi16(_mm_cmpgt_epi16(sumLo, threshold), _mm_cmpgt_epi16(sumHi, threshold));
+}
+
+VIBE_TARGET_SSE41
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_420_sse41_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *luma,
+  const uint8_t *chroma,
+  const uint8_t *historyLuma,
+  const uint8_t *historyChroma,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  const __m128i threshold = _mm_set1_epi16((short)vibe_threshold_8u_C3R(matchingThreshold));
+  const __m128i initial = _mm_set1_epi8((char)(matchingNumber - 1));
+  const __m128i minusOne = _mm_set1_epi8(-1);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 16 <= numberOfPixels; index += 16) {
+    __m128i y = _mm_loadu_si128((const __m128i *)(luma + index));
+    __m128i uv = _mm_loadu_si128((const __m128i *)(chroma + index));
+
+    /* First historyImage: matchingNumber - 1, or matchingNumber if not close. */
+    __m128i count = _mm_sub_epi8(initial, notClose_8u_420_sse41(y, uv, historyLuma + index, historyChroma + index, threshold));
+
+    /* Next historyImages: one less if close. */
+    for (uint32_t i = 1; i < numberOfHistoryImages; ++i) {
+      __m128i notClose = notClose_8u_420_sse41(y, uv, historyLuma + i * planeSize + index, historyChroma + i * planeSize + index, threshold);
+      count = _mm_sub_epi8(_mm_add_epi8(count, minusOne), notClose);
+    }
+
+    _mm_storeu_si128((__m128i *)(counts + index), count);
+    numberOfTails = collectTails_sse41(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_8u_420_scalar(
+      luma + index, chroma + index, historyLuma + index, historyChroma + index, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+
+VIBE_TARGET_SSE41
+static uint32_t historyCount_8u_420_sse41(
+  const uint8_t *luma,
+  const uint8_t *chroma,
+  const uint8_t *historyLuma,
+  const uint8_t *historyChroma,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_420_sse41_n,
+    luma, chroma, historyLuma, historyChroma, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+VIBE_TARGET_SSE41
+static void deinterleave_8u_C3P3R_sse41(
+  const uint8_t *image_data,
+  uint8_t *image_planes,
+  size_t channelSize,
+  uint32_t numberOfPixels
+) {
+  uint32_t index = 0;
+
+  for (; index + 16 <= numberOfPixels; index += 16) {
+    const uint8_t *pixels = image_data + 3 * index;
+    __m128i r, g, b;
+
+    deinterleave_8u_C3R_sse41(
+      _mm_loadu_si128((const __m128i *)(pixels)),
+      _mm_loadu_si128((const __m128i *)(pixels + 16)),
+      _mm_loadu_si128((const __m128i *)(pixels + 32)),
+      &r, &g, &b
+    );
+
+    _mm_storeu_si128((__m128i *)(image_planes + index), r);
+    _mm_storeu_si128((__m128i *)(image_planes + channelSize + index), g);
+    _mm_storeu_si128((__m128i *)(image_planes + 2 * channelSize + index), b);
+  }
+
+  deinterleave_8u_C3P3R_scalar(image_data + 3 * index, image_planes + index, channelSize, numberOfPixels - index);
+}
+
+VIBE_TARGET_SSE41
+static void tailSearch_8u_C1R_sse41(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+) {
+  const __m128i threshold = _mm_set1_epi8((char)((matchingThreshold > 255) ? 255 : matchingThreshold));
+  const __m128i foreground = _mm_set1_epi8((char)COLOR_FOREGROUND);
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t first;
+  uint32_t numberOfBlocks = tailBlocks(tailIndex, numberOfTails, numberOfPixels, 16, &first);
+
+  /* The pixels of the last, incomplete, group are processed one by one. */
+  tailSearch_8u_C1R_scalar(
+    image_data, swappingImage, historyBuffer, planeSize, numberOfTests, numberOfPixels,
+    matchingThreshold, segmentation_map, tailIndex + first, numberOfTails - first, tailCounts
+  );
+
+  /* Sample plane by sample plane, on the groups with undecided pixels only. */
+  for (uint32_t i = 0; (i < numberOfTests) && (numberOfBlocks > 0); ++i) {
+    uint8_t *samples = historyBuffer + i * planeSize;
+    uint32_t numberOfUndecided = 0;
+
+    for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+      uint32_t index = tailIndex[b];
+      __m128i count = _mm_loadu_si128((const __m128i *)(segmentation_map + index));
+      __m128i sample = _mm_loadu_si128((const __m128i *)(samples + index));
+      __m128i d = absdiff_epu8_sse41(_mm_loadu_si128((const __m128i *)(image_data + index)), sample);
+
+      VIBE_COUNT(tailCounts->testedSamples += 16 - __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(count, zero))));
+
+      /* Undecided pixels with a matching sample: one match less, and the sample goes to the history image. */
+      __m128i match = _mm_andnot_si128(_mm_cmpeq_epi8(count, zero), _mm_cmpeq_epi8(_mm_subs_epu8(d, threshold), zero));
+
+      if (!_mm_testz_si128(match, match)) {
+        __m128i swapping = _mm_loadu_si128((const __m128i *)(swappingImage + index));
+
+        VIBE_COUNT(tailCounts->swappedSamples += __builtin_popcount(_mm_movemask_epi8(match)));
+
+        count = _mm_add_epi8(count, match);
+        _mm_storeu_si128((__m128i *)(segmentation_map + index), count);
+        _mm_storeu_si128((__m128i *)(swappingImage + index), _mm_blendv_epi8(swapping, sample, match));
+        _mm_storeu_si128((__m128i *)(samples + index), _mm_blendv_epi8(sample, swapping, match));
+      }
+
+      if (!_mm_testz_si128(count, count))
+        tailIndex[numberOfUndecided++] = index;
+    }
+
+    numberOfBlocks = numberOfUndecided;
+  }
+
+  /* Produces the output for the groups that still have non-zero counters. */
+  for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+    __m128i count = _mm_loadu_si128((const __m128i *)(segmentation_map + tailIndex[b]));
+    _mm_storeu_si128((__m128i *)(segmentation_map + tailIndex[b]), _mm_andnot_si128(_mm_cmpeq_epi8(count, zero), foreground));
+  }
+}
+
+VIBE_TARGET_SSE41
+static void tailSearch_8u_C3R_sse41(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+) {
+  const __m128i threshold = _mm_set1_epi16((short)vibe_threshold_8u_C3R(matchingThreshold));
+  const __m128i foreground = _mm_set1_epi8((char)COLOR_FOREGROUND);
+  const __m128i minusOne = _mm_set1_epi8(-1);
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t first;
+  uint32_t numberOfBlocks = tailBlocks(tailIndex, numberOfTails, numberOfPixels, 16, &first);
+
+  /* The pixels of the last, incomplete, group are processed one by one. */
+  tailSearch_8u_C3R_scalar(
+    image_data, swappingImage, historyBuffer, planeSize, numberOfTests, numberOfPixels,
+    matchingThreshold, segmentation_map, tailIndex + first, numberOfTails - first, tailCounts
+  );
+
+  /* Sample plane by sample plane, on the groups with undecided pixels only. */
+  for (uint32_t i = 0; (i < numberOfTests) && (numberOfBlocks > 0); ++i) {
+    uint8_t *samples = historyBuffer + i * planeSize;
+    uint32_t numberOfUndecided = 0;
+
+    for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+      uint32_t index = tailIndex[b];
+      const uint8_t *pixels = image_data + 3 * index;
+      uint8_t *sample = samples + 3 * index;
+      uint8_t *swapping = swappingImage + 3 * index;
+
+      __m128i count = _mm_loadu_si128((const __m128i *)(segmentation_map + index));
+      __m128i decided = _mm_cmpeq_epi8(count, zero);
+      VIBE_COUNT(uint32_t undecided = 16 - __builtin_popcount(_mm_movemask_epi8(decided)); tailCounts->testedSamples += undecided; tailCounts->swappedSamples += undecided);
+      __m128i s0 = _mm_loadu_si128((const __m128i *)(sample));
+      __m128i s1 = _mm_loadu_si128((const __m128i *)(sample + 16));
+      __m128i s2 = _mm_loadu_si128((const __m128i *)(sample + 32));
+      __m128i w0 = _mm_loadu_si128((const __m128i *)(swapping));
+      __m128i w1 = _mm_loadu_si128((const __m128i *)(swapping + 16));
+      __m128i w2 = _mm_loadu_si128((const __m128i *)(swapping + 32));
+      __m128i r, g, bl, m0, m1, m2;
+
+      deinterleave_8u_C3R_sse41(
+        absdiff_epu8_sse41(_mm_loadu_si128((const __m128i *)(pixels)), s0),
+        absdiff_epu8_sse41(_mm_loadu_si128((const __m128i *)(pixels + 16)), s1),
+        absdiff_epu8_sse41(_mm_loadu_si128((const __m128i *)(pixels + 32)), s2),
+        &r, &g, &bl
+      );
+
+      /* Undecided pixels: one match less if close; the sample always goes to the history image. */
+      count = _mm_add_epi8(count, _mm_andnot_si128(_mm_or_si128(notClose_sum_sse41(r, g, bl, threshold), decided), minusOne));
+      _mm_storeu_si128((__m128i *)(segmentation_map + index), count);
+
+      expand_8u_C3R_sse41(decided, &m0, &m1, &m2);
+      _mm_storeu_si128((__m128i *)(swapping),      _mm_blendv_epi8(s0, w0, m0));
+      _mm_storeu_si128((__m128i *)(swapping + 16), _mm_blendv_epi8(s1, w1, m1));
+      _mm_storeu_si128((__m128i *)(swapping + 32), _mm_blendv_epi8(s2, w2, m2));
+      _mm_storeu_si128((__m128i *)(sample),      _mm_blendv_epi8(w0, s0, m0));
+      _mm_storeu_si128((__m128i *)(sample + 16), _mm_blendv_epi8(w1, s1, m1));
+      _mm_storeu_si128((__m128i *)(sample + 32), _mm_blendv_epi8(w2, s2, m2));
+
+      if (!_mm_testz_si128(count, count))
+        tailIndex[numberOfUndecided++] = index;
+    }
+
+    numberOfBlocks = numberOfUndecided;
+  }
+
+  /* Produces the output for the groups that still have non-zero counters. */
+  for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+    __m128i count = _mm_loadu_si128((const __m128i *)(segmentation_map + tailIndex[b]));
+    _mm_storeu_si128((__m128i *)(segmentation_map + tailIndex[b]), _mm_andnot_si128(_mm_cmpeq_epi8(count, zero), foreground));
+  }
+}
+
+VIBE_TARGET_SSE41
+static void tailSearch_8u_P3R_sse41(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t channelSize,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+) {
+  const __m128i threshold = _mm_set1_epi16((short)vibe_threshold_8u_C3R(matchingThreshold));
+  const __m128i foreground = _mm_set1_epi8((char)COLOR_FOREGROUND);
+  const __m128i minusOne = _mm_set1_epi8(-1);
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t first;
+  uint32_t numberOfBlocks = tailBlocks(tailIndex, numberOfTails, numberOfPixels, 16, &first);
+
+  /* The pixels of the last, incomplete, group are processed one by one. */
+  tailSearch_8u_P3R_scalar(
+    image_data, swappingImage, historyBuffer, channelSize, planeSize, numberOfTests, numberOfPixels,
+    matchingThreshold, segmentation_map, tailIndex + first, numberOfTails - first, tailCounts
+  );
+
+  /* Sample plane by sample plane, on the groups with undecided pixels only. */
+  for (uint32_t i = 0; (i < numberOfTests) && (numberOfBlocks > 0); ++i) {
+    uint8_t *samples = historyBuffer + i * planeSize;
+    uint32_t numberOfUndecided = 0;
+
+    for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+      uint32_t index = tailIndex[b];
+      const uint8_t *pixels = image_data + 3 * index;
+      __m128i count = _mm_loadu_si128((const __m128i *)(segmentation_map + index));
+      __m128i decided = _mm_cmpeq_epi8(count, zero);
+      VIBE_COUNT(uint32_t undecided = 16 - __builtin_popcount(_mm_movemask_epi8(decided)); tailCounts->testedSamples += undecided; tailCounts->swappedSamples += undecided);
+      __m128i r, g, bl;
+
+      deinterleave_8u_C3R_sse41(
+        _mm_loadu_si128((const __m128i *)(pixels)),
+        _mm_loadu_si128((const __m128i *)(pixels + 16)),
+        _mm_loadu_si128((const __m128i *)(pixels + 32)),
+        &r, &g, &bl
+      );
+
+      /* Undecided pixels: one match less if close. */
+      __m128i notClose = notClose_8u_P3R_sse41(r, g, bl, samples + index, channelSize, threshold);
+      count = _mm_add_epi8(count, _mm_andnot_si128(_mm_or_si128(notClose, decided), minusOne));
+      _mm_storeu_si128((__m128i *)(segmentation_map + index), count);
+
+      /* The sample always goes to the history image. */
+      for (int c = 0; c < 3; ++c) {
+        uint8_t *sample = samples + c * channelSize + index;
+        uint8_t *swapping = swappingImage + c * channelSize + index;
+        __m128i s = _mm_loadu_si128((const __m128i *)(sample));
+        __m128i w = _mm_loadu_si128((const __m128i *)(swapping));
+
+        _mm_storeu_si128((__m128i *)(swapping), _mm_blendv_epi8(s, w, decided));
+        _mm_storeu_si128((__m128i *)(sample), _mm_blendv_epi8(w, s, decided));
+      }
+
+      if (!_mm_testz_si128(count, count))
+        tailIndex[numberOfUndecided++] = index;
+    }
+
+    numberOfBlocks = numberOfUndecided;
+  }
+
+  /* Produces the output for the groups that still have non-zero counters. */
+  for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+    __m128i count = _mm_loadu_si128((const __m128i *)(segmentation_map + tailIndex[b]));
+    _mm_storeu_si128((__m128i *)(segmentation_map + tailIndex[b]), _mm_andnot_si128(_mm_cmpeq_epi8(count, zero), foreground));
+  }
+}
+
+VIBE_TARGET_SSE41
+static void pack_8u1u_C1R_sse41(const uint8_t *segmentation_map, uint8_t *mask, uint32_t numberOfPixels)
+{
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t index = 0;
+
+  for (; index + 16 <= numberOfPixels; index += 16) {
+    __m128i map = _mm_loadu_si128((const __m128i *)(segmentation_map + index));
+    uint32_t bits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(map, zero));
+
+    mask[index / 8]     = (uint8_t)bits;
+    mask[index / 8 + 1] = (uint8_t)(bits >> 8);
+  }
+
+  pack_8u1u_C1R_scalar(segmentation_map + index, mask + index / 8, numberOfPixels - index);
+}
+
+VIBE_TARGET_SSE41
+static void convert_8u_C4C3R_sse41(const uint8_t *image_data, uint8_t *pixels, uint32_t numberOfPixels)
+{
+  /* The first 3 bytes of every pixel, at the beginning of the register. */
+  const __m128i drop = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  uint32_t index = 0;
+
+  for (; index + 16 <= numberOfPixels; index += 16) {
+    const __m128i *in = (const __m128i *)(image_data + 4 * index);
+    __m128i v0 = _mm_shuffle_epi8(_mm_loadu_si128(in), drop);
+    __m128i v1 = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), drop);
+    __m128i v2 = _mm_shuffle_epi8(_mm_loadu_si128(in + 2), drop);
+    __m128i v3 = _mm_shuffle_epi8(_mm_loadu_si128(in + 3), drop);
+    __m128i *out = (__m128i *)(pixels + 3 * index);
+
+    _mm_storeu_si128(out,     _mm_or_si128(v0, _mm_slli_si128(v1, 12)));
+    _mm_storeu_si128(out + 1, _mm_or_si128(_mm_srli_si128(v1, 4), _mm_slli_si128(v2, 8)));
+    _mm_storeu_si128(out + 2, _mm_or_si128(_mm_srli_si128(v2, 8), _mm_slli_si128(v3, 4)));
+  }
+
+  convert_8u_C4C3R_scalar(image_data + 4 * index, pixels + 3 * index, numberOfPixels - index);
+}
+
+VIBE_TARGET_SSE41
+static void sums_8u_sse41(const uint8_t *data, uint32_t n, uint16_t *sums)
+{
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t i = 0;
+
+  /* Two sums of 8 bytes per register, in the low words of its 64-bit halves. */
+  for (; i + 32 <= n; i += 32) {
+    __m128i s0 = _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(data + i)), zero);
+    __m128i s1 = _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(data + i + 16)), zero);
+
+    _mm_storel_epi64((__m128i *)(sums + i / 8), _mm_packus_epi32(_mm_packus_epi32(s0, s1), zero));
+  }
+
+  sums_8u_scalar(data + i, n - i, sums + i / 8);
+}
+
+VIBE_TARGET_SSE41
+static void noise_8u_sse41(const uint8_t *data, uint8_t *samples, uint32_t n, uint32_t key, uint32_t first)
+{
+  const __m128i ten = _mm_set1_epi8(10);
+  __m128i counter = _mm_add_epi32(_mm_set1_epi32(key + first / 4), _mm_setr_epi32(0, 1, 2, 3));
+  uint32_t i = 0;
+
+  for (; i + 16 <= n; i += 16, counter = _mm_add_epi32(counter, _mm_set1_epi32(4))) {
+    /* vibe_hash_32u of 4 groups of 4 bytes. */
+    __m128i h = _mm_xor_si128(counter, _mm_srli_epi32(counter, 16));
+    h = _mm_mullo_epi32(h, _mm_set1_epi32(0x7FEB352D));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+    h = _mm_mullo_epi32(h, _mm_set1_epi32((int32_t)0x846CA68Bu));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+
+    /* (byte * 20) >> 8 in the low and high bytes of the words. */
+    __m128i low = _mm_mulhi_epu16(_mm_and_si128(h, _mm_set1_epi16(0x00FF)), _mm_set1_epi16(20 << 8));
+    __m128i high = _mm_mulhi_epu16(_mm_and_si128(h, _mm_set1_epi16((int16_t)0xFF00)), _mm_set1_epi16(20));
+    __m128i noise = _mm_or_si128(low, _mm_slli_epi16(high, 8));
+
+    /* Value + noise - 10, saturated: one of the two terms is zero. */
+    __m128i value = _mm_loadu_si128((const __m128i *)(data + i));
+    value = _mm_adds_epu8(value, _mm_subs_epu8(noise, ten));
+    value = _mm_subs_epu8(value, _mm_subs_epu8(ten, noise));
+
+    _mm_storeu_si128((__m128i *)(samples + i), value);
+  }
+
+  noise_8u_scalar(data + i, samples + i, n - i, key, first + i);
+}
+
+VIBE_TARGET_SSE41
+static uint32_t matches_8u_Q3R_sse41(const uint16_t *samples, uint32_t numberOfSamples, const uint8_t *pixel, int32_t threshold, uint32_t greenBits)
+{
+  const __m128i low5 = _mm_set1_epi16(31);
+  const __m128i center = _mm_set1_epi16(4);
+  const __m128i greenMask = _mm_set1_epi16((int16_t)((1 << greenBits) - 1));
+  const __m128i greenCenter = _mm_set1_epi16((int16_t)(1 << (7 - greenBits)));
+  const __m128i redShift = _mm_cvtsi32_si128(5 + greenBits);
+  const __m128i greenShift = _mm_cvtsi32_si128(8 - greenBits);
+  const __m128i r = _mm_set1_epi16(pixel[0]);
+  const __m128i g = _mm_set1_epi16(pixel[1]);
+  const __m128i b = _mm_set1_epi16(pixel[2]);
+  const __m128i limit = _mm_set1_epi16((int16_t)(threshold + 1));
+  uint32_t matches = 0;
+  uint32_t i = 0;
+
+  for (; i + 8 <= numberOfSamples; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(samples + i));
+
+    /* Centers of the bins of the 8 samples, one channel per register. */
+    __m128i sr = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(_mm_srl_epi16(v, redShift), low5), 3), center);
+    __m128i sg = _mm_or_si128(_mm_sll_epi16(_mm_and_si128(_mm_srli_epi16(v, 5), greenMask), greenShift), greenCenter);
+    __m128i sb = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, low5), 3), center);
+
+    __m128i sum = _mm_add_epi16(_mm_abs_epi16(_mm_sub_epi16(sr, r)), _mm_abs_epi16(_mm_sub_epi16(sg, g)));
+    sum = _mm_add_epi16(sum, _mm_abs_epi16(_mm_sub_epi16(sb, b)));
+
+    __m128i close = _mm_cmpgt_epi16(limit, sum);
+    matches |= (uint32_t)(_mm_movemask_epi8(_mm_packs_epi16(close, close)) & 0xFF) << i;
+  }
+
+  if (i < numberOfSamples)
+    matches |= matches_8u_Q3R_scalar(samples + i, numberOfSamples - i, pixel, threshold, greenBits) << i;
+
+  return(matches);
+}
+
+static const vibeKernels_t kernels_sse41 = {
+  VIBE_SIMD_SSE41,
+  historyCount_8u_C1R_sse41,
+  historyCount_8u_C3R_sse41,
+  historyCount_8u_P3R_sse41,
+  deinterleave_8u_C3P3R_sse41,
+  tailSearch_8u_C1R_sse41,
+  tailSearch_8u_C3R_sse41,
+  tailSearch_8u_P3R_sse41,
+  pack_8u1u_C1R_sse41,
+  historyCount_16u_C1R_sse41,
+  historyCount_16u_C3R_sse41,
+  convert_8u_C4C3R_sse41,
+  historyCount_8u_420_sse41,
+  sums_8u_sse41,
+  noise_8u_sse41,
+  matches_8u_Q3R_sse41
+};
+
+#endif /* VIBE_DISABLE_SSE41 */
+
+// -----------------------------------------------------------------------------
+// AVX2 kernels
+// -----------------------------------------------------------------------------
+#ifndef VIBE_DISABLE_AVX2
+
+#define VIBE_TARGET_AVX2 __attribute__((target("avx2")))
+
+VIBE_TARGET_AVX2
+static inline __m256i absdiff_epu8_avx2(__m256i a, __m256i b)
+{
+  return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+}
+
+/* Appends the indices of the pixels whose counter is not zero. */
+VIBE_TARGET_AVX2
+static inline uint32_t collectTails_avx2(__m256i count, uint32_t index, uint32_t *tailIndex, uint32_t numberOfTails)
+{
+  uint32_t bits = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(count, _mm256_setzero_si256()));
+
+  for (; bits != 0; bits &= bits - 1)
+    tailIndex[numberOfTails++] = index + __builtin_ctz(bits);
+
+  return(numberOfTails);
+}
+
+/* Returns 0xFF where |a - b| <= threshold, 0x00 otherwise. */
+VIBE_TARGET_AVX2
+static inline __m256i close_8u_C1R_avx2(__m256i a, const uint8_t *b, __m256i threshold)
+{
+  __m256i d = absdiff_epu8_avx2(a, _mm256_loadu_si256((const __m256i *)b));
+  return _mm256_cmpeq_epi8(_mm256_subs_epu8(d, threshold), _mm256_setzero_si256());
+}
+
+/* Loads 32 RGB pixels so that each 128-bit lane holds 16 consecutive pixels. */
+VIBE_TARGET_AVX2
+static inline void load_8u_C3R_avx2(const uint8_t *p, __m256i *v0, __m256i *v1, __m256i *v2)
+{
+  *v0 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(p))), _mm_loadu_si128((const __m128i *)(p + 48)), 1);
+  *v1 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(p + 16))), _mm_loadu_si128((const __m128i *)(p + 64)), 1);
+  *v2 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(p + 32))), _mm_loadu_si128((const __m128i *)(p + 80)), 1);
+}
+
+VIBE_TARGET_AVX2
+static inline __m256i shuffle2_avx2(__m256i v, __m128i mask)
+{
+  return _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(mask));
+}
+
+/* Splits 32 RGB pixels loaded by load_8u_C3R_avx2 into three planes (in pixel order). */
+VIBE_TARGET_AVX2
+static inline void deinterleave_8u_C3R_avx2(__m256i v0, __m256i v1, __m256i v2, __m256i *r, __m256i *g, __m256i *b)
+{
+  *r = _mm256_or_si256(
+    _mm256_or_si256(
+      shuffle2_avx2(v0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      shuffle2_avx2(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1))
+    ),
+    shuffle2_avx2(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13))
+  );
+  *g = _mm256_or_si256(
+    _mm256_or_si256(
+      shuffle2_avx2(v0, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      shuffle2_avx2(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))
+    ),
+    shuffle2_avx2(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14))
+  );
+  *b = _mm256_or_si256(
+    _mm256_or_si256(
+      shuffle2_avx2(v0, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      shuffle2_avx2(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))
+    ),
+    shuffle2_avx2(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15))
+  );
+}
+
+/* Stores 32 RGB pixels in the order used by load_8u_C3R_avx2. */
+VIBE_TARGET_AVX2
+static inline void store_8u_C3R_avx2(uint8_t *p, __m256i v0, __m256i v1, __m256i v2)
+{
+  _mm_storeu_si128((__m128i *)(p),      _mm256_castsi256_si128(v0));
+  _mm_storeu_si128((__m128i *)(p + 16), _mm256_castsi256_si128(v1));
+  _mm_storeu_si128((__m128i *)(p + 32), _mm256_castsi256_si128(v2));
+  _mm_storeu_si128((__m128i *)(p + 48), _mm256_extracti128_si256(v0, 1));
+  _mm_storeu_si128((__m128i *)(p + 64), _mm256_extracti128_si256(v1, 1));
+  _mm_storeu_si128((__m128i *)(p + 80), _mm256_extracti128_si256(v2, 1));
+}
+
+/* Repeats every byte of a per-pixel mask three times, to match 32 RGB pixels loaded by load_8u_C3R_avx2. */
+VIBE_TARGET_AVX2
+static inline void expand_8u_C3R_avx2(__m256i m, __m256i *m0, __m256i *m1, __m256i *m2)
+{
+  *m0 = shuffle2_avx2(m, _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5));
+  *m1 = shuffle2_avx2(m, _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10));
+  *m2 = shuffle2_avx2(m, _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15));
+}
+
+/* Sums the three planes of differences on 16 bits; returns 0xFF where the sum is above the threshold.
+ * Unpack and pack are both in-lane, so the pixel order is preserved.
+ */
+VIBE_TARGET_AVX2
+static inline __m256i notClose_sum_avx2(__m256i r, __m256i g, __m256i b, __m256i threshold)
+{
+  const __m256i zero = _mm256_setzero_si256();
+
+  __m256i sumLo = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpacklo_epi8(r, zero), _mm256_unpacklo_epi8(g, zero)), _mm256_unpacklo_epi8(b, zero));
+  __m256i sumHi = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpackhi_epi8(r, zero), _mm256_unpackhi_epi8(g, zero)), _mm256_unpackhi_epi8(b, zero));
+
+  return _mm256_packs_epi16(_mm256_cmpgt_epi16(sumLo, threshold), _mm256_cmpgt_epi16(sumHi, threshold));
+}
+
+/* Returns 0xFF for the pixels of (a0, a1, a2) that are NOT close to the 32 pixels at b, 0x00 otherwise. */
+VIBE_TARGET_AVX2
+static inline __m256i notClose_8u_C3R_avx2(
+  __m256i a0, __m256i a1, __m256i a2,
+  const uint8_t *b, __m256i threshold
+) {
+  __m256i b0, b1, b2;
+
+  load_8u_C3R_avx2(b, &b0, &b1, &b2);
+
+  __m256i d0 = absdiff_epu8_avx2(a0, b0);
+  __m256i d1 = absdiff_epu8_avx2(a1, b1);
+  __m256i d2 = absdiff_epu8_avx2(a2, b2);
+
+  __m256i r, g, bl;
+  deinterleave_8u_C3R_avx2(d0, d1, d2, &r, &g, &bl);
+
+  return notClose_sum_avx2(r, g, bl, threshold);
+}
+
+/* Returns 0xFF for the pixels of (r, g, b) that are NOT close to the 32 pixels of the planes at p, 0x00 otherwise. */
+VIBE_TARGET_AVX2
+static inline __m256i notClose_8u_P3R_avx2(__m256i r, __m256i g, __m256i b, const uint8_t *p, size_t channelSize, __m256i threshold)
+{
+  return notClose_sum_avx2(
+    absdiff_epu8_avx2(r, _mm256_loadu_si256((const __m256i *)(p))),
+    absdiff_epu8_avx2(g, _mm256_loadu_si256((const __m256i *)(p + channelSize))),
+    absdiff_epu8_avx2(b, _mm256_loadu_si256((const __m256i *)(p + 2 * channelSize))),
+    threshold
+  );
+}
+
+VIBE_TARGET_AVX2
+static inline __m256i absdiff_epu16_avx2(__m256i a, __m256i b)
+{
+  return _mm256_or_si256(_mm256_subs_epu16(a, b), _mm256_subs_epu16(b, a));
+}
+
+/* Returns 0xFFFF where |a - b| <= threshold, 0x0000 otherwise (16 samples of 16 bits). */
+VIBE_TARGET_AVX2
+static inline __m256i close_16u_C1R_avx2(__m256i a, const uint16_t *b, __m256i threshold)
+{
+  __m256i d = absdiff_epu16_avx2(a, _mm256_loadu_si256((const __m256i *)b));
+  return _mm256_cmpeq_epi16(_mm256_subs_epu16(d, threshold), _mm256_setzero_si256());
+}
+
+/* Splits 16 RGB pixels of 16-bit samples loaded by load_8u_C3R_avx2 (8 pixels per lane) into three planes. */
+VIBE_TARGET_AVX2
+static inline void deinterleave_16u_C3R_avx2(__m256i v0, __m256i v1, __m256i v2, __m256i *r, __m256i *g, __m256i *b)
+{
+  *r = _mm256_or_si256(
+    _mm256_or_si256(
+      shuffle2_avx2(v0, _mm_setr_epi8(0, 1, 6, 7, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      shuffle2_avx2(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 3, 8, 9, 14, 15, -1, -1, -1, -1))
+    ),
+    shuffle2_avx2(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 4, 5, 10, 11))
+  );
+  *g = _mm256_or_si256(
+    _mm256_or_si256(
+      shuffle2_avx2(v0, _mm_setr_epi8(2, 3, 8, 9, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      shuffle2_avx2(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 4, 5, 10, 11, -1, -1, -1, -1, -1, -1))
+    ),
+    shuffle2_avx2(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 6, 7, 12, 13))
+  );
+  *b = _mm256_or_si256(
+    _mm256_or_si256(
+      shuffle2_avx2(v0, _mm_setr_epi8(4, 5, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+      shuffle2_avx2(v1, _mm_setr_epi8(-1, -1, -1, -1, 0, 1, 6, 7, 12, 13, -1, -1, -1, -1, -1, -1))
+    ),
+    shuffle2_avx2(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 3, 8, 9, 14, 15))
+  );
+}
+
+/* Returns 0xFFFF for the 16 RGB pixels (a0, a1, a2), loaded by load_8u_C3R_avx2, that are close to the 16 pixels at b
+ * (saturated sums, as in close_16u_C3R_sse41).
+ */
+VIBE_TARGET_AVX2
+static inline __m256i close_16u_C3R_avx2(__m256i a0, __m256i a1, __m256i a2, const uint16_t *b, __m256i threshold)
+{
+  __m256i b0, b1, b2, r, g, bl;
+
+  load_8u_C3R_avx2((const uint8_t *)b, &b0, &b1, &b2);
+  deinterleave_16u_C3R_avx2(absdiff_epu16_avx2(a0, b0), absdiff_epu16_avx2(a1, b1), absdiff_epu16_avx2(a2, b2), &r, &g, &bl);
+
+  return _mm256_cmpeq_epi16(_mm256_subs_epu16(_mm256_adds_epu16(_mm256_adds_epu16(r, g), bl), threshold), _mm256_setzero_si256());
+}
+
+VIBE_TARGET_AVX2
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_C1R_avx2_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  const __m256i threshold = _mm256_set1_epi8((char)((matchingThreshold > 255) ? 255 : matchingThreshold));
+  const __m256i initial = _mm256_set1_epi8((char)matchingNumber);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 32 <= numberOfPixels; index += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(image_data + index));
+
+    /* matchingNumber minus one per close historyImage (wrapping, as the reference code). */
+    __m256i count = _mm256_add_epi8(initial, close_8u_C1R_avx2(a, historyImage + index, threshold));
+
+    for (uint32_t i = 1; i < numberOfHistoryImages; ++i)
+      count = _mm256_add_epi8(count, close_8u_C1R_avx2(a, historyImage + i * planeSize + index, threshold));
+
+    _mm256_storeu_si256((__m256i *)(counts + index), count);
+
+    numberOfTails = collectTails_avx2(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_8u_C1R_scalar(
+      image_data + index, historyImage + index, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+
+VIBE_TARGET_AVX2
+static uint32_t historyCount_8u_C1R_avx2(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_C1R_avx2_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+VIBE_TARGET_AVX2
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_C3R_avx2_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  const __m256i threshold = _mm256_set1_epi16((short)vibe_threshold_8u_C3R(matchingThreshold));
+  const __m256i initial = _mm256_set1_epi8((char)(matchingNumber - 1));
+  const __m256i minusOne = _mm256_set1_epi8(-1);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 32 <= numberOfPixels; index += 32) {
+    __m256i a0, a1, a2;
+    load_8u_C3R_avx2(image_data + 3 * index, &a0, &a1, &a2);
+
+    /* First historyImage: matchingNumber - 1, or matchingNumber if not close. */
+    __m256i count = _mm256_sub_epi8(initial, notClose_8u_C3R_avx2(a0, a1, a2, historyImage + 3 * index, threshold));
+
+    /* Next historyImages: one less if close. */
+    for (uint32_t i = 1; i < numberOfHistoryImages; ++i) {
+      __m256i notClose = notClose_8u_C3R_avx2(a0, a1, a2, historyImage + i * planeSize + 3 * index, threshold);
+      count = _mm256_sub_epi8(_mm256_add_epi8(count, minusOne), notClose);
+    }
+
+    _mm256_storeu_si256((__m256i *)(counts + index), count);
+    numberOfTails = collectTails_avx2(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_8u_C3R_scalar(
+      image_data + 3 * index, historyImage + 3 * index, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+
+VIBE_TARGET_AVX2
+static uint32_t historyCount_8u_C3R_avx2(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_C3R_avx2_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+VIBE_TARGET_AVX2
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_P3R_avx2_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t channelSize,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  const __m256i threshold = _mm256_set1_epi16((short)vibe_threshold_8u_C3R(matchingThreshold));
+  const __m256i initial = _mm256_set1_epi8((char)(matchingNumber - 1));
+  const __m256i minusOne = _mm256_set1_epi8(-1);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 32 <= numberOfPixels; index += 32) {
+    __m256i v0, v1, v2, r, g, b;
+    __m256i count = initial;
+
+    load_8u_C3R_avx2(image_data + 3 * index, &v0, &v1, &v2);
+    deinterleave_8u_C3R_avx2(v0, v1, v2, &r, &g, &b);
+
+    for (uint32_t i = 0; i < numberOfHistoryImages; ++i) {
+      __m256i notClose = notClose_8u_P3R_avx2(r, g, b, historyImage + i * planeSize + index, channelSize, threshold);
+
+      /* First historyImage: matchingNumber - 1 or matchingNumber; next ones: one less if close. */
+      count = (i == 0) ? _mm256_sub_epi8(count, notClose) : _mm256_sub_epi8(_mm256_add_epi8(count, minusOne), notClose);
+    }
+
+    _mm256_storeu_si256((__m256i *)(counts + index), count);
+    numberOfTails = collectTails_avx2(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_8u_P3R_scalar(
+      image_data + 3 * index, historyImage + index, channelSize, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+
+VIBE_TARGET_AVX2
+static uint32_t historyCount_8u_P3R_avx2(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t channelSize,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_P3R_avx2_n,
+    image_data, historyImage, channelSize, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+VIBE_TARGET_AVX2
+static VIBE_FORCE_INLINE uint32_t historyCount_16u_C1R_avx2_n(
+  uint32_t numberOfHistoryImages,
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  const __m256i threshold = _mm256_set1_epi16((short)((matchingThreshold > 65535) ? 65535 : matchingThreshold));
+  const __m256i initial = _mm256_set1_epi8((char)matchingNumber);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 32 <= numberOfPixels; index += 32) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i *)(image_data + index));
+    __m256i a1 = _mm256_loadu_si256((const __m256i *)(image_data + index + 16));
+    __m256i sum = _mm256_setzero_si256();
+
+    /* The in-lane pack interleaves the pixels by groups of 8: they are put back in order once, at the end. */
+    for (uint32_t i = 0; i < numberOfHistoryImages; ++i) {
+      const uint16_t *p = historyImage + i * planeSize + index;
+      sum = _mm256_add_epi8(sum, _mm256_packs_epi16(close_16u_C1R_avx2(a0, p, threshold), close_16u_C1R_avx2(a1, p + 16, threshold)));
+    }
+
+    __m256i count = _mm256_add_epi8(initial, _mm256_permute4x64_epi64(sum, 0xD8));
+    _mm256_storeu_si256((__m256i *)(counts + index), count);
+
+    numberOfTails = collectTails_avx2(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_16u_C1R_scalar(
+      image_data + index, historyImage + index, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+VIBE_TARGET_AVX2
+static uint32_t historyCount_16u_C1R_avx2(
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_16u_C1R_avx2_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+VIBE_TARGET_AVX2
+static VIBE_FORCE_INLINE uint32_t historyCount_16u_C3R_avx2_n(
+  uint32_t numberOfHistoryImages,
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  int32_t bound = vibe_threshold_16u_C3R(matchingThreshold);
+
+  /* The saturated sums cannot be compared with the largest thresholds. */
+  if (bound >= 65535)
+    return historyCount_16u_C3R_scalar(image_data, historyImage, planeSize, numberOfHistoryImages, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex);
+
+  const __m256i threshold = _mm256_set1_epi16((short)bound);
+  const __m256i initial = _mm256_set1_epi8((char)matchingNumber);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 32 <= numberOfPixels; index += 32) {
+    const uint16_t *pixels = image_data + 3 * index;
+    __m256i a[6];
+    __m256i sum = _mm256_setzero_si256();
+
+    load_8u_C3R_avx2((const uint8_t *)(pixels), &a[0], &a[1], &a[2]);
+    load_8u_C3R_avx2((const uint8_t *)(pixels + 48), &a[3], &a[4], &a[5]);
+
+    for (uint32_t i = 0; i < numberOfHistoryImages; ++i) {
+      const uint16_t *p = historyImage + i * planeSize + 3 * index;
+      sum = _mm256_add_epi8(sum, _mm256_packs_epi16(
+        close_16u_C3R_avx2(a[0], a[1], a[2], p, threshold),
+        close_16u_C3R_avx2(a[3], a[4], a[5], p + 48, threshold)
+      ));
+    }
+
+    __m256i count = _mm256_add_epi8(initial, _mm256_permute4x64_epi64(sum, 0xD8));
+    _mm256_storeu_si256((__m256i *)(counts + index), count);
+
+    numberOfTails = collectTails_avx2(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_16u_C3R_scalar(
+      image_data + 3 * index, historyImage + 3 * index, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+VIBE_TARGET_AVX2
+static uint32_t historyCount_16u_C3R_avx2(
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_16u_C3R_avx2_n,
+    image_data, historyImage, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+/* Returns 0xFF for the 32 pixels (y, uv) that are NOT close to the luma and chroma samples at p and q, 0x00 otherwise.
+ * All the operations are in-lane: each lane holds 16 pixels and their 8 chroma pairs.
+ */
+VIBE_TARGET_AVX2
+static inline __m256i notClose_8u_420_avx2(__m256i y, __m256i uv, const uint8_t *p, const uint8_t *q, __m256i threshold)
+{
+  const __m256i zero = _mm256_setzero_si256();
+
+  __m256i dy = absdiff_epu8_avx2(y, _mm256_loadu_si256((const __m256i *)p));
+  __m256i duv = absdiff_epu8_avx2(uv, _mm256_loadu_si256((const __m256i *)q));
+  __m256i c = _mm256_maddubs_epi16(duv, _mm256_set1_epi8(1));
+
+  __m256i sumLo = _mm256_add_epi16(_mm256_unpacklo_epi8(dy, zero), _mm256_unpacklo_epi16(c, c));
+  __m256i sumHi = _mm256_add_epi16(_mm256_unpackhi_epi8(dy, zero), _mm256_unpackhi_epi16(c, c));
+
+  return _mm256_packs_epi16(_mm256_cmpgt_epi16(sumLo, threshold), _mm256_cmpgt_epi16(sumHi, threshold));
+}
+
+VIBE_TARGET_AVX2
+static VIBE_FORCE_INLINE uint32_t historyCount_8u_420_avx2_n(
+  uint32_t numberOfHistoryImages,
+  const uint8_t *luma,
+  const uint8_t *chroma,
+  const uint8_t *historyLuma,
+  const uint8_t *historyChroma,
+  size_t planeSize,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  const __m256i threshold = _mm256_set1_epi16((short)vibe_threshold_8u_C3R(matchingThreshold));
+  const __m256i initial = _mm256_set1_epi8((char)(matchingNumber - 1));
+  const __m256i minusOne = _mm256_set1_epi8(-1);
+  uint32_t numberOfTails = 0;
+  uint32_t index = 0;
+
+  for (; index + 32 <= numberOfPixels; index += 32) {
+    __m256i y = _mm256_loadu_si256((const __m256i *)(luma + index));
+    __m256i uv = _mm256_loadu_si256((const __m256i *)(chroma + index));
+
+    /* First historyImage: matchingNumber - 1, or matchingNumber if not close. */
+    __m256i count = _mm256_sub_epi8(initial, notClose_8u_420_avx2(y, uv, historyLuma + index, historyChroma + index, threshold));
+
+    /* Next historyImages: one less if close. */
+    for (uint32_t i = 1; i < numberOfHistoryImages; ++i) {
+      __m256i notClose = notClose_8u_420_avx2(y, uv, historyLuma + i * planeSize + index, historyChroma + i * planeSize + index, threshold);
+      count = _mm256_sub_epi8(_mm256_add_epi8(count, minusOne), notClose);
+    }
+
+    _mm256_storeu_si256((__m256i *)(counts + index), count);
+    numberOfTails = collectTails_avx2(count, index, tailIndex, numberOfTails);
+  }
+
+  if (index < numberOfPixels) {
+    uint32_t n = historyCount_8u_420_scalar(
+      luma + index, chroma + index, historyLuma + index, historyChroma + index, planeSize, numberOfHistoryImages,
+      numberOfPixels - index, matchingNumber, matchingThreshold, counts + index, tailIndex + numberOfTails
+    );
+    numberOfTails += offsetTails(tailIndex + numberOfTails, n, index);
+  }
+
+  return(numberOfTails);
+}
+
+VIBE_TARGET_AVX2
+static uint32_t historyCount_8u_420_avx2(
+  const uint8_t *luma,
+  const uint8_t *chroma,
+  const uint8_t *historyLuma,
+  const uint8_t *historyChroma,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+) {
+  VIBE_SPECIALIZE_HISTORY_IMAGES(
+    historyCount_8u_420_avx2_n,
+    luma, chroma, historyLuma, historyChroma, planeSize, numberOfPixels, matchingNumber, matchingThreshold, counts, tailIndex
+  );
+}
+
+VIBE_TARGET_AVX2
+static void deinterleave_8u_C3P3R_avx2(
+  const uint8_t *image_data,
+  uint8_t *image_planes,
+  size_t channelSize,
+  uint32_t numberOfPixels
+) {
+  uint32_t index = 0;
+
+  for (; index + 32 <= numberOfPixels; index += 32) {
+    __m256i v0, v1, v2, r, g, b;
+
+    load_8u_C3R_avx2(image_data + 3 * index, &v0, &v1, &v2);
+    deinterleave_8u_C3R_avx2(v0, v1, v2, &r, &g, &b);
+
+    _mm256_storeu_si256((__m256i *)(image_planes + index), r);
+    _mm256_storeu_si256((__m256i *)(image_planes + channelSize + index), g);
+    _mm256_storeu_si256((__m256i *)(image_planes + 2 * channelSize + index), b);
+  }
+
+  deinterleave_8u_C3P3R_scalar(image_data + 3 * index, image_planes + index, channelSize, numberOfPixels - index);
+}
+
+VIBE_TARGET_AVX2
+static void tailSearch_8u_C1R_avx2(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+) {
+  const __m256i threshold = _mm256_set1_epi8((char)((matchingThreshold > 255) ? 255 : matchingThreshold));
+  const __m256i foreground = _mm256_set1_epi8((char)COLOR_FOREGROUND);
+  const __m256i zero = _mm256_setzero_si256();
+  uint32_t first;
+  uint32_t numberOfBlocks = tailBlocks(tailIndex, numberOfTails, numberOfPixels, 32, &first);
+
+  /* The pixels of the last, incomplete, group are processed one by one. */
+  tailSearch_8u_C1R_scalar(
+    image_data, swappingImage, historyBuffer, planeSize, numberOfTests, numberOfPixels,
+    matchingThreshold, segmentation_map, tailIndex + first, numberOfTails - first, tailCounts
+  );
+
+  /* Sample plane by sample plane, on the groups with undecided pixels only. */
+  for (uint32_t i = 0; (i < numberOfTests) && (numberOfBlocks > 0); ++i) {
+    uint8_t *samples = historyBuffer + i * planeSize;
+    uint32_t numberOfUndecided = 0;
+
+    for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+      uint32_t index = tailIndex[b];
+      __m256i count = _mm256_loadu_si256((const __m256i *)(segmentation_map + index));
+      __m256i sample = _mm256_loadu_si256((const __m256i *)(samples + index));
+      __m256i d = absdiff_epu8_avx2(_mm256_loadu_si256((const __m256i *)(image_data + index)), sample);
+
+      VIBE_COUNT(tailCounts->testedSamples += 32 - __builtin_popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(count, zero))));
+
+      /* Undecided pixels with a matching sample: one match less, and the sample goes to the history image. */
+      __m256i match = _mm256_andnot_si256(_mm256_cmpeq_epi8(count, zero), _mm256_cmpeq_epi8(_mm256_subs_epu8(d, threshold), zero));
+
+      if (!_mm256_testz_si256(match, match)) {
+        __m256i swapping = _mm256_loadu_si256((const __m256i *)(swappingImage + index));
+
+        VIBE_COUNT(tailCounts->swappedSamples += __builtin_popcount((uint32_t)_mm256_movemask_epi8(match)));
+
+        count = _mm256_add_epi8(count, match);
+        _mm256_storeu_si256((__m256i *)(segmentation_map + index), count);
+        _mm256_storeu_si256((__m256i *)(swappingImage + index), _mm256_blendv_epi8(swapping, sample, match));
+        _mm256_storeu_si256((__m256i *)(samples + index), _mm256_blendv_epi8(sample, swapping, match));
+      }
+
+      if (!_mm256_testz_si256(count, count))
+        tailIndex[numberOfUndecided++] = index;
+    }
+
+    numberOfBlocks = numberOfUndecided;
+  }
+
+  /* Produces the output for the groups that still have non-zero counters. */
+  for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+    __m256i count = _mm256_loadu_si256((const __m256i *)(segmentation_map + tailIndex[b]));
+    _mm256_storeu_si256((__m256i *)(segmentation_map + tailIndex[b]), _mm256_andnot_si256(_mm256_cmpeq_epi8(count, zero), foreground));
+  }
+}
+
+VIBE_TARGET_AVX2
+static void tailSearch_8u_C3R_avx2(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+) {
+  const __m256i threshold = _mm256_set1_epi16((short)vibe_threshold_8u_C3R(matchingThreshold));
+  const __m256i foreground = _mm256_set1_epi8((char)COLOR_FOREGROUND);
+  const __m256i minusOne = _mm256_set1_epi8(-1);
+  const __m256i zero = _mm256_setzero_si256();
+  uint32_t first;
+  uint32_t numberOfBlocks = tailBlocks(tailIndex, numberOfTails, numberOfPixels, 32, &first);
+
+  /* The pixels of the last, incomplete, group are processed one by one. */
+  tailSearch_8u_C3R_scalar(
+    image_data, swappingImage, historyBuffer, planeSize, numberOfTests, numberOfPixels,
+    matchingThreshold, segmentation_map, tailIndex + first, numberOfTails - first, tailCounts
+  );
+
+  /* Sample plane by sample plane, on the groups with undecided pixels only. */
+  for (uint32_t i = 0; (i < numberOfTests) && (numberOfBlocks > 0); ++i) {
+    uint8_t *samples = historyBuffer + i * planeSize;
+    uint32_t numberOfUndecided = 0;
+
+    for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+      uint32_t index = tailIndex[b];
+      uint8_t *sample = samples + 3 * index;
+      uint8_t *swapping = swappingImage + 3 * index;
+
+      __m256i count = _mm256_loadu_si256((const __m256i *)(segmentation_map + index));
+      __m256i decided = _mm256_cmpeq_epi8(count, zero);
+      VIBE_COUNT(uint32_t undecided = 32 - __builtin_popcount((uint32_t)_mm256_movemask_epi8(decided)); tailCounts->testedSamples += undecided; tailCounts->swappedSamples += undecided);
+      __m256i a0, a1, a2, s0, s1, s2, w0, w1, w2, r, g, bl, m0, m1, m2;
+
+      load_8u_C3R_avx2(image_data + 3 * index, &a0, &a1, &a2);
+      load_8u_C3R_avx2(sample, &s0, &s1, &s2);
+      load_8u_C3R_avx2(swapping, &w0, &w1, &w2);
+      deinterleave_8u_C3R_avx2(absdiff_epu8_avx2(a0, s0), absdiff_epu8_avx2(a1, s1), absdiff_epu8_avx2(a2, s2), &r, &g, &bl);
+
+      /* Undecided pixels: one match less if close; the sample always goes to the history image. */
+      count = _mm256_add_epi8(count, _mm256_andnot_si256(_mm256_or_si256(notClose_sum_avx2(r, g, bl, threshold), decided), minusOne));
+      _mm256_storeu_si256((__m256i *)(segmentation_map + index), count);
+
+      expand_8u_C3R_avx2(decided, &m0, &m1, &m2);
+      store_8u_C3R_avx2(swapping, _mm256_blendv_epi8(s0, w0, m0), _mm256_blendv_epi8(s1, w1, m1), _mm256_blendv_epi8(s2, w2, m2));
+      store_8u_C3R_avx2(sample, _mm256_blendv_epi8(w0, s0, m0), _mm256_blendv_epi8(w1, s1, m1), _mm256_blendv_epi8(w2, s2, m2));
+
+      if (!_mm256_testz_si256(count, count))
+        tailIndex[numberOfUndecided++] = index;
+    }
+
+    numberOfBlocks = numberOfUndecided;
+  }
+
+  /* Produces the output for the groups that still have non-zero counters. */
+  for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+    __m256i count = _mm256_loadu_si256((const __m256i *)(segmentation_map + tailIndex[b]));
+    _mm256_storeu_si256((__m256i *)(segmentation_map + tailIndex[b]), _mm256_andnot_si256(_mm256_cmpeq_epi8(count, zero), foreground));
+  }
+}
+
+VIBE_TARGET_AVX2
+static void tailSearch_8u_P3R_avx2(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t channelSize,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+) {
+  const __m256i threshold = _mm256_set1_epi16((short)vibe_threshold_8u_C3R(matchingThreshold));
+  const __m256i foreground = _mm256_set1_epi8((char)COLOR_FOREGROUND);
+  const __m256i minusOne = _mm256_set1_epi8(-1);
+  const __m256i zero = _mm256_setzero_si256();
+  uint32_t first;
+  uint32_t numberOfBlocks = tailBlocks(tailIndex, numberOfTails, numberOfPixels, 32, &first);
+
+  /* The pixels of the last, incomplete, group are processed one by one. */
+  tailSearch_8u_P3R_scalar(
+    image_data, swappingImage, historyBuffer, channelSize, planeSize, numberOfTests, numberOfPixels,
+    matchingThreshold, segmentation_map, tailIndex + first, numberOfTails - first, tailCounts
+  );
+
+  /* Sample plane by sample plane, on the groups with undecided pixels only. */
+  for (uint32_t i = 0; (i < numberOfTests) && (numberOfBlocks > 0); ++i) {
+    uint8_t *samples = historyBuffer + i * planeSize;
+    uint32_t numberOfUndecided = 0;
+
+    for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+      uint32_t index = tailIndex[b];
+      __m256i count = _mm256_loadu_si256((const __m256i *)(segmentation_map + index));
+      __m256i decided = _mm256_cmpeq_epi8(count, zero);
+      VIBE_COUNT(uint32_t undecided = 32 - __builtin_popcount((uint32_t)_mm256_movemask_epi8(decided)); tailCounts->testedSamples += undecided; tailCounts->swappedSamples += undecided);
+      __m256i v0, v1, v2, r, g, bl;
+
+      load_8u_C3R_avx2(image_data + 3 * index, &v0, &v1, &v2);
+      deinterleave_8u_C3R_avx2(v0, v1, v2, &r, &g, &bl);
+
+      /* Undecided pixels: one match less if close. */
+      __m256i notClose = notClose_8u_P3R_avx2(r, g, bl, samples + index, channelSize, threshold);
+      count = _mm256_add_epi8(count, _mm256_andnot_si256(_mm256_or_si256(notClose, decided), minusOne));
+      _mm256_storeu_si256((__m256i *)(segmentation_map + index), count);
+
+      /* The sample always goes to the history image. */
+      for (int c = 0; c < 3; ++c) {
+        uint8_t *sample = samples + c * channelSize + index;
+        uint8_t *swapping = swappingImage + c * channelSize + index;
+        __m256i s = _mm256_loadu_si256((const __m256i *)(sample));
+        __m256i w = _mm256_loadu_si256((const __m256i *)(swapping));
+
+        _mm256_storeu_si256((__m256i *)(swapping), _mm256_blendv_epi8(s, w, decided));
+        _mm256_storeu_si256((__m256i *)(sample), _mm256_blendv_epi8(w, s, decided));
+      }
+
+      if (!_mm256_testz_si256(count, count))
+        tailIndex[numberOfUndecided++] = index;
+    }
+
+    numberOfBlocks = numberOfUndecided;
+  }
+
+  /* Produces the output for the groups that still have non-zero counters. */
+  for (uint32_t b = 0; b < numberOfBlocks; ++b) {
+    __m256i count = _mm256_loadu_si256((const __m256i *)(segmentation_map + tailIndex[b]));
+    _mm256_storeu_si256((__m256i *)(segmentation_map + tailIndex[b]), _mm256_andnot_si256(_mm256_cmpeq_epi8(count, zero), foreground));
+  }
+}
+
+VIBE_TARGET_AVX2
+static void pack_8u1u_C1R_avx2(const uint8_t *segmentation_map, uint8_t *mask, uint32_t numberOfPixels)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  uint32_t index = 0;
+
+  for (; index + 32 <= numberOfPixels; index += 32) {
+    __m256i map = _mm256_loadu_si256((const __m256i *)(segmentation_map + index));
+    uint32_t bits = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(map, zero));
+
+    mask[index / 8]     = (uint8_t)bits;
+    mask[index / 8 + 1] = (uint8_t)(bits >> 8);
+    mask[index / 8 + 2] = (uint8_t)(bits >> 16);
+    mask[index / 8 + 3] = (uint8_t)(bits >> 24);
+  }
+
+  pack_8u1u_C1R_scalar(segmentation_map + index, mask + index / 8, numberOfPixels - index);
+}
+
+VIBE_TARGET_AVX2
+static void convert_8u_C4C3R_avx2(const uint8_t *image_data, uint8_t *pixels, uint32_t numberOfPixels)
+{
+  /* 12 bytes per lane, then the two lanes are joined into 24 bytes. */
+  const __m256i drop = _mm256_setr_epi8(
+    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1
+  );
+  const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+  uint32_t index = 0;
+
+  for (; index + 16 <= numberOfPixels; index += 16) {
+    const __m256i *in = (const __m256i *)(image_data + 4 * index);
+    __m256i v0 = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(_mm256_loadu_si256(in), drop), join);
+    __m256i v1 = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(_mm256_loadu_si256(in + 1), drop), join);
+    __m128i *out = (__m128i *)(pixels + 3 * index);
+
+    /* Bytes 0-23 of v0, then bytes 0-23 of v1. */
+    __m128i v0hi = _mm256_extracti128_si256(v0, 1);
+    __m128i v1lo = _mm256_castsi256_si128(v1);
+    __m128i v1hi = _mm256_extracti128_si256(v1, 1);
+
+    _mm_storeu_si128(out,     _mm256_castsi256_si128(v0));
+    _mm_storeu_si128(out + 1, _mm_unpacklo_epi64(v0hi, v1lo));
+    _mm_storeu_si128(out + 2, _mm_alignr_epi8(v1hi, v1lo, 8));
+  }
+
+  convert_8u_C4C3R_scalar(image_data + 4 * index, pixels + 3 * index, numberOfPixels - index);
+}
+
+VIBE_TARGET_AVX2
+static void sums_8u_avx2(const uint8_t *data, uint32_t n, uint16_t *sums)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  uint32_t i = 0;
+
+  /* Four sums of 8 bytes per register; the packs work within the 128-bit lanes. */
+  for (; i + 64 <= n; i += 64) {
+    __m256i s0 = _mm256_sad_epu8(_mm256_loadu_si256((const __m256i *)(data + i)), zero);
+    __m256i s1 = _mm256_sad_epu8(_mm256_loadu_si256((const __m256i *)(data + i + 32)), zero);
+    __m256i packed = _mm256_packus_epi32(_mm256_packus_epi32(s0, s1), zero);
+
+    /* Lane 0 holds sums 0, 1, 4, 5 and lane 1 sums 2, 3, 6, 7 (in their low 64 bits). */
+    __m256i ordered = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 3, 6, 7));
+
+    _mm_storeu_si128((__m128i *)(sums + i / 8), _mm256_castsi256_si128(ordered));
+  }
+
+  sums_8u_scalar(data + i, n - i, sums + i / 8);
+}
+
+VIBE_TARGET_AVX2
+static void noise_8u_avx2(const uint8_t *data, uint8_t *samples, uint32_t n, uint32_t key, uint32_t first)
+{
+  const __m256i ten = _mm256_set1_epi8(10);
+  __m256i counter = _mm256_add_epi32(_mm256_set1_epi32(key + first / 4), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  uint32_t i = 0;
+
+  for (; i + 32 <= n; i += 32, counter = _mm256_add_epi32(counter, _mm256_set1_epi32(8))) {
+    /* vibe_hash_32u of 8 groups of 4 bytes. */
+    __m256i h = _mm256_xor_si256(counter, _mm256_srli_epi32(counter, 16));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x7FEB352D));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int32_t)0x846CA68Bu));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+
+    /* (byte * 20) >> 8 in the low and high bytes of the words. */
+    __m256i low = _mm256_mulhi_epu16(_mm256_and_si256(h, _mm256_set1_epi16(0x00FF)), _mm256_set1_epi16(20 << 8));
+    __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(h, _mm256_set1_epi16((int16_t)0xFF00)), _mm256_set1_epi16(20));
+    __m256i noise = _mm256_or_si256(low, _mm256_slli_epi16(high, 8));
+
+    /* Value + noise - 10, saturated: one of the two terms is zero. */
+    __m256i value = _mm256_loadu_si256((const __m256i *)(data + i));
+    value = _mm256_adds_epu8(value, _mm256_subs_epu8(noise, ten));
+    value = _mm256_subs_epu8(value, _mm256_subs_epu8(ten, noise));
+
+    _mm256_storeu_si256((__m256i *)(samples + i), value);
+  }
+
+  noise_8u_scalar(data + i, samples + i, n - i, key, first + i);
+}
+
+VIBE_TARGET_AVX2
+static uint32_t matches_8u_Q3R_avx2(const uint16_t *samples, uint32_t numberOfSamples, const uint8_t *pixel, int32_t threshold, uint32_t greenBits)
+{
+  const __m256i low5 = _mm256_set1_epi16(31);
+  const __m256i center = _mm256_set1_epi16(4);
+  const __m256i greenMask = _mm256_set1_epi16((int16_t)((1 << greenBits) - 1));
+  const __m256i greenCenter = _mm256_set1_epi16((int16_t)(1 << (7 - greenBits)));
+  const __m128i redShift = _mm_cvtsi32_si128(5 + greenBits);
+  const __m128i greenShift = _mm_cvtsi32_si128(8 - greenBits);
+  const __m256i r = _mm256_set1_epi16(pixel[0]);
+  const __m256i g = _mm256_set1_epi16(pixel[1]);
+  const __m256i b = _mm256_set1_epi16(pixel[2]);
+  const __m256i limit = _mm256_set1_epi16((int16_t)(threshold + 1));
+  uint32_t matches = 0;
+  uint32_t i = 0;
+
+  for (; i + 16 <= numberOfSamples; i += 16) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(samples + i));
+
+    /* Centers of the bins of the 16 samples, one channel per register. */
+    __m256i sr = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(_mm256_srl_epi16(v, redShift), low5), 3), center);
+    __m256i sg = _mm256_or_si256(_mm256_sll_epi16(_mm256_and_si256(_mm256_srli_epi16(v, 5), greenMask), greenShift), greenCenter);
+    __m256i sb = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v, low5), 3), center);
+
+    __m256i sum = _mm256_add_epi16(_mm256_abs_epi16(_mm256_sub_epi16(sr, r)), _mm256_abs_epi16(_mm256_sub_epi16(sg, g)));
+    sum = _mm256_add_epi16(sum, _mm256_abs_epi16(_mm256_sub_epi16(sb, b)));
+
+    /* Packed per lane: the masks of samples 0-7 and 8-15 are in bytes 0-7 and 16-23. */
+    __m256i close = _mm256_cmpgt_epi16(limit, sum);
+    uint32_t bits = (uint32_t)_mm256_movemask_epi8(_mm256_packs_epi16(close, close));
+
+    matches |= ((bits & 0xFF) | ((bits >> 8) & 0xFF00)) << i;
+  }
+
+  if (i < numberOfSamples)
+    matches |= matches_8u_Q3R_scalar(samples + i, numberOfSamples - i, pixel, threshold, greenBits) << i;
+
+  return(matches);
+}
+
+static const vibeKernels_t kernels_avx2 = {
+  VIBE_SIMD_AVX2,
+  historyCount_8u_C1R_avx2,
+  historyCount_8u_C3R_avx2,
+  historyCount_8u_P3R_avx2,
+  deinterleave_8u_C3P3R_avx2,
+  tailSearch_8u_C1R_avx2,
+  tailSearch_8u_C3R_avx2,
+  tailSearch_8u_P3R_avx2,
+  pack_8u1u_C1R_avx2,
+  historyCount_16u_C1R_avx2,
+  historyCount_16u_C3R_avx2,
+  convert_8u_C4C3R_avx2,
+  historyCount_8u_420_avx2,
+  sums_8u_avx2,
+  noise_8u_avx2,
+  matches_8u_Q3R_avx2
+};
+
+#endif /* VIBE_DISABLE_AVX2 */
+
+#endif /* VIBE_HAVE_X86_SIMD */
+
+// -----------------------------------------------------------------------------
+// Run-time dispatch
+// -----------------------------------------------------------------------------
+const vibeKernels_t *libvibeKernels_GetLevel(vibeSimdLevel_t level)
+{
+  switch (level) {
+    case VIBE_SIMD_NONE:
+      return(&kernels_scalar);
+
+#ifdef VIBE_HAVE_X86_SIMD
+#ifndef VIBE_DISABLE_SSE41
+    case VIBE_SIMD_SSE41:
+      __builtin_cpu_init();
+      return(__builtin_cpu_supports("sse4.1") ? &kernels_sse41 : NULL);
+#endif
+#ifndef VIBE_DISABLE_AVX2
+    case VIBE_SIMD_AVX2:
+      __builtin_cpu_init();
+      return(__builtin_cpu_supports("avx2") ? &kernels_avx2 : NULL);
+#endif
+#endif
+
+    default:
+      return(NULL);
+  }
+}
+
+/* Best kernels of the running CPU, selected once for all the models (which may be created by several threads). */
+static pthread_once_t kernelsOnce = PTHREAD_ONCE_INIT;
+static const vibeKernels_t *kernels = NULL;
+
+static void selectKernels(void)
+{
+  const vibeKernels_t *best = NULL;
+
+  for (int level = VIBE_SIMD_AVX2; (best == NULL) && (level > VIBE_SIMD_NONE); --level)
+    best = libvibeKernels_GetLevel((vibeSimdLevel_t)level);
+
+  kernels = (best != NULL) ? best : &kernels_scalar;
+}
+
+const vibeKernels_t *libvibeKernels_Get(void)
+{
+  pthread_once(&kernelsOnce, selectKernels);
+
+  return(kernels);
+}
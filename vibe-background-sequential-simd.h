@@ -0,0 +1,454 @@
+/**
+    @file vibe-background-sequential-simd.h
+    @brief Internal SIMD kernels used by vibe-background-sequential.c
+
+    @details
+
+  This header is private to the ViBe library. It exposes the vectorized
+  kernels of the segmentation step together with a small dispatch table that
+  is filled once, at run time, according to the instruction sets reported by
+  the CPU (CPUID). The scalar kernels are always available and are used as a
+  fallback.
+
+  All the kernels produce exactly the same results as the scalar code of
+  vibe-background-sequential.c, including the (wrapping) 8-bit arithmetic on
+  the counters stored in the segmentation map. The 16u kernels (16-bit
+  samples) keep these 8-bit counters.
+
+  The SSE4.1 and AVX2 kernels can be excluded at compile time with
+  -DVIBE_DISABLE_SSE41 and -DVIBE_DISABLE_AVX2 respectively. The counters of
+  libvibeModel_Sequential_GetStats are only compiled with -DVIBE_STATS.
+*/
+
+#ifndef _VIBE_SEQUENTIAL_SIMD_H_
+#define _VIBE_SEQUENTIAL_SIMD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define VIBE_HAVE_X86_SIMD 1
+#endif
+
+/* Statement of the counters (see libvibeModel_Sequential_GetStats), compiled with -DVIBE_STATS only. */
+#ifdef VIBE_STATS
+#define VIBE_COUNT(statement) statement
+#else
+#define VIBE_COUNT(statement)
+#endif
+
+/**
+ * Samples of the historyBuffer tested, swapped and moved to the front of the
+ * samples of their pixel by a tail search (counted with -DVIBE_STATS only,
+ * left unchanged otherwise).
+ */
+typedef struct
+{
+  uint64_t testedSamples;
+  uint64_t swappedSamples;
+  uint64_t movedSamples;
+} vibeTailCounts_t;
+
+/**
+ * Instruction sets the kernels have been specialized for.
+ */
+typedef enum
+{
+  VIBE_SIMD_NONE  = 0, /*!< Portable scalar code. */
+  VIBE_SIMD_SSE41 = 1, /*!< SSE4.1 (128-bit) kernels. */
+  VIBE_SIMD_AVX2  = 2  /*!< AVX2 (256-bit) kernels. */
+} vibeSimdLevel_t;
+
+/**
+ * Computes, for every pixel, the number of matches that are still missing
+ * after comparing the pixel with the historyImages of a C3R model:
+ *
+ *   counts[p] = matchingNumber - (number of historyImages close to pixel p)
+ *
+ * using the wrapping 8-bit arithmetic of the reference implementation (the
+ * first historyImage initializes the counter, the next ones decrement it).
+ * All the historyImages are tested in a single sweep and the counters are
+ * written once. The kernels are specialized for 1 to 4 historyImages.
+ *
+ * The pixels whose counter is not zero (i.e. the pixels that still need the
+ * historyBuffer search) are appended, in increasing order, to tailIndex, so
+ * that the next steps of the segmentation only visit these pixels.
+ *
+ * @param image_data Input image (RGBRGB...).
+ * @param historyImage First historyImage; the next ones follow every planeSize bytes.
+ * @param planeSize Size of one historyImage, in bytes.
+ * @param numberOfHistoryImages Number of historyImages to test (>= 1).
+ * @param numberOfPixels Number of pixels to process.
+ * @param matchingNumber
+ * @param matchingThreshold
+ * @param counts Output counters (one byte per pixel).
+ * @param tailIndex Output list of the undecided pixels.
+ * @return The number of indices written in tailIndex.
+ */
+typedef uint32_t (*vibeHistoryCount_8u_C3R_fn)(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+);
+
+/**
+ * Counterpart of \ref vibeHistoryCount_8u_C3R_fn for planar models: the input
+ * image is still RGBRGB..., but the R, G and B planes of every historyImage are
+ * channelSize bytes apart. The input pixels are deinterleaved once, in
+ * registers, and then compared with all the historyImages without any further
+ * shuffle.
+ */
+typedef uint32_t (*vibeHistoryCount_8u_P3R_fn)(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t channelSize,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+);
+
+/**
+ * Converts an RGBRGB... image into three planes, channelSize bytes apart.
+ */
+typedef void (*vibeDeinterleave_8u_C3P3R_fn)(
+  const uint8_t *image_data,
+  uint8_t *image_planes,
+  size_t channelSize,
+  uint32_t numberOfPixels
+);
+
+/**
+ * Grayscale (C1R) counterpart of \ref vibeHistoryCount_8u_C3R_fn.
+ */
+typedef uint32_t (*vibeHistoryCount_8u_C1R_fn)(
+  const uint8_t *image_data,
+  const uint8_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+);
+
+/**
+ * Historybuffer search of a C1R model whose historyBuffer is sample-major
+ * (sample i of pixel p at historyBuffer[i * planeSize + p]).
+ *
+ * For every pixel of tailIndex, the samples are tested in order until the
+ * counter (computed by \ref vibeHistoryCount_8u_C1R_fn) reaches zero, and
+ * every matching sample is swapped with swappingImage, exactly like the
+ * pixel-major code. The SIMD kernels do this sample plane by sample plane, on
+ * the groups of pixels that are still undecided, and stop as soon as all of
+ * them are decided.
+ *
+ * The counters are finally turned into the segmentation map (COLOR_FOREGROUND
+ * for the non-zero counters). The content of tailIndex is destroyed.
+ *
+ * @param image_data Input image.
+ * @param swappingImage historyImage that receives the matching samples.
+ * @param historyBuffer First sample plane of the historyBuffer.
+ * @param planeSize Size of one sample plane, in bytes.
+ * @param numberOfTests Number of sample planes.
+ * @param numberOfPixels
+ * @param matchingThreshold
+ * @param segmentation_map Counters on input, segmentation map on output.
+ * @param tailIndex Pixels with a non-zero counter, in increasing order.
+ * @param numberOfTails
+ * @param tailCounts Counters of the samples tested and swapped, incremented.
+ */
+typedef void (*vibeTailSearch_8u_C1R_fn)(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+);
+
+/**
+ * C3R counterpart of \ref vibeTailSearch_8u_C1R_fn (sample planes stored as
+ * RGBRGB...). As in the pixel-major code, every tested sample is swapped with
+ * swappingImage, matching or not.
+ */
+typedef void (*vibeTailSearch_8u_C3R_fn)(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+);
+
+/**
+ * Planar counterpart of \ref vibeTailSearch_8u_C3R_fn: the R, G and B planes
+ * of swappingImage and of every sample plane are channelSize bytes apart.
+ */
+typedef void (*vibeTailSearch_8u_P3R_fn)(
+  const uint8_t *image_data,
+  uint8_t *swappingImage,
+  uint8_t *historyBuffer,
+  size_t channelSize,
+  size_t planeSize,
+  uint32_t numberOfTests,
+  uint32_t numberOfPixels,
+  uint32_t matchingThreshold,
+  uint8_t *segmentation_map,
+  uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+);
+
+/**
+ * Packs a segmentation map into a mask of bits: bit (index & 7) of
+ * mask[index / 8] is set if segmentation_map[index] is not zero. The unused
+ * bits of the last byte are cleared.
+ */
+typedef void (*vibePack_8u1u_C1R_fn)(
+  const uint8_t *segmentation_map,
+  uint8_t *mask,
+  uint32_t numberOfPixels
+);
+
+/**
+ * 16u counterpart of \ref vibeHistoryCount_8u_C1R_fn: the image and the
+ * historyImages hold 16-bit samples, and planeSize counts samples. The
+ * counters are still stored on 8 bits.
+ */
+typedef uint32_t (*vibeHistoryCount_16u_C1R_fn)(
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+);
+
+/**
+ * 16u counterpart of \ref vibeHistoryCount_8u_C3R_fn (interleaved RGB
+ * historyImages, planeSize counts samples).
+ */
+typedef uint32_t (*vibeHistoryCount_16u_C3R_fn)(
+  const uint16_t *image_data,
+  const uint16_t *historyImage,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+);
+
+/**
+ * Counterpart of \ref vibeHistoryCount_8u_C3R_fn for the YUV 4:2:0 models,
+ * on pixels of a same row: every pixel has its own luma sample, and every
+ * pair of pixels (of a 2x2 block) shares a chroma sample, stored as UVUV...
+ * The distance |Y - Y'| + |U - U'| + |V - V'| is compared with the bound of
+ * the C3R models (\ref vibe_threshold_8u_C3R).
+ *
+ * @param luma Luma of the input pixels.
+ * @param chroma Chroma of the input pixels (UVUV..., one pair for two pixels).
+ * @param historyLuma Luma of the first historyImage; the next ones follow every planeSize bytes.
+ * @param historyChroma Chroma of the first historyImage; the next ones follow every planeSize bytes.
+ * @param planeSize Size of one historyImage, in bytes.
+ * @param numberOfHistoryImages Number of historyImages to test (>= 1).
+ * @param numberOfPixels Number of pixels to process (even).
+ * @param matchingNumber
+ * @param matchingThreshold
+ * @param counts Output counters (one byte per pixel).
+ * @param tailIndex Output list of the undecided pixels.
+ * @return The number of indices written in tailIndex.
+ */
+typedef uint32_t (*vibeHistoryCount_8u_420_fn)(
+  const uint8_t *luma,
+  const uint8_t *chroma,
+  const uint8_t *historyLuma,
+  const uint8_t *historyChroma,
+  size_t planeSize,
+  uint32_t numberOfHistoryImages,
+  uint32_t numberOfPixels,
+  uint32_t matchingNumber,
+  uint32_t matchingThreshold,
+  uint8_t *counts,
+  uint32_t *tailIndex
+);
+
+/**
+ * Drops the fourth byte of the pixels of an RGBXRGBX... image (RGBA, BGRA...):
+ * pixels receives the RGBRGB... image of a C3R model.
+ */
+typedef void (*vibeConvert_8u_C4C3R_fn)(
+  const uint8_t *image_data,
+  uint8_t *pixels,
+  uint32_t numberOfPixels
+);
+
+/**
+ * Sums of the groups of 8 bytes of data (the last group may be shorter):
+ * sums[i] is the sum of bytes 8 * i to 8 * i + 7, for the signatures of the
+ * static blocks.
+ */
+typedef void (*vibeSums_8u_fn)(
+  const uint8_t *data,
+  uint32_t n,
+  uint16_t *sums
+);
+
+/**
+ * Noisy copy of data for the initial samples: samples[i] is data[i] plus a
+ * noise between -10 and 9, saturated to [0, 255]. The noise of byte k = first
+ * + i of the sample only depends on key and k (see vibe_noise_8u), so that
+ * any part of the samples can be filled on its own, in any order. first is a
+ * multiple of 4.
+ */
+typedef void (*vibeNoise_8u_fn)(
+  const uint8_t *data,
+  uint8_t *samples,
+  uint32_t n,
+  uint32_t key,
+  uint32_t first
+);
+
+/**
+ * Matches of the samples of the historyBuffer of a C3R model stored on 16
+ * bits (RGB565 or RGB555, see vibe_quantize_8u_Q3R): bit i of the result is
+ * set if the L1 distance between the pixel (RGB) and sample i, taken at the
+ * center of its quantization bin, is at most threshold (see
+ * \ref vibe_threshold_8u_C3R).
+ *
+ * @param samples Samples of the pixel.
+ * @param numberOfSamples Number of samples to test (at most 32).
+ * @param pixel Input pixel (RGB).
+ * @param threshold
+ * @param greenBits Bits of the green channel (6 for RGB565, 5 for RGB555).
+ * @return The mask of the matching samples.
+ */
+typedef uint32_t (*vibeMatches_8u_Q3R_fn)(
+  const uint16_t *samples,
+  uint32_t numberOfSamples,
+  const uint8_t *pixel,
+  int32_t threshold,
+  uint32_t greenBits
+);
+
+/**
+ * Dispatch table of the kernels.
+ */
+typedef struct
+{
+  vibeSimdLevel_t level;
+  vibeHistoryCount_8u_C1R_fn historyCount_8u_C1R;
+  vibeHistoryCount_8u_C3R_fn historyCount_8u_C3R;
+  vibeHistoryCount_8u_P3R_fn historyCount_8u_P3R;
+  vibeDeinterleave_8u_C3P3R_fn deinterleave_8u_C3P3R;
+  vibeTailSearch_8u_C1R_fn tailSearch_8u_C1R;
+  vibeTailSearch_8u_C3R_fn tailSearch_8u_C3R;
+  vibeTailSearch_8u_P3R_fn tailSearch_8u_P3R;
+  vibePack_8u1u_C1R_fn pack_8u1u_C1R;
+  vibeHistoryCount_16u_C1R_fn historyCount_16u_C1R;
+  vibeHistoryCount_16u_C3R_fn historyCount_16u_C3R;
+  vibeConvert_8u_C4C3R_fn convert_8u_C4C3R;
+  vibeHistoryCount_8u_420_fn historyCount_8u_420;
+  vibeSums_8u_fn sums_8u;
+  vibeNoise_8u_fn noise_8u;
+  vibeMatches_8u_Q3R_fn matches_8u_Q3R;
+} vibeKernels_t;
+
+/**
+ * Returns the best kernels supported by the running CPU. The detection is
+ * only done on the first call (once, whatever the threads calling it).
+ */
+const vibeKernels_t *libvibeKernels_Get(void);
+
+/**
+ * Returns the kernels of a given level, or <tt>NULL</tt> if this level was
+ * not compiled in or is not supported by the running CPU.
+ */
+const vibeKernels_t *libvibeKernels_GetLevel(vibeSimdLevel_t level);
+
+/**
+ * Largest value a sum of three absolute differences (at most 3 * 255) is
+ * compared with: the reference test "sum <= 4.5 * threshold" is equivalent to
+ * "sum <= vibe_threshold_8u_C3R(threshold)".
+ */
+static inline int32_t vibe_threshold_8u_C3R(uint32_t matchingThreshold)
+{
+  return (matchingThreshold >= 170) ? 3 * 255 : (int32_t)((9 * matchingThreshold) / 2);
+}
+
+/**
+ * 16u counterpart of \ref vibe_threshold_8u_C3R (sums of at most 3 * 65535).
+ */
+static inline int32_t vibe_threshold_16u_C3R(uint32_t matchingThreshold)
+{
+  return (matchingThreshold >= 43690) ? 3 * 65535 : (int32_t)((9 * matchingThreshold) / 2);
+}
+
+/**
+ * Samples of 16 bits of a C3R model: the 5 high bits of red, the greenBits (6
+ * or 5) high bits of green and the 5 high bits of blue, from the high bits to
+ * the low bits. A sample stands for the center of its quantization bin, so
+ * that its values are at most 4 (2 for a green of 6 bits) away from those
+ * quantized.
+ */
+static inline uint16_t vibe_quantize_8u_Q3R(uint8_t r, uint8_t g, uint8_t b, uint32_t greenBits)
+{
+  return (uint16_t)(((r >> 3) << (5 + greenBits)) | ((g >> (8 - greenBits)) << 5) | (b >> 3));
+}
+
+static inline void vibe_dequantize_8u_Q3R(uint16_t sample, uint32_t greenBits, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+  *r = (uint8_t)((((sample >> (5 + greenBits)) & 31) << 3) | 4);
+  *g = (uint8_t)((((sample >> 5) & ((1u << greenBits) - 1)) << (8 - greenBits)) | (1u << (7 - greenBits)));
+  *b = (uint8_t)(((sample & 31) << 3) | 4);
+}
+
+/**
+ * Counter-based random numbers of the initial samples: a 32-bit hash
+ * (lowbias32) of key + k / 4 gives the noise of the 4 bytes k of a group,
+ * one byte each, scaled from [0, 255] to [0, 19] then shifted to [-10, 9].
+ */
+static inline uint32_t vibe_hash_32u(uint32_t x)
+{
+  x ^= x >> 16;
+  x *= 0x7FEB352Du;
+  x ^= x >> 15;
+  x *= 0x846CA68Bu;
+  x ^= x >> 16;
+
+  return x;
+}
+
+static inline int32_t vibe_noise_8u(uint32_t key, uint32_t k)
+{
+  uint32_t byte = (vibe_hash_32u(key + (k >> 2)) >> (8 * (k & 3))) & 0xFF;
+
+  return (int32_t)((byte * 20) >> 8) - 10;
+}
+
+#endif
@@ -23,7 +23,7 @@ By using trick 1, it appears that in all the cases the algorithm will check the
 
 3. Initialization of the sample values
 
-The original article (IEEE Transactions on Image Processing, June 2011) proposes to initialize the model with sample values taken in the neighborhood. In this implementation, we choose to fill the initial model with the value of the current pixel plus some noise (see  int value_plus_noise = value + rand() % 20 - 10; ). 
+The original article (IEEE Transactions on Image Processing, June 2011) proposes to initialize the model with sample values taken in the neighborhood. In this implementation, we choose to fill the initial model with the value of the current pixel plus some noise between -10 and 9 (see vibe_noise_8u, a counter-based generator, so that the samples are filled in parallel). 
 In fact, there are several ways to consider the problem of initialization: 
 A. use the original mechanism of ViBe (see patents and article)
 B. use the mechanism proposed in this file (good compromise between speed and adaptability)
@@ -45,23 +45,119 @@ If you take a decision to update a pixel for 1 out of 16 (== updatingFactor) pix
 Likewise, instead of a random selection of the neighboring model to be updated, the implementation pre-stores the relative offset of the neighbor to be selected.  
 */
 
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
 #include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "vibe-background-sequential.h"
+#include "vibe-background-sequential-simd.h"
+#include "vibe-thread-pool.h"
+
+/* Number of pixels segmented at once before being packed into a mask of bits (multiple of 32). */
+#define PACK_CHUNK_SIZE 4096
+
+/* Input images of the YUV 4:2:0 models: U and V planes (I420), or a single UV plane (NV12). */
+#define VIBE_CHROMA_I420 1
+#define VIBE_CHROMA_NV12 2
+
+/* Static blocks: size of the blocks (in pixels) and flags of their state. */
+#define VIBE_BLOCK_SIZE 16
+#define VIBE_BLOCK_BACKGROUND 1
+#define VIBE_BLOCK_SKIPPED 2
 
-#define NUMBER_OF_HISTORY_IMAGES 2
+/* Storage of the models: alignment of the blocks (a cache line), and of the history
+ * when huge pages are requested (see libvibeModel_Sequential_SetHugePages).
+ */
+#define VIBE_ALIGNMENT 64
+#define VIBE_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* Size of the L2 cache the Process functions work for (e.g. -DVIBE_L2_CACHE_SIZE=2097152). */
+#ifndef VIBE_L2_CACHE_SIZE
+#define VIBE_L2_CACHE_SIZE (1024 * 1024)
+#endif
 
 static inline int abs_uint(const int i)
 {
   return (i >= 0) ? i : -i;
 }
 
-static inline int32_t distance_is_close_8u_C3R(uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2, uint32_t threshold)
+/* The threshold is the integer bound given by vibe_threshold_8u_C3R (equivalent to 4.5 * matchingThreshold). */
+static inline int32_t distance_is_close_8u_C3R(uint8_t r1, uint8_t g1, uint8_t b1, uint8_t r2, uint8_t g2, uint8_t b2, int32_t threshold)
+{
+  return (abs_uint(r1 - r2) + abs_uint(g1 - g2) + abs_uint(b1 - b2) <= threshold);
+}
+
+// -----------------------------------------------------------------------------
+// Random numbers
+//
+// Every model owns its stream (xoshiro128**), so that several models can run
+// side by side without sharing the hidden state (and the lock) of rand(), and
+// so that a model only depends on its seed.
+// -----------------------------------------------------------------------------
+typedef struct
+{
+  uint32_t s[4];
+} vibeRandom_t;
+
+static inline uint32_t rotl_32u(uint32_t x, int k)
+{
+  return (x << k) | (x >> (32 - k));
+}
+
+/* Next 32-bit value of the stream. */
+static inline uint32_t vibe_rand(vibeRandom_t *random)
+{
+  uint32_t *s = random->s;
+  uint32_t result = rotl_32u(s[1] * 5, 7) * 9;
+  uint32_t t = s[1] << 9;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl_32u(s[3], 11);
+
+  return(result);
+}
+
+/* Value between 0 and n - 1 (multiply and shift instead of a division). */
+static inline uint32_t vibe_rand_below(vibeRandom_t *random, uint32_t n)
+{
+  return (uint32_t)(((uint64_t)vibe_rand(random) * n) >> 32);
+}
+
+/* Starts a stream from a 64-bit seed (expanded with splitmix64, never all zeros). */
+static void vibe_srand(vibeRandom_t *random, uint64_t seed)
 {
-  return (abs_uint(r1 - r2) + abs_uint(g1 - g2) + abs_uint(b1 - b2) <= 4.5 * threshold);
+  for (int i = 0; i < 4; i += 2) {
+    uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+
+    random->s[i]     = (uint32_t)z;
+    random->s[i + 1] = (uint32_t)(z >> 32);
+  }
 }
 
+/* Pixels [first, last) of a row in the region of interest. */
+typedef struct
+{
+  uint32_t first;
+  uint32_t last;
+} vibeSpan_t;
+
+/* Buffers with random values shared by the models of the same configuration (see acquireTables). */
+typedef struct vibeTables vibeTables_t;
+
 struct vibeModel_Sequential
 {
   /* Parameters. */
@@ -72,375 +168,4949 @@ struct vibeModel_Sequential
   uint32_t matchingNumber;
   uint32_t updateFactor;
 
-  /* Storage for the history. */
+  /* Storage for the history: numberOfHistoryImages historyImages, then the historyBuffer,
+   * with samples of sampleSize bytes (1 for the 8u models, 2 for the 16u models).
+   */
+  uint32_t numberOfHistoryImages;
+  uint32_t sampleSize;
   uint8_t *historyImage;
   uint8_t *historyBuffer;
   uint32_t lastHistoryImageSwapped;
 
-  /* Buffers with random values. */
-  uint32_t *jump;
-  int *neighbor;
-  uint32_t *position;
+  /* Memory layout of the samples (see libvibeModel_Sequential_SetLayout and SetBufferLayout). */
+  vibeModelLayout_t layout;
+  vibeBufferLayout_t bufferLayout;
+  uint32_t imagePixelStride;
+  uint32_t imageChannelStride;
+  uint32_t bufferPixelStride;
+  uint32_t bufferSampleStride;
+  uint32_t bufferChannelStride;
+
+  /* Pixels of a block sharing the samples of the historyBuffer (see
+   * libvibeModel_Sequential_SetSampleBlockSize): sampleBlockSize x
+   * sampleBlockSize pixels, and blockColumns blocks per row of blocks.
+   */
+  uint32_t sampleBlockSize;
+  uint32_t blockColumns;
+
+  /* Storage of the samples of the historyBuffer of a C3R model (see libvibeModel_Sequential_SetSampleFormat). */
+  vibeSampleFormat_t sampleFormat;
+
+  /* Order of the samples of a pixel in the historyBuffer (see libvibeModel_Sequential_SetSampleOrdering). */
+  vibeSampleOrdering_t sampleOrdering;
+
+  /* Input images: channels of a pixel (4 for the RGBX images of a C3R model)
+   * and bytes from a row to the next one (0 for rows without padding).
+   */
+  uint32_t inputChannels;
+  uint32_t imageStep;
+
+  /* YUV 4:2:0 models: format of the input images (VIBE_CHROMA_I420 or VIBE_CHROMA_NV12, 0 for the other models). */
+  uint32_t chromaFormat;
+
+  /* Buffers with random values (read-only): those of tables, or those of the
+   * file of a loaded model (tables is then NULL until SetUpdateFactor).
+   */
+  vibeTables_t *tables;
+  const uint32_t *jump;
+  const int *neighbor;
+  const uint32_t *position;
+
+  /* Indices of the pixels that need the historyBuffer search. */
+  uint32_t *tailIndex;
+
+  /* Region of interest (NULL for the whole frame, see libvibeModel_Sequential_SetROI):
+   * the spans of row y are roiSpans[roiRows[y]] to roiSpans[roiRows[y + 1] - 1],
+   * in increasing order, and the pixels outside get the label roiLabel.
+   */
+  uint32_t *roiRows;
+  vibeSpan_t *roiSpans;
+  uint8_t roiLabel;
+
+  /* Static blocks (see libvibeModel_Sequential_SetStaticBlockThreshold): largest
+   * difference of the signatures of an unchanged block (-1 when disabled),
+   * signatures of the input image of the last segmentation of every block then
+   * of the current input image, and VIBE_BLOCK_* flags of every block.
+   */
+  int32_t staticBlockThreshold;
+  uint16_t *blockSums;
+  uint8_t *blockState;
+
+  /* File mapped by libvibeModel_Sequential_Load (NULL otherwise): the history
+   * and the buffers with random values then point into it.
+   */
+  void *mapping;
+  size_t mappingSize;
+
+  /* Storage of the model (see libvibeModel_Sequential_SetAllocator and SetHugePages). */
+  vibeAllocator_t allocator;
+  uint32_t hugePages;
+
+  /* Counters of libvibeModel_Sequential_GetStats (incremented with -DVIBE_STATS only). */
+  vibeStats_t stats;
+
+  /* Segmentation kernels selected for the running CPU. */
+  const vibeKernels_t *kernels;
+
+  /* Random numbers: seed and stream of the model. */
+  uint32_t seed;
+  vibeRandom_t random;
+
+  /* Multi-threading: worker pool (NULL until the first multi-threaded call) and random streams of the row bands. */
+  uint32_t numberOfThreads;
+  vibeThreadPool_t *pool;
+  vibeRandom_t *bandRandom;
 };
 
 // -----------------------------------------------------------------------------
-// Print parameters
+// Samples shared by blocks of pixels
+//
+// With a sampleBlockSize larger than 1, the historyBuffer of an 8u model keeps
+// a single set of samples per block of sampleBlockSize x sampleBlockSize
+// pixels (cut by the right and bottom edges of the frame), in the order of the
+// blocks, while the historyImages keep a sample per pixel. Every pixel is
+// still classified on its own, against its historyImages and then the samples
+// of its block, and the update writes into the set of the block. The
+// segmentation does not swap the samples of such a historyBuffer: a swap would
+// hand the sample of one pixel to the whole block. A set may be written by the
+// rows of two row bands, so these models process a frame in a single band.
 // -----------------------------------------------------------------------------
-uint32_t libvibeModel_Sequential_PrintParameters(const vibeModel_Sequential_t *model)
+
+/* Number of sets of samples of the historyBuffer: one per pixel, or one per block. */
+static inline uint32_t bufferPixels(const vibeModel_Sequential_t *model)
 {
-  printf(
-    "Using ViBe background subtraction algorithm\n"
-      "  - Number of samples per pixel:       %03d\n"
-      "  - Number of matches needed:          %03d\n"
-      "  - Matching threshold:                %03d\n"
-      "  - Model update subsampling factor:   %03d\n",
-    libvibeModel_Sequential_GetNumberOfSamples(model),
-    libvibeModel_Sequential_GetMatchingNumber(model),
-    libvibeModel_Sequential_GetMatchingThreshold(model),
-    libvibeModel_Sequential_GetUpdateFactor(model)
-  );
+  uint32_t size = model->sampleBlockSize;
 
-  return(0);
+  return ((model->width + size - 1) / size) * ((model->height + size - 1) / size);
 }
 
-// -----------------------------------------------------------------------------
-// Creates the data structure
-// -----------------------------------------------------------------------------
-vibeModel_Sequential_t *libvibeModel_Sequential_New()
+/* Set of samples of pixel "index" in the historyBuffer. */
+static inline uint32_t bufferIndex(const vibeModel_Sequential_t *model, uint32_t index)
 {
-  /* Model structure alloc. */
-  vibeModel_Sequential_t *model = NULL;
-  model = (vibeModel_Sequential_t*)calloc(1, sizeof(*model));
-  assert(model != NULL);
-
-  /* Default parameters values. */
-  model->numberOfSamples         = 20;
-  model->matchingThreshold       = 20;
-  model->matchingNumber          = 2;
-  model->updateFactor            = 16;
-
-  /* Storage for the history. */
-  model->historyImage            = NULL;
-  model->historyBuffer           = NULL;
-  model->lastHistoryImageSwapped = 0;
+  uint32_t size = model->sampleBlockSize;
 
-  /* Buffers with random values. */
-  model->jump                    = NULL;
-  model->neighbor                = NULL;
-  model->position                = NULL;
+  if (size == 1)
+    return index;
 
-  return(model);
+  return (index / model->width / size) * model->blockColumns + (index % model->width) / size;
 }
 
 // -----------------------------------------------------------------------------
-// Some "Get-ers"
+// Samples of 16 bits
+//
+// With the VIBE_SAMPLE_RGB565 and VIBE_SAMPLE_RGB555 formats, the historyBuffer
+// of a C3R model keeps every sample on 16 bits (see vibe_quantize_8u_Q3R),
+// pixel-major: the strides of the buffer count samples of 16 bits, and a pixel
+// has numberOfTests contiguous samples. The historyImages keep 3 bytes per
+// sample. A sample of the buffer stands for the center of its quantization bin
+// wherever it is read: when it is compared with a pixel, and when it is
+// swapped with a historyImage (which gets the center, and gives its quantized
+// sample to the buffer).
 // -----------------------------------------------------------------------------
-uint32_t libvibeModel_Sequential_GetNumberOfSamples(const vibeModel_Sequential_t *model)
-{
-  assert(model != NULL); return(model->numberOfSamples);
-}
 
-uint32_t libvibeModel_Sequential_GetMatchingNumber(const vibeModel_Sequential_t *model)
+/* Bits of the green channel of the samples of 16 bits. */
+static inline uint32_t greenBits(const vibeModel_Sequential_t *model)
 {
-  assert(model != NULL); return(model->matchingNumber);
+  return (model->sampleFormat == VIBE_SAMPLE_RGB565) ? 6 : 5;
 }
 
-uint32_t libvibeModel_Sequential_GetMatchingThreshold(const vibeModel_Sequential_t *model)
+/* Sample "position" (of the historyBuffer) of pixel "index". */
+static inline uint16_t *quantizedSample_8u_C3R(const vibeModel_Sequential_t *model, uint32_t index, uint32_t position)
 {
-  assert(model != NULL); return(model->matchingThreshold);
+  return((uint16_t *)model->historyBuffer + (size_t)bufferIndex(model, index) * model->bufferPixelStride + (position - model->numberOfHistoryImages));
 }
 
-uint32_t libvibeModel_Sequential_GetUpdateFactor(const vibeModel_Sequential_t *model)
+/* Swaps a sample of 16 bits with the sample of a historyImage (channels channelStride bytes apart). */
+static inline void swapQuantized_8u_C3R(uint16_t *sample, uint8_t *swapping, uint32_t channelStride, uint32_t bits)
 {
-  assert(model != NULL); return(model->updateFactor);
+  uint16_t value = *sample;
+
+  *sample = vibe_quantize_8u_Q3R(swapping[0], swapping[channelStride], swapping[2 * channelStride], bits);
+  vibe_dequantize_8u_Q3R(value, bits, &swapping[0], &swapping[channelStride], &swapping[2 * channelStride]);
 }
 
 // -----------------------------------------------------------------------------
-// Some "Set-ers"
+// Move-to-front ordering of the samples of the historyBuffer
+//
+// With VIBE_ORDERING_MOVE_TO_FRONT, the pixel-major searches of the 8u models
+// move the sample left in the place of a match (the sample of the historyImage
+// it was swapped with, or the match itself when the samples are not swapped)
+// to the front of the samples of its pixel, the samples before it moving back
+// by one. The next samples, not tested yet, stay in place, so that the search
+// goes on with the next one.
 // -----------------------------------------------------------------------------
-int32_t libvibeModel_Sequential_SetMatchingThreshold(
-  vibeModel_Sequential_t *model,
-  const uint32_t matchingThreshold
-) {
-  assert(model != NULL);
-  assert(matchingThreshold > 0);
 
-  model->matchingThreshold = matchingThreshold;
+/* Moves sample i (of size bytes) of contiguous samples to the front. */
+static inline void moveToFront(uint8_t *samples, uint32_t i, uint32_t size)
+{
+  uint8_t value[4];
 
-  return(0);
+  memcpy(value, samples + i * size, size);
+  memmove(samples + size, samples, i * size);
+  memcpy(samples, value, size);
+}
+
+/* Same for the samples of 3 bytes of a C3R pixel, whose channels may be in planes (bufferChannelStride bytes apart). */
+static inline void moveToFront_8u_C3R(const vibeModel_Sequential_t *model, uint8_t *samples, uint32_t i)
+{
+  if (model->bufferChannelStride == 1) {
+    moveToFront(samples, i, 3);
+    return;
+  }
+
+  for (uint32_t c = 0; c < 3; ++c)
+    moveToFront(samples + c * model->bufferChannelStride, i, 1);
 }
 
 // -----------------------------------------------------------------------------
-int32_t libvibeModel_Sequential_SetNumberOfSamples(
-  vibeModel_Sequential_t *model,
-  const uint32_t numberOfSamples
+// Address of the sample "position" of pixel "index" of a C3R model, whatever
+// the layout of the model. The G and B values are at channelStride and
+// 2 * channelStride, the same sample of pixel index + 1 at pixelStride.
+// -----------------------------------------------------------------------------
+static inline uint8_t *sample_8u_C3R(
+  const vibeModel_Sequential_t *model,
+  uint32_t index,
+  uint32_t position,
+  uint32_t *pixelStride,
+  uint32_t *channelStride
 ) {
-  assert(model != NULL);
-  assert(numberOfSamples > 0);
+  if (position < model->numberOfHistoryImages) {
+    *pixelStride = model->imagePixelStride;
+    *channelStride = model->imageChannelStride;
+    return(model->historyImage + position * (3 * model->width) * model->height + index * model->imagePixelStride);
+  }
 
-  model->numberOfSamples = numberOfSamples;
+  *pixelStride = model->bufferPixelStride;
+  *channelStride = model->bufferChannelStride;
+  return(model->historyBuffer + bufferIndex(model, index) * model->bufferPixelStride + (position - model->numberOfHistoryImages) * model->bufferSampleStride);
+}
 
-  return(0);
+/* Same sample of the neighbor index + offset of pixel "index" (sample points at that of pixel "index"). */
+static inline uint8_t *neighborSample_8u_C3R(
+  const vibeModel_Sequential_t *model,
+  uint8_t *sample,
+  uint32_t index,
+  int offset,
+  uint32_t position,
+  uint32_t pixelStride
+) {
+  if ((model->sampleBlockSize == 1) || (position < model->numberOfHistoryImages))
+    return(sample + offset * (int)pixelStride);
+
+  return(model->historyBuffer + bufferIndex(model, index + offset) * model->bufferPixelStride + (position - model->numberOfHistoryImages) * model->bufferSampleStride);
 }
 
 // -----------------------------------------------------------------------------
-int32_t libvibeModel_Sequential_SetMatchingNumber(
-  vibeModel_Sequential_t *model,
-  const uint32_t matchingNumber
-) {
-  assert(model != NULL);
-  assert(matchingNumber > 0);
+// Stores (r, g, b) as the sample "position" of pixel "index" of a C3R model
+// -----------------------------------------------------------------------------
+static inline void setSample_8u_C3R(vibeModel_Sequential_t *model, uint32_t index, uint32_t position, uint8_t r, uint8_t g, uint8_t b)
+{
+  if ((model->sampleFormat != VIBE_SAMPLE_RGB888) && (position >= model->numberOfHistoryImages)) {
+    *quantizedSample_8u_C3R(model, index, position) = vibe_quantize_8u_Q3R(r, g, b, greenBits(model));
+    return;
+  }
 
-  model->matchingNumber = matchingNumber;
+  uint32_t pixelStride, channelStride;
+  uint8_t *sample = sample_8u_C3R(model, index, position, &pixelStride, &channelStride);
 
-  return(0);
+  sample[0]                 = r;
+  sample[channelStride]     = g;
+  sample[2 * channelStride] = b;
 }
 
 // -----------------------------------------------------------------------------
-int32_t libvibeModel_Sequential_SetUpdateFactor(
-  vibeModel_Sequential_t *model,
-  const uint32_t updateFactor
-) {
-  assert(model != NULL);
-  assert(updateFactor > 0);
+// Storage of the models
+//
+// The history, the buffers with random values and the other buffers sized by
+// the frame are allocated by the allocator of the model (see
+// libvibeModel_Sequential_SetAllocator), aligned on VIBE_ALIGNMENT bytes. When
+// huge pages are requested, the historyImages and the historyBuffer of at
+// least VIBE_HUGE_PAGE_SIZE bytes are aligned on a huge page, and the kernel
+// is advised to back them with huge pages (a hint, ignored where unsupported).
+// -----------------------------------------------------------------------------
+static void *alignedAlloc(void *context, size_t size, size_t alignment)
+{
+  void *pointer = NULL;
 
-  model->updateFactor = updateFactor;
+  return (posix_memalign(&pointer, alignment, size) == 0) ? pointer : NULL;
+}
 
-  /* We also need to change the values of the jump buffer ! */
-  assert(model->jump != NULL);
+static void alignedFree(void *context, void *pointer)
+{
+  free(pointer);
+}
 
-  /* Shifts. */
-  int size = (model->width > model->height) ? 2 * model->width + 1 : 2 * model->height + 1;
+static const vibeAllocator_t defaultAllocator = { alignedAlloc, alignedFree, NULL };
 
-  for (int i = 0; i < size; ++i)
-    model->jump[i] = (updateFactor == 1) ? 1 : (rand() % (2 * model->updateFactor)) + 1; // 1 or values between 1 and 2 * updateFactor.
+static void *allocAligned(vibeModel_Sequential_t *model, size_t size, size_t alignment)
+{
+  void *pointer = model->allocator.alloc(model->allocator.context, size, alignment);
 
-  return(0);
+  assert(pointer != NULL);
+  assert((uintptr_t)pointer % alignment == 0);
+
+  return pointer;
 }
 
-// ----------------------------------------------------------------------------
-// Frees the structure
-// ----------------------------------------------------------------------------
-int32_t libvibeModel_Sequential_Free(vibeModel_Sequential_t *model)
+/* Buffer sized by the frame. */
+static void *allocStorage(vibeModel_Sequential_t *model, size_t size)
 {
-  if (model == NULL)
-    return(-1);
+  return allocAligned(model, size, VIBE_ALIGNMENT);
+}
 
-  if (model->historyBuffer == NULL) {
-    free(model);
-    return(0);
-  }
+/* historyImages or historyBuffer. */
+static void *allocHistory(vibeModel_Sequential_t *model, size_t size)
+{
+  if (!model->hugePages || (size < VIBE_HUGE_PAGE_SIZE))
+    return allocStorage(model, size);
 
-  free(model->historyImage);
-  free(model->historyBuffer);
-  free(model->jump);
-  free(model->neighbor);
-  free(model->position);
-  free(model);
+  void *pointer = allocAligned(model, size, VIBE_HUGE_PAGE_SIZE);
 
-  return(0);
+#ifdef MADV_HUGEPAGE
+  /* The whole huge pages of the block. */
+  madvise(pointer, size / VIBE_HUGE_PAGE_SIZE * VIBE_HUGE_PAGE_SIZE, MADV_HUGEPAGE);
+#endif
+
+  return pointer;
+}
+
+static void freeStorage(vibeModel_Sequential_t *model, void *pointer)
+{
+  if (pointer != NULL)
+    model->allocator.free(model->allocator.context, pointer);
 }
 
 // -----------------------------------------------------------------------------
-// Allocates and initializes a C1R model structure
+// Shared buffers with random values
+//
+// The jump, neighbor and position buffers of a model only depend on its
+// width, height, updateFactor, numberOfSamples and seed: they are drawn from a
+// stream of their own, and the models with the same configuration share a
+// single read-only copy, counted by its references (e.g. many streams of the
+// same resolution). A model reads them from random shifts drawn from its own
+// stream, as before. The copies are found in a list under a lock, and are
+// freed with their last model.
 // -----------------------------------------------------------------------------
-int32_t libvibeModel_Sequential_AllocInit_8u_C1R(
-  vibeModel_Sequential_t *model,
-  const uint8_t *image_data,
-  const uint32_t width,
-  const uint32_t height
-) {
-  /* Some basic checks. */
-  assert((image_data != NULL) && (model != NULL));
-  assert((width > 0) && (height > 0));
+struct vibeTables
+{
+  /* Configuration. */
+  uint32_t width;
+  uint32_t height;
+  uint32_t updateFactor;
+  uint32_t numberOfSamples;
+  uint32_t seed;
 
-  /* Finish model alloc - parameters values cannot be changed anymore. */
-  model->width = width;
-  model->height = height;
+  /* Models using the buffers, and next copy of the list. */
+  uint32_t references;
+  vibeTables_t *next;
 
-  /* Creates the historyImage structure. */
-  model->historyImage = NULL;
-  model->historyImage = (uint8_t*)malloc(NUMBER_OF_HISTORY_IMAGES * width * height * sizeof(*(model->historyImage)));
+  uint32_t *jump;
+  int *neighbor;
+  uint32_t *position;
+};
 
-  assert(model->historyImage != NULL);
+static pthread_mutex_t tablesLock = PTHREAD_MUTEX_INITIALIZER;
+static vibeTables_t *tablesList = NULL;
+
+/* Number of values of the buffers with random values. */
+static inline uint32_t tableSizeOf(uint32_t width, uint32_t height)
+{
+  return (width > height) ? 2 * width + 1 : 2 * height + 1;
+}
 
-  for (int i = 0; i < NUMBER_OF_HISTORY_IMAGES; ++i) {
-    for (int index = width * height - 1; index >= 0; --index)
-      model->historyImage[i * width * height + index] = image_data[index];
+static vibeTables_t *newTables(uint32_t width, uint32_t height, uint32_t updateFactor, uint32_t numberOfSamples, uint32_t seed)
+{
+  vibeTables_t *tables = (vibeTables_t *)calloc(1, sizeof(*tables));
+  assert(tables != NULL);
+
+  uint32_t size = tableSizeOf(width, height);
+
+  tables->width           = width;
+  tables->height          = height;
+  tables->updateFactor    = updateFactor;
+  tables->numberOfSamples = numberOfSamples;
+  tables->seed            = seed;
+
+  tables->jump = (uint32_t *)alignedAlloc(NULL, size * sizeof(*(tables->jump)), VIBE_ALIGNMENT);
+  tables->neighbor = (int *)alignedAlloc(NULL, size * sizeof(*(tables->neighbor)), VIBE_ALIGNMENT);
+  tables->position = (uint32_t *)alignedAlloc(NULL, size * sizeof(*(tables->position)), VIBE_ALIGNMENT);
+  assert((tables->jump != NULL) && (tables->neighbor != NULL) && (tables->position != NULL));
+
+  /* A stream apart from that of the models with this seed. */
+  vibeRandom_t random;
+  vibe_srand(&random, ~(uint64_t)seed);
+
+  for (uint32_t i = 0; i < size; ++i) {
+    tables->jump[i] = (updateFactor == 1) ? 1 : vibe_rand_below(&random, 2 * updateFactor) + 1;                  // 1 or values between 1 and 2 * updateFactor.
+    tables->neighbor[i] = ((int)vibe_rand_below(&random, 3) - 1) + ((int)vibe_rand_below(&random, 3) - 1) * width; // Values between { -width - 1, ... , width + 1 }.
+    tables->position[i] = vibe_rand_below(&random, numberOfSamples);                                              // Values between 0 and numberOfSamples - 1.
   }
 
-  /* Now creates and fills the history buffer. */
-  model->historyBuffer = (uint8_t*)malloc(width * height * (model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES) * sizeof(uint8_t));
-  assert(model->historyBuffer != NULL);
+  return(tables);
+}
 
-  for (int index = width * height - 1; index >= 0; --index) {
-    uint8_t value = image_data[index];
+/* Buffers of a configuration, with one more reference. */
+static vibeTables_t *acquireTables(uint32_t width, uint32_t height, uint32_t updateFactor, uint32_t numberOfSamples, uint32_t seed)
+{
+  pthread_mutex_lock(&tablesLock);
 
-    for (int x = 0; x < model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES; ++x) {
-      int value_plus_noise = value + rand() % 20 - 10;
+  vibeTables_t *tables = tablesList;
 
-      if (value_plus_noise < 0) { value_plus_noise = 0; }
-      if (value_plus_noise > 255) { value_plus_noise = 255; }
+  while ((tables != NULL) &&
+         ((tables->width != width) || (tables->height != height) || (tables->updateFactor != updateFactor) ||
+          (tables->numberOfSamples != numberOfSamples) || (tables->seed != seed)))
+    tables = tables->next;
 
-      model->historyBuffer[index * (model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES) + x] = value_plus_noise;
-    }
+  if (tables == NULL) {
+    tables = newTables(width, height, updateFactor, numberOfSamples, seed);
+    tables->next = tablesList;
+    tablesList = tables;
   }
 
-  /* Fills the buffers with random values. */
-  int size = (width > height) ? 2 * width + 1 : 2 * height + 1;
+  ++tables->references;
 
-  model->jump = (uint32_t*)malloc(size * sizeof(*(model->jump)));
-  assert(model->jump != NULL);
+  pthread_mutex_unlock(&tablesLock);
+
+  return(tables);
+}
+
+/* Drops a reference, and frees the buffers with the last one. */
+static void releaseTables(vibeTables_t *tables)
+{
+  if (tables == NULL)
+    return;
+
+  pthread_mutex_lock(&tablesLock);
 
-  model->neighbor = (int*)malloc(size * sizeof(*(model->neighbor)));
-  assert(model->neighbor != NULL);
+  if (--tables->references == 0) {
+    vibeTables_t **link = &tablesList;
 
-  model->position = (uint32_t*)malloc(size * sizeof(*(model->position)));
-  assert(model->position != NULL);
+    while (*link != tables)
+      link = &(*link)->next;
 
-  for (int i = 0; i < size; ++i) {
-    model->jump[i] = (rand() % (2 * model->updateFactor)) + 1;            // Values between 1 and 2 * updateFactor.
-    model->neighbor[i] = ((rand() % 3) - 1) + ((rand() % 3) - 1) * width; // Values between { -width - 1, ... , width + 1 }.
-    model->position[i] = rand() % (model->numberOfSamples);               // Values between 0 and numberOfSamples - 1.
+    *link = tables->next;
+
+    alignedFree(NULL, tables->jump);
+    alignedFree(NULL, tables->neighbor);
+    alignedFree(NULL, tables->position);
+    free(tables);
   }
 
-  return(0);
+  pthread_mutex_unlock(&tablesLock);
+}
+
+/* Points the buffers of a model at the shared copy of its configuration. */
+static void useTables(vibeModel_Sequential_t *model)
+{
+  vibeTables_t *tables = acquireTables(model->width, model->height, model->updateFactor, model->numberOfSamples, model->seed);
+
+  releaseTables(model->tables);
+
+  model->tables   = tables;
+  model->jump     = tables->jump;
+  model->neighbor = tables->neighbor;
+  model->position = tables->position;
 }
 
 // -----------------------------------------------------------------------------
-// Segmentation of a C1R model
+// Counters (compiled with -DVIBE_STATS only, see libvibeModel_Sequential_GetStats)
+//
+// The bands add their counts to the counters of the model once per run of
+// pixels or band of rows, with relaxed atomic additions.
 // -----------------------------------------------------------------------------
-int32_t libvibeModel_Sequential_Segmentation_8u_C1R(
-  vibeModel_Sequential_t *model,
-  const uint8_t *image_data,
-  uint8_t *segmentation_map
-) {
-  /* Basic checks. */
-  assert((image_data != NULL) && (model != NULL) && (segmentation_map != NULL));
-  assert((model->width > 0) && (model->height > 0));
-  assert(model->historyBuffer != NULL);
-  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+#ifdef VIBE_STATS
+static inline void addCount(uint64_t *counter, uint64_t value)
+{
+  __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
 
-  /* Some variables. */
-  uint32_t width = model->width;
-  uint32_t height = model->height;
-  uint32_t matchingNumber = model->matchingNumber;
-  uint32_t matchingThreshold = model->matchingThreshold;
+/* Run of numberOfPixels pixels segmented, numberOfTails of them searched in the historyBuffer. */
+static void countSegmentation(vibeModel_Sequential_t *model, uint32_t numberOfPixels, uint32_t numberOfTails, const vibeTailCounts_t *tailCounts)
+{
+  addCount(&model->stats.segmentedPixels, numberOfPixels);
+  addCount(&model->stats.tailPixels, numberOfTails);
+  addCount(&model->stats.testedSamples, (uint64_t)numberOfPixels * model->numberOfHistoryImages + tailCounts->testedSamples);
+  addCount(&model->stats.swappedSamples, tailCounts->swappedSamples);
+  addCount(&model->stats.movedSamples, tailCounts->movedSamples);
+}
 
-  uint8_t *historyImage = model->historyImage;
-  uint8_t *historyBuffer = model->historyBuffer;
+/* Samples written by the update, at the updated pixels and into their neighbors. */
+static void countUpdate(vibeModel_Sequential_t *model, uint64_t pixelWrites, uint64_t neighborWrites)
+{
+  addCount(&model->stats.updateWrites, pixelWrites + neighborWrites);
+  addCount(&model->stats.neighborWrites, neighborWrites);
+}
+#endif
 
-  /* Segmentation. */
-  memset(segmentation_map, matchingNumber - 1, width * height);
+// -----------------------------------------------------------------------------
+// Input images
+//
+// The rows of the input images may be padded (imageStep bytes from a row to
+// the next one, see libvibeModel_Sequential_SetImageStep), and the pixels of
+// a C3R model may come with a fourth byte (C4R functions). Such images are
+// read in place: the segmentation works on runs of contiguous pixels (whole
+// bands when the rows are not padded) and the update addresses the pixels row
+// by row.
+// -----------------------------------------------------------------------------
 
-  /* First history Image structure. */
-  for (int index = width * height - 1; index >= 0; --index) {
-    if (abs_uint(image_data[index] - historyImage[index]) > matchingThreshold)
-      segmentation_map[index] = matchingNumber;
-  }
+/* Bytes from a row of the input images to the next one. */
+static inline size_t inputStep(const vibeModel_Sequential_t *model)
+{
+  size_t rowSize = (size_t)model->width * model->inputChannels * model->sampleSize;
 
-  /* Next historyImages. */
-  for (int i = 1; i < NUMBER_OF_HISTORY_IMAGES; ++i) {
-    uint8_t *pels = historyImage + i * width * height;
+  assert((model->imageStep == 0) || (model->imageStep >= rowSize));
 
-    for (int index = width * height - 1; index >= 0; --index) {
-      if (abs_uint(image_data[index] - pels[index]) <= matchingThreshold)
-        --segmentation_map[index];
-    }
+  return (model->imageStep != 0) ? model->imageStep : rowSize;
+}
+
+/* Address of pixel "index" of an input image. */
+static inline const uint8_t *inputPixel(const vibeModel_Sequential_t *model, const uint8_t *image_data, uint32_t index)
+{
+  return image_data + (index / model->width) * inputStep(model) + (size_t)(index % model->width) * model->inputChannels * model->sampleSize;
+}
+
+/* Spans of row y visited by the segmentation and the update: those of the
+ * region of interest, or a single span that the callers clip to the row.
+ */
+static const vibeSpan_t frameSpan = { 0, UINT32_MAX };
+
+static inline uint32_t rowSpans(const vibeModel_Sequential_t *model, uint32_t y, const vibeSpan_t **spans)
+{
+  if (model->roiRows == NULL) {
+    *spans = &frameSpan;
+    return 1;
   }
 
-  /* For swapping. */
-  model->lastHistoryImageSwapped = (model->lastHistoryImageSwapped + 1) % NUMBER_OF_HISTORY_IMAGES;
-  uint8_t *swappingImageBuffer = historyImage + (model->lastHistoryImageSwapped) * width * height;
+  *spans = model->roiSpans + model->roiRows[y];
 
-  /* Now, we move in the buffer and leave the historyImages. */
-  int numberOfTests = (model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES);
+  return model->roiRows[y + 1] - model->roiRows[y];
+}
 
-  for (int index = width * height - 1; index >= 0; --index) {
-    if (segmentation_map[index] > 0) {
-      /* We need to check the full border and swap values with the first or second historyImage.
-       * We still need to find a match before we can stop our search.
-       */
-      uint32_t indexHistoryBuffer = index * numberOfTests;
-      uint8_t currentValue = image_data[index];
+/* Whether pixel "index" is in the region of interest (for the border of the frame). */
+static inline int inROI(const vibeModel_Sequential_t *model, uint32_t index)
+{
+  if (model->roiRows == NULL)
+    return 1;
 
-      for (int i = numberOfTests; i > 0; --i, ++indexHistoryBuffer) {
-        if (abs_uint(currentValue - historyBuffer[indexHistoryBuffer]) <= matchingThreshold) {
-          --segmentation_map[index];
+  uint32_t x = index % model->width;
+  uint32_t y = index / model->width;
 
-          /* Swaping: Putting found value in history image buffer. */
-          uint8_t temp = swappingImageBuffer[index];
-          swappingImageBuffer[index] = historyBuffer[indexHistoryBuffer];
-          historyBuffer[indexHistoryBuffer] = temp;
+  for (uint32_t s = model->roiRows[y]; s < model->roiRows[y + 1]; ++s) {
+    if ((x >= model->roiSpans[s].first) && (x < model->roiSpans[s].last))
+      return 1;
+  }
 
-          /* Exit inner loop. */
-          if (segmentation_map[index] <= 0) break;
-        }
-      } // for
-    } // if
-  } // for
+  return 0;
+}
+
+/* Copy of an input image with "channels" channels and without padding, for
+ * the initialization of a model (NULL if the input image is already so).
+ */
+static uint8_t *packInput(const vibeModel_Sequential_t *model, const uint8_t *image_data, uint32_t channels)
+{
+  size_t step = inputStep(model);
+  size_t pixelSize = channels * model->sampleSize;
+  size_t inputPixelSize = model->inputChannels * model->sampleSize;
 
-  /* Produces the output. Note that this step is application-dependent. */
-  for (uint8_t *mask = segmentation_map; mask < segmentation_map + (width * height); ++mask)
-    if (*mask > 0) *mask = COLOR_FOREGROUND;
+  if ((channels == model->inputChannels) && (step == model->width * pixelSize))
+    return(NULL);
 
-  return(0);
+  uint8_t *packed = (uint8_t *)malloc(model->width * model->height * pixelSize);
+  assert(packed != NULL);
+
+  for (uint32_t y = 0; y < model->height; ++y) {
+    for (uint32_t x = 0; x < model->width; ++x)
+      memcpy(packed + ((size_t)y * model->width + x) * pixelSize, image_data + y * step + x * inputPixelSize, pixelSize);
+  }
+
+  return(packed);
 }
 
-// ----------------------------------------------------------------------------
+/* Segmentation of the pixels [first, first + numberOfPixels), with image_data and
+ * segmentation_map pointing at pixel first (of the input image and of the map).
+ */
+typedef void (*vibeSegmentation_fn)(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map,
+  uint32_t first,
+  uint32_t numberOfPixels
+);
+
+/* Static blocks are used by the 8u C1R, C3R and C4R models. */
+static inline int hasStaticBlocks(const vibeModel_Sequential_t *model)
+{
+  return (model->staticBlockThreshold >= 0) && (model->sampleSize == 1) && (model->chromaFormat == 0);
+}
+
+static inline uint32_t numberOfBlocks(uint32_t size)
+{
+  return (size + VIBE_BLOCK_SIZE - 1) / VIBE_BLOCK_SIZE;
+}
+
+/* Segmentation of the pixels [x0, x1) of row y, the pixels of the static blocks
+ * skipped by the current segmentation excepted: these are background (row
+ * points at the first pixel of the row, segmentation_map at pixel x0).
+ */
+static void segmentBlocks(
+  vibeModel_Sequential_t *model,
+  vibeSegmentation_fn segmentation,
+  const uint8_t *row,
+  uint8_t *segmentation_map,
+  uint32_t y,
+  uint32_t x0,
+  uint32_t x1
+) {
+  size_t pixelSize = model->inputChannels * model->sampleSize;
+
+  if (!hasStaticBlocks(model)) {
+    segmentation(model, row + x0 * pixelSize, segmentation_map, y * model->width + x0, x1 - x0);
+    return;
+  }
+
+  const uint8_t *state = model->blockState + (y / VIBE_BLOCK_SIZE) * numberOfBlocks(model->width);
+
+  /* Runs of blocks that are all skipped, or all segmented. */
+  for (uint32_t x = x0; x < x1;) {
+    uint8_t skipped = state[x / VIBE_BLOCK_SIZE] & VIBE_BLOCK_SKIPPED;
+    uint32_t end = (x / VIBE_BLOCK_SIZE + 1) * VIBE_BLOCK_SIZE;
+
+    while ((end < x1) && ((state[end / VIBE_BLOCK_SIZE] & VIBE_BLOCK_SKIPPED) == skipped))
+      end += VIBE_BLOCK_SIZE;
+
+    if (end > x1)
+      end = x1;
+
+    if (skipped)
+      memset(segmentation_map + (x - x0), COLOR_BACKGROUND, end - x);
+    else
+      segmentation(model, row + x * pixelSize, segmentation_map + (x - x0), y * model->width + x, end - x);
+
+    x = end;
+  }
+}
+
+/* Segmentation of the pixels [x0, x1) of row y that are in the region of
+ * interest (row points at the first pixel of the row, segmentation_map at
+ * pixel x0); the other pixels get the label of the region.
+ */
+static void segmentSpans(
+  vibeModel_Sequential_t *model,
+  vibeSegmentation_fn segmentation,
+  const uint8_t *row,
+  uint8_t *segmentation_map,
+  uint32_t y,
+  uint32_t x0,
+  uint32_t x1
+) {
+  const vibeSpan_t *spans;
+  uint32_t numberOfSpans = rowSpans(model, y, &spans);
+  uint32_t x = x0;
+
+  for (uint32_t s = 0; (s < numberOfSpans) && (spans[s].first < x1); ++s) {
+    uint32_t first = (spans[s].first > x) ? spans[s].first : x;
+    uint32_t last = (spans[s].last < x1) ? spans[s].last : x1;
+
+    if (first >= last)
+      continue;
+
+    memset(segmentation_map + (x - x0), model->roiLabel, first - x);
+    segmentBlocks(model, segmentation, row, segmentation_map + (first - x0), y, first, last);
+    x = last;
+  }
+
+  memset(segmentation_map + (x - x0), model->roiLabel, x1 - x);
+}
+
+/* Segmentation of the pixels [first, first + numberOfPixels) of an input image,
+ * in a single run when the rows are contiguous (and without region of
+ * interest nor static blocks), row by row otherwise.
+ */
+static void segmentInput(
+  vibeModel_Sequential_t *model,
+  vibeSegmentation_fn segmentation,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map,
+  uint32_t first,
+  uint32_t numberOfPixels
+) {
+  uint32_t width = model->width;
+  size_t step = inputStep(model);
+  size_t pixelSize = model->inputChannels * model->sampleSize;
+
+  if ((step == width * pixelSize) && (model->roiRows == NULL) && !hasStaticBlocks(model)) {
+    segmentation(model, image_data + first * pixelSize, segmentation_map, first, numberOfPixels);
+    return;
+  }
+
+  while (numberOfPixels > 0) {
+    uint32_t x = first % width;
+    uint32_t size = (width - x < numberOfPixels) ? width - x : numberOfPixels;
+    const uint8_t *row = image_data + (first / width) * step;
+
+    if (model->roiRows == NULL)
+      segmentBlocks(model, segmentation, row, segmentation_map, first / width, x, x + size);
+    else
+      segmentSpans(model, segmentation, row, segmentation_map, first / width, x, x + size);
+
+    segmentation_map += size;
+    first += size;
+    numberOfPixels -= size;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Row bands
+//
+// With several threads, a frame is split into horizontal bands of rows, one
+// per thread. The segmentation of a pixel does not depend on the other pixels,
+// so the bands are simply processed in parallel. The update may write in the
+// row above and in the row below (neighbor diffusion): the inner rows of every
+// band are updated in parallel, then the first and last rows of the bands are
+// updated one band after the other, in the band order. Each band draws its
+// random numbers from its own stream, seeded from the stream of the model at
+// every frame; the results therefore only depend on the seed and on the
+// number of threads.
+// -----------------------------------------------------------------------------
+typedef struct vibeProcessSteps vibeProcessSteps_t;
+
+typedef struct
+{
+  vibeModel_Sequential_t *model;
+  const uint8_t *image_data;
+  uint8_t *map;
+  uint32_t numberOfBands;
+  int packed;
+  const vibeProcessSteps_t *steps;
+} vibeBandJob_t;
+
+/* First row of a band (the last band ends at row "rows"). */
+static inline uint32_t bandRow(uint32_t rows, uint32_t numberOfBands, uint32_t band)
+{
+  return (uint32_t)(((uint64_t)rows * band) / numberOfBands);
+}
+
+static inline uint32_t numberOfBands(const vibeModel_Sequential_t *model, uint32_t rows)
+{
+  return (model->numberOfThreads < rows) ? model->numberOfThreads : ((rows > 0) ? rows : 1);
+}
+
+/* Updating masks hold one byte per pixel (COLOR_BACKGROUND or COLOR_FOREGROUND),
+ * or one bit per pixel when packed (see libvibeModel_Sequential_Segmentation_8u1u_C1R).
+ */
+static inline int isBackground(const uint8_t *updating_mask, int packed, uint32_t index)
+{
+  if (packed)
+    return !((updating_mask[index >> 3] >> (index & 7)) & 1);
+
+  return (updating_mask[index] == COLOR_BACKGROUND);
+}
+
+static void runTasks(vibeModel_Sequential_t *model, vibeTask_fn task, void *context, uint32_t numberOfTasks)
+{
+  if (model->numberOfThreads > 1) {
+    /* The workers are started at the first multi-threaded call. */
+    if (model->pool == NULL)
+      model->pool = libvibeThreadPool_New(model->numberOfThreads);
+
+    libvibeThreadPool_Run(model->pool, task, context, numberOfTasks);
+  }
+  else {
+    for (uint32_t band = 0; band < numberOfTasks; ++band)
+      task(context, band);
+  }
+}
+
+static void runBands(vibeModel_Sequential_t *model, vibeTask_fn task, vibeBandJob_t *job)
+{
+  runTasks(model, task, job, job->numberOfBands);
+}
+
+/* Number of rows segmented and then updated together by the Process functions.
+ * Apart from the undecided pixels, the segmentation streams the input, the
+ * historyImages and the output, and the update writes about two cache lines
+ * every updateFactor pixels: a strip is sized so that this fits in the L2
+ * cache (VIBE_L2_CACHE_SIZE bytes).
+ */
+static inline uint32_t stripRows(const vibeModel_Sequential_t *model, uint32_t channels)
+{
+  size_t pixelSize = channels * (model->numberOfHistoryImages + 1) + 1 + (2 * 64) / model->updateFactor;
+  size_t rows = VIBE_L2_CACHE_SIZE / (pixelSize * model->width);
+
+  return (rows > 2) ? (uint32_t)rows : 2;
+}
+
+/* Seeds the streams of the bands, in the band order, from the stream of the model. */
+static void seedBands(vibeModel_Sequential_t *model, uint32_t numberOfBands)
+{
+  for (uint32_t band = 0; band < numberOfBands; ++band) {
+    uint64_t seed = vibe_rand(&model->random);
+    vibe_srand(&model->bandRandom[band], (seed << 32) | vibe_rand(&model->random));
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Static blocks
+//
+// On fixed cameras, many blocks of VIBE_BLOCK_SIZE x VIBE_BLOCK_SIZE pixels
+// hardly change from a frame to the next. The signature of an image is made
+// of the sums of the groups of 8 bytes of its rows (a SIMD pass over the
+// input image, a quarter of its size). Before a segmentation, the blocks whose
+// pixels were all background at their last segmentation compare their
+// signature with that of the input of that segmentation: the blocks whose
+// signatures differ by at most staticBlockThreshold (sum of the absolute
+// differences of the sums, a lower bound of the SAD of the pixels) are
+// skipped, i.e. their pixels are background without any test of the samples.
+// The other blocks take the signature of the input, and record after the
+// segmentation whether all their pixels are background. Since a skipped block
+// keeps its signature, slow changes add up until the block is segmented
+// again. The update is not changed.
+// -----------------------------------------------------------------------------
+
+/* Number of sums of a row of the signatures, and of a row of a block. */
+static inline uint32_t rowSums(const vibeModel_Sequential_t *model)
+{
+  return (model->width * model->inputChannels + 7) / 8;
+}
+
+static inline uint32_t blockSums(const vibeModel_Sequential_t *model)
+{
+  return VIBE_BLOCK_SIZE * model->inputChannels / 8;
+}
+
+/* Signatures and skipped blocks of the rows of blocks [firstRow, lastRow). */
+static void checkBlocks(vibeModel_Sequential_t *model, const uint8_t *image_data, uint32_t firstRow, uint32_t lastRow)
+{
+  uint32_t blocks = numberOfBlocks(model->width);
+  uint32_t sums = rowSums(model);
+  size_t step = inputStep(model);
+  uint16_t *reference = model->blockSums;
+  uint16_t *current = model->blockSums + (size_t)sums * model->height;
+
+  for (uint32_t by = firstRow; by < lastRow; ++by) {
+    uint32_t y0 = by * VIBE_BLOCK_SIZE;
+    uint32_t y1 = (y0 + VIBE_BLOCK_SIZE < model->height) ? y0 + VIBE_BLOCK_SIZE : model->height;
+
+    /* Differences of the sums, added up over the rows of the blocks (at most 16 * 2040). */
+    uint16_t *differences = model->blockSums + 2 * (size_t)sums * model->height + (size_t)by * sums;
+
+    memset(differences, 0, sums * sizeof(*differences));
+
+    for (uint32_t y = y0; y < y1; ++y) {
+      const uint16_t *referenceRow = reference + (size_t)y * sums;
+      uint16_t *currentRow = current + (size_t)y * sums;
+
+      model->kernels->sums_8u(image_data + y * step, model->width * model->inputChannels, currentRow);
+
+      for (uint32_t i = 0; i < sums; ++i)
+        differences[i] += (uint16_t)abs_uint(currentRow[i] - referenceRow[i]);
+    }
+
+    for (uint32_t bx = 0; bx < blocks; ++bx) {
+      uint8_t *state = &model->blockState[by * blocks + bx];
+      uint32_t s0 = bx * blockSums(model);
+      uint32_t s1 = (s0 + blockSums(model) < sums) ? s0 + blockSums(model) : sums;
+      uint32_t difference = 0;
+
+      *state &= VIBE_BLOCK_BACKGROUND;
+
+      if (!(*state & VIBE_BLOCK_BACKGROUND))
+        continue;
+
+      for (uint32_t i = s0; i < s1; ++i)
+        difference += differences[i];
+
+      if (difference <= (uint32_t)model->staticBlockThreshold)
+        *state |= VIBE_BLOCK_SKIPPED;
+    }
+
+    /* The blocks that are segmented record their signature (while in cache), by runs of blocks. */
+    const uint8_t *state = model->blockState + by * blocks;
+
+    for (uint32_t bx = 0; bx < blocks;) {
+      uint32_t end = bx;
+
+      while ((end < blocks) && !(state[end] & VIBE_BLOCK_SKIPPED))
+        ++end;
+
+      if (end > bx) {
+        uint32_t s0 = bx * blockSums(model);
+        uint32_t s1 = (end * blockSums(model) < sums) ? end * blockSums(model) : sums;
+
+        for (uint32_t y = y0; y < y1; ++y)
+          memcpy(reference + (size_t)y * sums + s0, current + (size_t)y * sums + s0, (s1 - s0) * sizeof(*reference));
+      }
+
+      bx = end + 1;
+    }
+  }
+}
+
+/* Whether the pixels [x0, x1) of the rows [y0, y1) are all background. */
+static int isBackgroundBlock(
+  const vibeModel_Sequential_t *model,
+  const uint8_t *segmentation_map,
+  int packed,
+  uint32_t x0,
+  uint32_t x1,
+  uint32_t y0,
+  uint32_t y1
+) {
+  uint32_t width = model->width;
+  uint8_t labels = 0;
+
+  for (uint32_t y = y0; (y < y1) && (labels == 0); ++y) {
+    if (packed) {
+      for (uint32_t index = y * width + x0; index < y * width + x1; ++index)
+        labels |= (segmentation_map[index >> 3] >> (index & 7)) & 1;
+    }
+    else {
+      const uint8_t *row = segmentation_map + y * width;
+      uint32_t x = x0;
+
+      /* By words of 8 labels. */
+      for (uint64_t words = 0; x + 8 <= x1; x += 8) {
+        memcpy(&words, row + x, sizeof(words));
+        labels |= (words != UINT64_C(0x0101010101010101) * COLOR_BACKGROUND);
+      }
+
+      for (; x < x1; ++x)
+        labels |= row[x] ^ COLOR_BACKGROUND;
+    }
+  }
+
+  return (labels == 0);
+}
+
+/* State of the segmented blocks of the rows of blocks [firstRow, lastRow). */
+static void recordBlocks(
+  vibeModel_Sequential_t *model,
+  const uint8_t *segmentation_map,
+  int packed,
+  uint32_t firstRow,
+  uint32_t lastRow
+) {
+  uint32_t width = model->width;
+  uint32_t blocks = numberOfBlocks(width);
+
+  for (uint32_t by = firstRow; by < lastRow; ++by) {
+    uint8_t *state = model->blockState + by * blocks;
+    uint32_t y0 = by * VIBE_BLOCK_SIZE;
+    uint32_t y1 = (y0 + VIBE_BLOCK_SIZE < model->height) ? y0 + VIBE_BLOCK_SIZE : model->height;
+
+    for (uint32_t bx = 0; bx < blocks; ++bx) {
+      uint32_t x0 = bx * VIBE_BLOCK_SIZE;
+      uint32_t x1 = (x0 + VIBE_BLOCK_SIZE < width) ? x0 + VIBE_BLOCK_SIZE : width;
+
+      if ((state[bx] & VIBE_BLOCK_SKIPPED) || isBackgroundBlock(model, segmentation_map, packed, x0, x1, y0, y1))
+        state[bx] = VIBE_BLOCK_BACKGROUND;
+      else
+        state[bx] = 0;
+    }
+  }
+}
+
+static void checkBlocksTask(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t rows = numberOfBlocks(job->model->height);
+
+  checkBlocks(job->model, job->image_data, bandRow(rows, job->numberOfBands, band), bandRow(rows, job->numberOfBands, band + 1));
+}
+
+static void recordBlocksTask(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t rows = numberOfBlocks(job->model->height);
+
+  recordBlocks(job->model, job->map, job->packed, bandRow(rows, job->numberOfBands, band), bandRow(rows, job->numberOfBands, band + 1));
+}
+
+/* The state of the blocks is allocated before the first segmentation (no block is skipped by it). */
+static void allocBlocks(vibeModel_Sequential_t *model)
+{
+  if (model->blockState != NULL)
+    return;
+
+  /* Reference and current signatures, and differences of the rows of blocks. */
+  size_t rows = 2 * (size_t)model->height + numberOfBlocks(model->height);
+
+  size_t blocks = (size_t)numberOfBlocks(model->width) * numberOfBlocks(model->height);
+
+  model->blockSums = (uint16_t *)allocStorage(model, rows * rowSums(model) * sizeof(*model->blockSums));
+  model->blockState = (uint8_t *)allocStorage(model, blocks);
+  memset(model->blockSums, 0, rows * rowSums(model) * sizeof(*model->blockSums));
+  memset(model->blockState, 0, blocks);
+}
+
+/* Before a segmentation. */
+static void beginStaticBlocks(vibeModel_Sequential_t *model, const uint8_t *image_data)
+{
+  if (!hasStaticBlocks(model))
+    return;
+
+  allocBlocks(model);
+
+  vibeBandJob_t job = { model, image_data, NULL, numberOfBands(model, numberOfBlocks(model->height)) };
+  runBands(model, checkBlocksTask, &job);
+}
+
+/* After a segmentation. */
+static void endStaticBlocks(vibeModel_Sequential_t *model, const uint8_t *segmentation_map, int packed)
+{
+  if (!hasStaticBlocks(model))
+    return;
+
+  vibeBandJob_t job = { model, NULL, (uint8_t *)segmentation_map, numberOfBands(model, numberOfBlocks(model->height)), packed };
+  runBands(model, recordBlocksTask, &job);
+}
+
+// -----------------------------------------------------------------------------
+// Steps of the Process functions
+//
+// A frame is processed in three steps: beginProcess (swapping and random
+// streams of the bands), the bands (in parallel), and endProcess (edges of
+// the bands and border of the frame, in this order). The steps of a type of
+// model are given by its vibeProcessSteps_t, so that the bands of several
+// models can also be run together (see libvibeModel_Sequential_ProcessBatch).
+// -----------------------------------------------------------------------------
+struct vibeProcessSteps
+{
+  /* Band of a frame split into several bands. */
+  vibeTask_fn task;
+
+  /* Segmentation and update of the rows of a frame processed in a single band. */
+  void (*rows)(
+    vibeModel_Sequential_t *model,
+    const uint8_t *image_data,
+    uint8_t *segmentation_map,
+    uint32_t firstRow,
+    uint32_t lastRow,
+    uint32_t firstUpdate,
+    uint32_t lastUpdate,
+    vibeRandom_t *random
+  );
+
+  /* Update of the edges of the bands, and of the border of the frame. */
+  void (*edges)(vibeModel_Sequential_t *model, const uint8_t *image_data, const uint8_t *updating_mask, int packed, uint32_t numberOfBands);
+  void (*borders)(vibeModel_Sequential_t *model, const uint8_t *image_data, const uint8_t *updating_mask, int packed);
+
+  /* Substitution of the sample "position" of a pixel of the border by its input (see libvibeModel_Sequential_ProcessFrames). */
+  void (*sample)(vibeModel_Sequential_t *model, const uint8_t *image_data, uint32_t index, uint32_t position);
+};
+
+/* A frame is split into bands when the model has several threads (and inner rows), and a set of samples per pixel. */
+static inline int isBanded(const vibeModel_Sequential_t *model)
+{
+  return (model->numberOfThreads > 1) && (model->height > 2) && (model->sampleBlockSize == 1);
+}
+
+static void beginProcess(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map,
+  const vibeProcessSteps_t *steps,
+  vibeBandJob_t *job
+) {
+  /* For swapping. */
+  model->lastHistoryImageSwapped = (model->lastHistoryImageSwapped + 1) % model->numberOfHistoryImages;
+
+  job->model = model;
+  job->image_data = image_data;
+  job->map = segmentation_map;
+  job->numberOfBands = isBanded(model) ? numberOfBands(model, model->height - 2) : 1;
+  job->packed = 0;
+  job->steps = steps;
+
+  /* The bands of the update, each one segmented and updated by the same thread. */
+  if (isBanded(model))
+    seedBands(model, job->numberOfBands);
+}
+
+static void processBandTask(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  vibeModel_Sequential_t *model = job->model;
+
+  if (isBanded(model))
+    job->steps->task(job, band);
+  else
+    job->steps->rows(model, job->image_data, job->map, 0, model->height, 1, model->height - 1, &model->random);
+}
+
+static void endProcess(vibeBandJob_t *job)
+{
+  /* Then, one band after the other, the rows next to the other bands. */
+  if (isBanded(job->model))
+    job->steps->edges(job->model, job->image_data, job->map, 0, job->numberOfBands);
+
+  job->steps->borders(job->model, job->image_data, job->map, 0);
+}
+
+/* Segmentation and update of a frame, with the threads of the model. */
+static void process(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map,
+  const vibeProcessSteps_t *steps
+) {
+  vibeBandJob_t job;
+
+  beginStaticBlocks(model, image_data);
+  beginProcess(model, image_data, segmentation_map, steps, &job);
+  runBands(model, processBandTask, &job);
+  endProcess(&job);
+  endStaticBlocks(model, segmentation_map, 0);
+}
+
+// -----------------------------------------------------------------------------
+// Print parameters
+// -----------------------------------------------------------------------------
+uint32_t libvibeModel_Sequential_PrintParameters(const vibeModel_Sequential_t *model)
+{
+  printf(
+    "Using ViBe background subtraction algorithm\n"
+      "  - Number of samples per pixel:       %03d\n"
+      "  - Number of matches needed:          %03d\n"
+      "  - Matching threshold:                %03d\n"
+      "  - Model update subsampling factor:   %03d\n",
+    libvibeModel_Sequential_GetNumberOfSamples(model),
+    libvibeModel_Sequential_GetMatchingNumber(model),
+    libvibeModel_Sequential_GetMatchingThreshold(model),
+    libvibeModel_Sequential_GetUpdateFactor(model)
+  );
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Creates the data structure
+// -----------------------------------------------------------------------------
+vibeModel_Sequential_t *libvibeModel_Sequential_New()
+{
+  /* Model structure alloc. */
+  vibeModel_Sequential_t *model = NULL;
+  model = (vibeModel_Sequential_t*)calloc(1, sizeof(*model));
+  assert(model != NULL);
+
+  /* Default parameters values. */
+  model->numberOfSamples         = 20;
+  model->matchingThreshold       = 20;
+  model->matchingNumber          = 2;
+  model->updateFactor            = 16;
+
+  /* Storage for the history. */
+  model->numberOfHistoryImages   = 0;
+  model->sampleSize              = 1;
+  model->historyImage            = NULL;
+  model->historyBuffer           = NULL;
+  model->lastHistoryImageSwapped = 0;
+  model->layout                  = VIBE_LAYOUT_INTERLEAVED;
+  model->bufferLayout            = VIBE_BUFFER_PIXEL_MAJOR;
+  model->sampleBlockSize         = 1;
+  model->blockColumns            = 0;
+  model->sampleFormat            = VIBE_SAMPLE_RGB888;
+  model->sampleOrdering          = VIBE_ORDERING_SWAP;
+
+  /* Input images without padding. */
+  model->inputChannels           = 1;
+  model->imageStep               = 0;
+  model->chromaFormat            = 0;
+
+  /* Buffers with random values. */
+  model->tables                  = NULL;
+  model->jump                    = NULL;
+  model->neighbor                = NULL;
+  model->position                = NULL;
+  model->tailIndex               = NULL;
+  model->mapping                 = NULL;
+  model->mappingSize             = 0;
+
+  /* Whole frame. */
+  model->roiRows                 = NULL;
+  model->roiSpans                = NULL;
+  model->roiLabel                = COLOR_BACKGROUND;
+
+  /* Every block segmented. */
+  model->staticBlockThreshold    = -1;
+  model->blockSums               = NULL;
+  model->blockState              = NULL;
+
+  /* Aligned storage, without huge pages. */
+  model->allocator               = defaultAllocator;
+  model->hugePages               = 0;
+
+  /* No counts yet. */
+  memset(&model->stats, 0, sizeof(model->stats));
+
+  /* SIMD kernels (chosen at run time, the scalar code is the fallback). */
+  model->kernels                 = libvibeKernels_Get();
+
+  /* Random numbers. */
+  model->seed                    = 0;
+  vibe_srand(&model->random, model->seed);
+
+  /* Single thread. */
+  model->numberOfThreads         = 1;
+  model->pool                    = NULL;
+  model->bandRandom              = NULL;
+
+  return(model);
+}
+
+// -----------------------------------------------------------------------------
+// Some "Get-ers"
+// -----------------------------------------------------------------------------
+uint32_t libvibeModel_Sequential_GetNumberOfSamples(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->numberOfSamples);
+}
+
+uint32_t libvibeModel_Sequential_GetMatchingNumber(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->matchingNumber);
+}
+
+uint32_t libvibeModel_Sequential_GetMatchingThreshold(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->matchingThreshold);
+}
+
+uint32_t libvibeModel_Sequential_GetUpdateFactor(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->updateFactor);
+}
+
+vibeModelLayout_t libvibeModel_Sequential_GetLayout(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->layout);
+}
+
+vibeBufferLayout_t libvibeModel_Sequential_GetBufferLayout(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->bufferLayout);
+}
+
+uint32_t libvibeModel_Sequential_GetNumberOfThreads(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->numberOfThreads);
+}
+
+uint32_t libvibeModel_Sequential_GetSeed(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->seed);
+}
+
+uint32_t libvibeModel_Sequential_GetNumberOfHistoryImages(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->numberOfHistoryImages);
+}
+
+uint32_t libvibeModel_Sequential_GetSampleBlockSize(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->sampleBlockSize);
+}
+
+vibeSampleFormat_t libvibeModel_Sequential_GetSampleFormat(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->sampleFormat);
+}
+
+vibeSampleOrdering_t libvibeModel_Sequential_GetSampleOrdering(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->sampleOrdering);
+}
+
+uint32_t libvibeModel_Sequential_GetImageStep(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->imageStep);
+}
+
+int32_t libvibeModel_Sequential_GetStaticBlockThreshold(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->staticBlockThreshold);
+}
+
+uint32_t libvibeModel_Sequential_GetHugePages(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->hugePages);
+}
+
+uint32_t libvibeModel_Sequential_GetWidth(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->width);
+}
+
+uint32_t libvibeModel_Sequential_GetHeight(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL); return(model->height);
+}
+
+uint32_t libvibeModel_Sequential_GetInputChannels(const vibeModel_Sequential_t *model)
+{
+  assert(model != NULL);
+
+  if ((model->historyBuffer == NULL) || (model->sampleSize != 1) || (model->chromaFormat != 0))
+    return(0);
+
+  return(model->inputChannels);
+}
+
+// -----------------------------------------------------------------------------
+// Some "Set-ers"
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetMatchingThreshold(
+  vibeModel_Sequential_t *model,
+  const uint32_t matchingThreshold
+) {
+  assert(model != NULL);
+  assert(matchingThreshold > 0);
+
+  model->matchingThreshold = matchingThreshold;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetNumberOfSamples(
+  vibeModel_Sequential_t *model,
+  const uint32_t numberOfSamples
+) {
+  assert(model != NULL);
+  assert(numberOfSamples > 0);
+
+  /* An allocated model keeps its samples. */
+  if (model->historyBuffer != NULL)
+    return(libvibeModel_Sequential_Resize(model, numberOfSamples, model->matchingNumber));
+
+  model->numberOfSamples = numberOfSamples;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetMatchingNumber(
+  vibeModel_Sequential_t *model,
+  const uint32_t matchingNumber
+) {
+  assert(model != NULL);
+  assert(matchingNumber > 0);
+
+  if (model->historyBuffer != NULL)
+    return(libvibeModel_Sequential_Resize(model, model->numberOfSamples, matchingNumber));
+
+  model->matchingNumber = matchingNumber;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetUpdateFactor(
+  vibeModel_Sequential_t *model,
+  const uint32_t updateFactor
+) {
+  assert(model != NULL);
+  assert(updateFactor > 0);
+
+  model->updateFactor = updateFactor;
+
+  /* We also need to change the values of the jump buffer: the model moves to the shared buffers of its new configuration. */
+  assert(model->jump != NULL);
+
+  useTables(model);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetLayout(
+  vibeModel_Sequential_t *model,
+  const vibeModelLayout_t layout
+) {
+  assert(model != NULL);
+  assert((layout == VIBE_LAYOUT_INTERLEAVED) || (layout == VIBE_LAYOUT_PLANAR));
+
+  /* The layout cannot be changed once the model is allocated. */
+  assert(model->historyBuffer == NULL);
+
+  model->layout = layout;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetBufferLayout(
+  vibeModel_Sequential_t *model,
+  const vibeBufferLayout_t bufferLayout
+) {
+  assert(model != NULL);
+  assert((bufferLayout == VIBE_BUFFER_PIXEL_MAJOR) || (bufferLayout == VIBE_BUFFER_SAMPLE_MAJOR));
+
+  /* The layout cannot be changed once the model is allocated. */
+  assert(model->historyBuffer == NULL);
+
+  model->bufferLayout = bufferLayout;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetNumberOfHistoryImages(
+  vibeModel_Sequential_t *model,
+  const uint32_t numberOfHistoryImages
+) {
+  assert(model != NULL);
+
+  /* The historyImages cannot be changed once the model is allocated. */
+  assert(model->historyBuffer == NULL);
+
+  model->numberOfHistoryImages = numberOfHistoryImages;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetSampleBlockSize(
+  vibeModel_Sequential_t *model,
+  const uint32_t sampleBlockSize
+) {
+  assert(model != NULL);
+  assert(sampleBlockSize > 0);
+
+  /* The historyBuffer cannot be changed once the model is allocated. */
+  assert(model->historyBuffer == NULL);
+
+  model->sampleBlockSize = sampleBlockSize;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetSampleFormat(
+  vibeModel_Sequential_t *model,
+  const vibeSampleFormat_t sampleFormat
+) {
+  assert(model != NULL);
+  assert((sampleFormat == VIBE_SAMPLE_RGB888) || (sampleFormat == VIBE_SAMPLE_RGB565) || (sampleFormat == VIBE_SAMPLE_RGB555));
+
+  /* The historyBuffer cannot be changed once the model is allocated. */
+  assert(model->historyBuffer == NULL);
+
+  model->sampleFormat = sampleFormat;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetSampleOrdering(
+  vibeModel_Sequential_t *model,
+  const vibeSampleOrdering_t sampleOrdering
+) {
+  assert(model != NULL);
+  assert((sampleOrdering == VIBE_ORDERING_SWAP) || (sampleOrdering == VIBE_ORDERING_MOVE_TO_FRONT));
+
+  model->sampleOrdering = sampleOrdering;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetImageStep(
+  vibeModel_Sequential_t *model,
+  const uint32_t imageStep
+) {
+  assert(model != NULL);
+
+  /* Checked against the width of the rows when the images are read. */
+  model->imageStep = imageStep;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetSeed(
+  vibeModel_Sequential_t *model,
+  const uint32_t seed
+) {
+  assert(model != NULL);
+
+  /* The stream restarts from the new seed. */
+  model->seed = seed;
+  vibe_srand(&model->random, seed);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetNumberOfThreads(
+  vibeModel_Sequential_t *model,
+  const uint32_t numberOfThreads
+) {
+  assert(model != NULL);
+  assert(numberOfThreads > 0);
+
+  libvibeThreadPool_Free(model->pool);
+  free(model->bandRandom);
+  model->pool = NULL;
+  model->bandRandom = NULL;
+
+  if (numberOfThreads > 1) {
+    model->bandRandom = (vibeRandom_t*)malloc(numberOfThreads * sizeof(*(model->bandRandom)));
+    assert(model->bandRandom != NULL);
+  }
+
+  model->numberOfThreads = numberOfThreads;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetStaticBlockThreshold(
+  vibeModel_Sequential_t *model,
+  const int32_t staticBlockThreshold
+) {
+  assert(model != NULL);
+  assert(staticBlockThreshold >= -1);
+
+  model->staticBlockThreshold = staticBlockThreshold;
+
+  /* The next segmentation tests all the blocks. */
+  if (model->blockState != NULL)
+    memset(model->blockState, 0, (size_t)numberOfBlocks(model->width) * numberOfBlocks(model->height));
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetAllocator(
+  vibeModel_Sequential_t *model,
+  const vibeAllocator_t *allocator
+) {
+  assert(model != NULL);
+  assert((allocator == NULL) || ((allocator->alloc != NULL) && (allocator->free != NULL)));
+
+  /* The storage is allocated and freed by the same allocator. */
+  assert((model->historyBuffer == NULL) && (model->blockState == NULL));
+
+  model->allocator = (allocator != NULL) ? *allocator : defaultAllocator;
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetHugePages(
+  vibeModel_Sequential_t *model,
+  const uint32_t hugePages
+) {
+  assert(model != NULL);
+  assert(model->historyBuffer == NULL);
+
+  model->hugePages = (hugePages != 0);
+
+  return(0);
+}
+
+int32_t libvibeModel_Sequential_GetStats(
+  const vibeModel_Sequential_t *model,
+  vibeStats_t *stats
+) {
+  assert(model != NULL);
+  assert(stats != NULL);
+
+#ifdef VIBE_STATS
+  *stats = model->stats;
+
+  return(0);
+#else
+  memset(stats, 0, sizeof(*stats));
+
+  return(-1);
+#endif
+}
+
+int32_t libvibeModel_Sequential_ResetStats(vibeModel_Sequential_t *model)
+{
+  assert(model != NULL);
+
+  memset(&model->stats, 0, sizeof(model->stats));
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// ---------------------------- Region of interest ----------------------------
+// ----------------------------------------------------------------------------
+//
+// The region of interest is given as a mask, rectangles or polygons, which
+// are all drawn into a mask of the frame first. The mask is then compiled into
+// spans of pixels, row by row: the segmentation and the update only visit the
+// spans, and never read nor write the samples of the pixels outside (but for
+// the neighbor diffusion of the update, which may write the samples of the
+// pixels next to the region).
+
+/* Compiles a mask of the frame (non-zero inside) into the spans of the region of
+ * interest; a region covering the whole frame is none.
+ */
+static void compileROI(vibeModel_Sequential_t *model, uint8_t *inside)
+{
+  uint32_t width = model->width;
+  uint32_t height = model->height;
+
+  /* YUV 4:2:0 models: whole 2x2 blocks, whose samples are stored together. */
+  if (model->chromaFormat != 0) {
+    for (uint32_t y = 0; y < height; y += 2) {
+      for (uint32_t x = 0; x < width; x += 2) {
+        uint8_t *block = inside + y * width + x;
+        uint8_t value = block[0] | block[1] | block[width] | block[width + 1];
+
+        block[0] = block[1] = block[width] = block[width + 1] = value;
+      }
+    }
+  }
+
+  free(model->roiRows);
+  free(model->roiSpans);
+  model->roiRows = NULL;
+  model->roiSpans = NULL;
+
+  /* The labels of the pixels that enter the region were not segmented. */
+  if (model->blockState != NULL)
+    memset(model->blockState, 0, (size_t)numberOfBlocks(width) * numberOfBlocks(height));
+
+  /* Counts the spans. */
+  uint32_t numberOfSpans = 0;
+
+  for (uint32_t i = 0; i < width * height; ++i) {
+    if (inside[i] && ((i % width == 0) || !inside[i - 1]))
+      ++numberOfSpans;
+  }
+
+  if ((numberOfSpans == height) && (memchr(inside, 0, width * height) == NULL))
+    return;
+
+  /* Then fills them. */
+  model->roiRows = (uint32_t *)malloc((height + 1) * sizeof(*model->roiRows));
+  model->roiSpans = (vibeSpan_t *)malloc(((numberOfSpans > 0) ? numberOfSpans : 1) * sizeof(*model->roiSpans));
+  assert((model->roiRows != NULL) && (model->roiSpans != NULL));
+
+  numberOfSpans = 0;
+
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint8_t *row = inside + y * width;
+
+    model->roiRows[y] = numberOfSpans;
+
+    for (uint32_t x = 0; x < width;) {
+      if (!row[x]) {
+        ++x;
+        continue;
+      }
+
+      model->roiSpans[numberOfSpans].first = x;
+
+      while ((x < width) && row[x])
+        ++x;
+
+      model->roiSpans[numberOfSpans++].last = x;
+    }
+  }
+
+  model->roiRows[height] = numberOfSpans;
+}
+
+/* Mask of the frame for the region of interest of an allocated model. */
+static uint8_t *newROI(const vibeModel_Sequential_t *model)
+{
+  assert((model != NULL) && (model->width > 0) && (model->height > 0));
+
+  uint8_t *inside = (uint8_t *)calloc((size_t)model->width * model->height, 1);
+  assert(inside != NULL);
+
+  return(inside);
+}
+
+/* Smallest integer not lower than v. */
+static inline int64_t ceil_64s(double v)
+{
+  int64_t i = (int64_t)v;
+
+  return (i < v) ? i + 1 : i;
+}
+
+// -----------------------------------------------------------------------------
+// Region of interest given by a mask
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetROI(vibeModel_Sequential_t *model, const uint8_t *roi_mask)
+{
+  uint8_t *inside = newROI(model);
+
+  for (uint32_t i = 0; i < model->width * model->height; ++i)
+    inside[i] = (roi_mask == NULL) || (roi_mask[i] != 0);
+
+  compileROI(model, inside);
+  free(inside);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Region of interest given by rectangles
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetROIRectangles(
+  vibeModel_Sequential_t *model,
+  const vibeRectangle_t *rectangles,
+  const uint32_t numberOfRectangles
+) {
+  assert((rectangles != NULL) || (numberOfRectangles == 0));
+
+  uint8_t *inside = newROI(model);
+
+  for (uint32_t r = 0; r < numberOfRectangles; ++r) {
+    /* Clipped to the frame. */
+    int64_t x0 = (rectangles[r].x > 0) ? rectangles[r].x : 0;
+    int64_t y0 = (rectangles[r].y > 0) ? rectangles[r].y : 0;
+    int64_t x1 = (int64_t)rectangles[r].x + rectangles[r].width;
+    int64_t y1 = (int64_t)rectangles[r].y + rectangles[r].height;
+
+    if (x1 > model->width) x1 = model->width;
+    if (y1 > model->height) y1 = model->height;
+
+    for (int64_t y = y0; y < y1; ++y) {
+      if (x0 < x1)
+        memset(inside + y * model->width + x0, 1, x1 - x0);
+    }
+  }
+
+  compileROI(model, inside);
+  free(inside);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Region of interest given by polygons: a pixel is in a polygon when its
+// center is (even-odd rule), and in the region when it is in a polygon
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetROIPolygons(
+  vibeModel_Sequential_t *model,
+  const vibePoint_t *points,
+  const uint32_t *numberOfPoints,
+  const uint32_t numberOfPolygons
+) {
+  assert(((points != NULL) && (numberOfPoints != NULL)) || (numberOfPolygons == 0));
+
+  uint8_t *inside = newROI(model);
+
+  for (uint32_t p = 0; p < numberOfPolygons; points += numberOfPoints[p++]) {
+    uint32_t n = numberOfPoints[p];
+    double *crossing = (double *)malloc(((n > 0) ? n : 1) * sizeof(*crossing));
+    assert(crossing != NULL);
+
+    for (uint32_t y = 0; y < model->height; ++y) {
+      double center = y + 0.5;
+      uint32_t numberOfCrossings = 0;
+
+      /* Abscissae where the edges cross the centers of the row, sorted. */
+      for (uint32_t i = 0; i < n; ++i) {
+        const vibePoint_t *a = &points[i];
+        const vibePoint_t *b = &points[(i + 1) % n];
+
+        if ((a->y <= center) != (b->y <= center)) {
+          double x = a->x + (center - a->y) * (b->x - a->x) / (double)(b->y - a->y);
+          uint32_t j = numberOfCrossings++;
+
+          for (; (j > 0) && (crossing[j - 1] > x); --j)
+            crossing[j] = crossing[j - 1];
+
+          crossing[j] = x;
+        }
+      }
+
+      /* The centers between two crossings are inside. */
+      for (uint32_t i = 0; i + 1 < numberOfCrossings; i += 2) {
+        int64_t x0 = ceil_64s(crossing[i] - 0.5);
+        int64_t x1 = ceil_64s(crossing[i + 1] - 0.5);
+
+        if (x0 < 0) x0 = 0;
+        if (x1 > model->width) x1 = model->width;
+
+        if (x0 < x1)
+          memset(inside + (size_t)y * model->width + x0, 1, x1 - x0);
+      }
+    }
+
+    free(crossing);
+  }
+
+  compileROI(model, inside);
+  free(inside);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Label of the pixels outside the region of interest
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_SetROILabel(vibeModel_Sequential_t *model, const uint8_t label)
+{
+  assert(model != NULL);
+  model->roiLabel = label;
+
+  return(0);
+}
+
+/* Whether a buffer lies in the file mapped by libvibeModel_Sequential_Load. */
+static inline int inMapping(const vibeModel_Sequential_t *model, const void *pointer)
+{
+  const uint8_t *base = (const uint8_t *)model->mapping;
+
+  return (base != NULL) && ((const uint8_t *)pointer >= base) && ((const uint8_t *)pointer < base + model->mappingSize);
+}
+
+// ----------------------------------------------------------------------------
+// Frees the structure
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Free(vibeModel_Sequential_t *model)
+{
+  if (model == NULL)
+    return(-1);
+
+  libvibeThreadPool_Free(model->pool);
+  free(model->bandRandom);
+  free(model->roiRows);
+  free(model->roiSpans);
+  freeStorage(model, model->blockSums);
+  freeStorage(model, model->blockState);
+
+  if (model->historyBuffer == NULL) {
+    free(model);
+    return(0);
+  }
+
+  /* The historyBuffer of a loaded model is allocated once resized. */
+  if (!inMapping(model, model->historyImage))
+    freeStorage(model, model->historyImage);
+
+  if (!inMapping(model, model->historyBuffer))
+    freeStorage(model, model->historyBuffer);
+
+  if (model->mapping != NULL)
+    munmap(model->mapping, model->mappingSize);
+
+  releaseTables(model->tables);
+
+  freeStorage(model, model->tailIndex);
+  free(model);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Number of historyImages of a model being allocated: matchingNumber unless set
+// with SetNumberOfHistoryImages, at most matchingNumber (the 8-bit counters of
+// the segmentation start at matchingNumber and would wrap below 0 otherwise),
+// and at most numberOfSamples (an empty historyBuffer still gets one byte per
+// pixel, so that it is not NULL)
+// -----------------------------------------------------------------------------
+static void setNumberOfHistoryImages(vibeModel_Sequential_t *model)
+{
+  if ((model->numberOfHistoryImages == 0) || (model->numberOfHistoryImages > model->matchingNumber))
+    model->numberOfHistoryImages = model->matchingNumber;
+
+  if (model->numberOfHistoryImages > model->numberOfSamples)
+    model->numberOfHistoryImages = model->numberOfSamples;
+}
+
+/* Number of values of the buffers with random values. */
+static inline uint32_t tableSize(const vibeModel_Sequential_t *model)
+{
+  return tableSizeOf(model->width, model->height);
+}
+
+// -----------------------------------------------------------------------------
+// Gets the buffers with random values (jumps, neighbors and positions of the
+// update, shared with the models of the same configuration) and allocates the
+// list of the undecided pixels, once the history of a model is initialized
+// -----------------------------------------------------------------------------
+static void allocTables(vibeModel_Sequential_t *model)
+{
+  useTables(model);
+
+  /* List of the pixels that still need the historyBuffer search. */
+  model->tailIndex = (uint32_t*)allocStorage(model, model->width * model->height * sizeof(*(model->tailIndex)));
+  assert(model->tailIndex != NULL);
+}
+
+// -----------------------------------------------------------------------------
+// Samples of the historyBuffer of a C1R or C3R model: distances (in bytes, or
+// in samples of 16 bits) between the pixels, samples and channels for
+// numberOfTests samples per pixel, and copies of one sample of size pixels from and to values, where the pixels
+// are packed as in the input image (RGBRGB...)
+// -----------------------------------------------------------------------------
+static void setBufferStrides_8u(vibeModel_Sequential_t *model, uint32_t channels, uint32_t numberOfTests)
+{
+  uint32_t numberOfPixels = model->width * model->height;
+
+  /* The samples shared by blocks of pixels and the samples of 16 bits (of C3R models) are stored pixel-major. */
+  assert((model->sampleBlockSize == 1) || (model->bufferLayout == VIBE_BUFFER_PIXEL_MAJOR));
+  assert((model->sampleFormat == VIBE_SAMPLE_RGB888) || ((channels == 3) && (model->bufferLayout == VIBE_BUFFER_PIXEL_MAJOR)));
+
+  model->blockColumns = (model->width + model->sampleBlockSize - 1) / model->sampleBlockSize;
+
+  if (model->sampleFormat != VIBE_SAMPLE_RGB888) {
+    model->bufferPixelStride   = numberOfTests;
+    model->bufferSampleStride  = 1;
+    model->bufferChannelStride = 0;
+  }
+  else if (model->bufferLayout == VIBE_BUFFER_SAMPLE_MAJOR) {
+    /* Every sample plane is stored like a historyImage. */
+    model->bufferPixelStride   = (channels == 1) ? 1 : model->imagePixelStride;
+    model->bufferSampleStride  = channels * numberOfPixels;
+    model->bufferChannelStride = (channels == 1) ? 0 : model->imageChannelStride;
+  }
+  else if ((channels == 3) && (model->layout == VIBE_LAYOUT_PLANAR)) {
+    model->bufferPixelStride   = 3 * numberOfTests;
+    model->bufferSampleStride  = 1;
+    model->bufferChannelStride = numberOfTests;
+  }
+  else {
+    model->bufferPixelStride   = channels * numberOfTests;
+    model->bufferSampleStride  = channels;
+    model->bufferChannelStride = (channels == 1) ? 0 : 1;
+  }
+}
+
+static void gatherSamples_8u(const uint8_t *sample, uint32_t pixelStride, uint32_t channelStride, uint32_t channels, uint32_t size, uint8_t *values)
+{
+  if (channels == 1) {
+    for (uint32_t i = 0; i < size; ++i)
+      values[i] = sample[i * pixelStride];
+  }
+  else if ((pixelStride == 3) && (channelStride == 1))
+    memcpy(values, sample, 3 * size);
+  else {
+    for (uint32_t i = 0; i < size; ++i) {
+      values[3 * i]     = sample[i * pixelStride];
+      values[3 * i + 1] = sample[i * pixelStride + channelStride];
+      values[3 * i + 2] = sample[i * pixelStride + 2 * channelStride];
+    }
+  }
+}
+
+static void scatterSamples_8u(uint8_t *sample, uint32_t pixelStride, uint32_t channelStride, uint32_t channels, uint32_t size, const uint8_t *values)
+{
+  if (channels == 1) {
+    for (uint32_t i = 0; i < size; ++i)
+      sample[i * pixelStride] = values[i];
+  }
+  else if (channelStride == 1) {
+    for (uint32_t i = 0; i < size; ++i)
+      memcpy(sample + i * pixelStride, values + 3 * i, 3);
+  }
+  else {
+    for (uint32_t i = 0; i < size; ++i) {
+      sample[i * pixelStride]                     = values[3 * i];
+      sample[i * pixelStride + channelStride]     = values[3 * i + 1];
+      sample[i * pixelStride + 2 * channelStride] = values[3 * i + 2];
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Fills the historyBuffer of a C1R or C3R model (channels bytes per pixel of the
+// packed input image) with the noisy values of the input image. The noise is
+// counter-based (see vibe_noise_8u), with a key per sample drawn from the
+// stream of the model: the samples of a pixel do not depend on the other
+// pixels, so the bands of pixels are filled in parallel, and the model only
+// depends on its seed (not on the number of threads, the layout or the
+// kernels). The bands are made of groups of 4 pixels, whose bytes start on a
+// group of the noise. The sample planes stored like the input image get the
+// noisy values in place; otherwise, the noisy planes of a chunk of pixels are
+// made first, then written sample after sample, pixel after pixel (and
+// quantized for the samples of 16 bits). The sets of samples shared by blocks
+// of pixels get the noisy values of the first pixel of their block.
+// -----------------------------------------------------------------------------
+#define VIBE_NOISE_BUFFER_SIZE 32768
+
+typedef struct
+{
+  vibeModel_Sequential_t *model;
+  const uint8_t *image_data;
+  uint32_t numberOfPixels;
+  uint32_t channels;
+  uint32_t numberOfBands;
+  const uint32_t *keys;
+} vibeNoiseJob_t;
+
+static void noiseTask_8u(void *context, uint32_t band)
+{
+  const vibeNoiseJob_t *job = (const vibeNoiseJob_t *)context;
+  vibeModel_Sequential_t *model = job->model;
+  uint32_t channels = job->channels;
+  uint32_t numberOfPixels = job->numberOfPixels;
+  uint32_t numberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
+  uint32_t pixelStride = model->bufferPixelStride;
+  uint32_t sampleStride = model->bufferSampleStride;
+  uint32_t channelStride = (channels == 1) ? 0 : model->bufferChannelStride;
+
+  uint32_t first = 4 * bandRow((numberOfPixels + 3) / 4, job->numberOfBands, band);
+  uint32_t last = 4 * bandRow((numberOfPixels + 3) / 4, job->numberOfBands, band + 1);
+
+  if (last > numberOfPixels)
+    last = numberOfPixels;
+
+  if ((model->sampleFormat == VIBE_SAMPLE_RGB888) && (pixelStride == channels) && (channelStride <= 1)) {
+    for (uint32_t x = 0; x < numberOfTests; ++x)
+      model->kernels->noise_8u(job->image_data + channels * first, model->historyBuffer + first * pixelStride + x * sampleStride,
+                               channels * (last - first), job->keys[x], channels * first);
+    return;
+  }
+
+  /* Chunks of groups of 4 pixels, with all their noisy planes in the buffer. */
+  uint32_t chunk = (VIBE_NOISE_BUFFER_SIZE / (channels * numberOfTests)) & ~3u;
+  chunk = (chunk > 4) ? chunk : 4;
+
+  uint8_t *noisy = (uint8_t *)malloc(chunk * channels * numberOfTests);
+  assert(noisy != NULL);
+
+  for (uint32_t index = first; index < last; index += chunk) {
+    uint32_t size = (last - index < chunk) ? last - index : chunk;
+    uint32_t planeSize = channels * size;
+
+    for (uint32_t x = 0; x < numberOfTests; ++x)
+      model->kernels->noise_8u(job->image_data + channels * index, noisy + x * planeSize, planeSize, job->keys[x], channels * index);
+
+    /* Samples of 16 bits. */
+    if (model->sampleFormat != VIBE_SAMPLE_RGB888) {
+      uint16_t *samples = (uint16_t *)model->historyBuffer + (size_t)index * pixelStride;
+      uint32_t bits = greenBits(model);
+
+      for (uint32_t i = 0; i < size; ++i, samples += pixelStride) {
+        for (uint32_t x = 0; x < numberOfTests; ++x) {
+          const uint8_t *value = noisy + x * planeSize + 3 * i;
+          samples[x] = vibe_quantize_8u_Q3R(value[0], value[1], value[2], bits);
+        }
+      }
+
+      continue;
+    }
+
+    /* Planar sample planes. */
+    if (pixelStride == 1) {
+      for (uint32_t x = 0; x < numberOfTests; ++x)
+        model->kernels->deinterleave_8u_C3P3R(noisy + x * planeSize, model->historyBuffer + index + x * sampleStride, channelStride, size);
+
+      continue;
+    }
+
+    /* The samples of a pixel are next to each other. */
+    for (uint32_t x = 0; x < numberOfTests; ++x)
+      scatterSamples_8u(model->historyBuffer + index * pixelStride + x * sampleStride, pixelStride, channelStride, channels, size, noisy + x * planeSize);
+  }
+
+  free(noisy);
+}
+
+static void fillHistoryBuffer_8u(vibeModel_Sequential_t *model, const uint8_t *image_data, uint32_t channels)
+{
+  uint32_t numberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
+
+  if (numberOfTests == 0)
+    return;
+
+  uint32_t *keys = (uint32_t *)malloc(numberOfTests * sizeof(*keys));
+  assert(keys != NULL);
+
+  for (uint32_t x = 0; x < numberOfTests; ++x)
+    keys[x] = vibe_rand(&model->random);
+
+  /* The first pixels of the blocks, packed as an image of blocks. */
+  uint8_t *blocks = NULL;
+  uint32_t size = model->sampleBlockSize;
+
+  if (size > 1) {
+    blocks = (uint8_t *)malloc((size_t)bufferPixels(model) * channels);
+    assert(blocks != NULL);
+
+    uint8_t *block = blocks;
+
+    for (uint32_t y = 0; y < model->height; y += size) {
+      for (uint32_t x = 0; x < model->width; x += size, block += channels)
+        memcpy(block, image_data + ((size_t)y * model->width + x) * channels, channels);
+    }
+
+    image_data = blocks;
+  }
+
+  vibeNoiseJob_t job = { model, image_data, bufferPixels(model), channels, numberOfBands(model, model->height), keys };
+
+  runTasks(model, noiseTask_8u, &job, job.numberOfBands);
+
+  free(blocks);
+  free(keys);
+}
+
+// -----------------------------------------------------------------------------
+// Resize of the historyBuffer of an allocated C1R or C3R model
+//
+// The samples kept are copied to a historyBuffer of the new size, band by band
+// on the worker pool; the new samples are noisy copies of the historyImages
+// (the samples that matched last, thanks to the swapping), with the noise of
+// the initialization. The sample planes are simply dropped when the samples
+// are stored sample-major and their number goes down: the historyBuffer stays,
+// and its whole pages beyond the samples kept are given back to the system.
+// -----------------------------------------------------------------------------
+#define VIBE_RESIZE_CHUNK 1024
+
+/* Previous historyBuffer and its layout, and keys of the noise of the new samples. */
+typedef struct
+{
+  vibeModel_Sequential_t *model;
+  const uint8_t *historyBuffer;
+  uint32_t numberOfTests;
+  uint32_t pixelStride;
+  uint32_t sampleStride;
+  uint32_t channelStride;
+  uint32_t channels;
+  uint32_t numberOfBands;
+  const uint32_t *keys;
+} vibeResizeJob_t;
+
+static void resizeTask_8u(void *context, uint32_t band)
+{
+  const vibeResizeJob_t *job = (const vibeResizeJob_t *)context;
+  vibeModel_Sequential_t *model = job->model;
+  uint32_t channels = job->channels;
+  uint32_t numberOfPixels = model->width * model->height;
+  uint32_t numberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
+  uint32_t channelStride = (channels == 1) ? 0 : model->bufferChannelStride;
+  uint32_t imageChannelStride = (channels == 1) ? 0 : model->imageChannelStride;
+  uint32_t imagePixelStride = (channels == 1) ? 1 : model->imagePixelStride;
+
+  /* Groups of 4 pixels, as for the noise of the initialization. */
+  uint32_t first = 4 * bandRow((numberOfPixels + 3) / 4, job->numberOfBands, band);
+  uint32_t last = 4 * bandRow((numberOfPixels + 3) / 4, job->numberOfBands, band + 1);
+
+  if (last > numberOfPixels)
+    last = numberOfPixels;
+
+  uint8_t values[3 * VIBE_RESIZE_CHUNK];
+
+  for (uint32_t index = first; index < last; index += VIBE_RESIZE_CHUNK) {
+    uint32_t size = (last - index < VIBE_RESIZE_CHUNK) ? last - index : VIBE_RESIZE_CHUNK;
+
+    for (uint32_t x = 0; x < numberOfTests; ++x) {
+      if (x < job->numberOfTests)
+        gatherSamples_8u(job->historyBuffer + index * job->pixelStride + x * job->sampleStride, job->pixelStride, job->channelStride, channels, size, values);
+      else {
+        const uint8_t *historyImage = model->historyImage + (x % model->numberOfHistoryImages) * channels * numberOfPixels;
+
+        gatherSamples_8u(historyImage + index * imagePixelStride, imagePixelStride, imageChannelStride, channels, size, values);
+        model->kernels->noise_8u(values, values, channels * size, job->keys[x - job->numberOfTests], channels * index);
+      }
+
+      scatterSamples_8u(model->historyBuffer + index * model->bufferPixelStride + x * model->bufferSampleStride, model->bufferPixelStride, channelStride, channels, size, values);
+    }
+  }
+}
+
+int32_t libvibeModel_Sequential_Resize(
+  vibeModel_Sequential_t *model,
+  const uint32_t numberOfSamples,
+  const uint32_t matchingNumber
+) {
+  /* Basic checks: an allocated model, and only 8u C1R or C3R models with a set of samples of 3 bytes per pixel when the number of samples changes. */
+  assert(model != NULL);
+  assert(model->historyBuffer != NULL);
+
+  /* The 8-bit counters of the segmentation start at matchingNumber, and would wrap below 0 with more historyImages. */
+  if ((numberOfSamples < model->numberOfHistoryImages) || (matchingNumber == 0) || (matchingNumber < model->numberOfHistoryImages) || (matchingNumber > numberOfSamples))
+    return(-1);
+
+  if ((numberOfSamples != model->numberOfSamples) && ((model->sampleSize != 1) || (model->chromaFormat != 0) || (model->sampleBlockSize != 1) || (model->sampleFormat != VIBE_SAMPLE_RGB888)))
+    return(-1);
+
+  model->matchingNumber = matchingNumber;
+
+  if (numberOfSamples == model->numberOfSamples)
+    return(0);
+
+  uint32_t channels = (model->inputChannels == 1) ? 1 : 3;
+  uint32_t numberOfPixels = model->width * model->height;
+  uint32_t numberOfTests = numberOfSamples - model->numberOfHistoryImages;
+  uint32_t oldNumberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
+
+  if ((model->bufferLayout == VIBE_BUFFER_SAMPLE_MAJOR) && (numberOfTests < oldNumberOfTests)) {
+#ifdef MADV_DONTNEED
+    if ((model->mapping == NULL) && (model->allocator.alloc == alignedAlloc)) {
+      uintptr_t end = (uintptr_t)model->historyBuffer + (uintptr_t)channels * numberOfPixels * oldNumberOfTests;
+      uintptr_t kept = (uintptr_t)model->historyBuffer + (uintptr_t)channels * numberOfPixels * ((numberOfTests > 0) ? numberOfTests : 1);
+      uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+
+      kept = (kept + pageSize - 1) / pageSize * pageSize;
+      end = end / pageSize * pageSize;
+
+      if (kept < end)
+        madvise((void *)kept, end - kept, MADV_DONTNEED);
+    }
+#endif
+
+    model->numberOfSamples = numberOfSamples;
+  }
+  else {
+    uint32_t numberOfKeys = (numberOfTests > oldNumberOfTests) ? numberOfTests - oldNumberOfTests : 1;
+    uint32_t *keys = (uint32_t *)malloc(numberOfKeys * sizeof(*keys));
+    assert(keys != NULL);
+
+    for (uint32_t x = oldNumberOfTests; x < numberOfTests; ++x)
+      keys[x - oldNumberOfTests] = vibe_rand(&model->random);
+
+    vibeResizeJob_t job = {
+      model, model->historyBuffer, oldNumberOfTests,
+      model->bufferPixelStride, model->bufferSampleStride, (channels == 1) ? 0 : model->bufferChannelStride,
+      channels, numberOfBands(model, model->height), keys
+    };
+
+    model->numberOfSamples = numberOfSamples;
+    model->historyBuffer = (uint8_t *)allocHistory(model, channels * numberOfPixels * ((numberOfTests > 0) ? numberOfTests : 1));
+    assert(model->historyBuffer != NULL);
+
+    setBufferStrides_8u(model, channels, numberOfTests);
+    runTasks(model, resizeTask_8u, &job, job.numberOfBands);
+
+    if (!inMapping(model, job.historyBuffer))
+      freeStorage(model, (void *)job.historyBuffer);
+
+    free(keys);
+  }
+
+  /* The positions of the update are drawn among the new samples. */
+  useTables(model);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Allocates and initializes a C1R model structure
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_AllocInit_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+) {
+  /* Some basic checks. */
+  assert((image_data != NULL) && (model != NULL));
+  assert((width > 0) && (height > 0));
+
+  /* Finish model alloc - parameters values cannot be changed anymore. */
+  model->width = width;
+  model->height = height;
+  model->sampleSize = 1;
+  model->inputChannels = 1;
+  setNumberOfHistoryImages(model);
+
+  /* A padded input image is copied once, without its padding. */
+  uint8_t *packed = packInput(model, image_data, 1);
+
+  if (packed != NULL)
+    image_data = packed;
+
+  /* Memory layout: distances (in bytes) between the pixels and the samples of the historyBuffer. */
+  uint32_t numberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
+
+  setBufferStrides_8u(model, 1, numberOfTests);
+
+  /* Creates the historyImage structure. */
+  model->historyImage = NULL;
+  model->historyImage = (uint8_t*)allocHistory(model, model->numberOfHistoryImages * width * height * sizeof(*(model->historyImage)));
+
+  assert(model->historyImage != NULL);
+
+  for (int i = 0; i < model->numberOfHistoryImages; ++i)
+    memcpy(model->historyImage + i * width * height, image_data, width * height);
+
+  /* Now creates and fills the history buffer. */
+  model->historyBuffer = (uint8_t*)allocHistory(model, bufferPixels(model) * ((numberOfTests > 0) ? numberOfTests : 1) * sizeof(uint8_t));
+  assert(model->historyBuffer != NULL);
+
+  fillHistoryBuffer_8u(model, image_data, 1);
+
+  free(packed);
+
+  /* Fills the buffers with random values. */
+  allocTables(model);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of the pixels [first, first + numberOfPixels) of a C1R model
+// (image_data and segmentation_map point at pixel first, see vibeSegmentation_fn)
+// -----------------------------------------------------------------------------
+static void segmentation_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map,
+  uint32_t first,
+  uint32_t numberOfPixels
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+  uint32_t height = model->height;
+  uint32_t matchingNumber = model->matchingNumber;
+  uint32_t matchingThreshold = model->matchingThreshold;
+
+  /* From now on, the pixels are numbered from the first pixel of the band. */
+  uint8_t *historyImage = model->historyImage + first;
+  uint8_t *historyBuffer = model->historyBuffer + first * model->bufferPixelStride;
+  uint8_t *swappingImageBuffer = historyImage + (model->lastHistoryImageSwapped) * width * height;
+
+  /* Segmentation: a single sweep over the historyImages writes the counters
+   * and collects the pixels that still need the historyBuffer search.
+   */
+  uint32_t *tailIndex = model->tailIndex + first;
+  uint32_t numberOfTails = model->kernels->historyCount_8u_C1R(
+    image_data, historyImage, width * height, model->numberOfHistoryImages,
+    numberOfPixels, matchingNumber, matchingThreshold, segmentation_map, tailIndex
+  );
+
+  /* Now, we move in the buffer and leave the historyImages. */
+  int numberOfTests = (model->numberOfSamples - model->numberOfHistoryImages);
+  vibeTailCounts_t tailCounts = { 0, 0, 0 };
+
+  if (model->bufferLayout == VIBE_BUFFER_SAMPLE_MAJOR) {
+    /* The undecided pixels are searched together, sample plane by sample plane. */
+    model->kernels->tailSearch_8u_C1R(
+      image_data, swappingImageBuffer, historyBuffer, width * height, numberOfTests,
+      numberOfPixels, matchingThreshold, segmentation_map, tailIndex, numberOfTails, &tailCounts
+    );
+
+    VIBE_COUNT(countSegmentation(model, numberOfPixels, numberOfTails, &tailCounts));
+    return;
+  }
+
+  int swapping = (model->sampleBlockSize == 1);
+  int moving = (model->sampleOrdering == VIBE_ORDERING_MOVE_TO_FRONT);
+
+  for (uint32_t t = 0; t < numberOfTails; ++t) {
+    uint32_t index = tailIndex[t];
+
+    /* We need to check the full border and swap values with the first or second historyImage.
+     * We still need to find a match before we can stop our search.
+     */
+    uint8_t *samples = model->historyBuffer + (size_t)bufferIndex(model, first + index) * numberOfTests;
+    uint8_t currentValue = image_data[index];
+
+    for (int i = 0; i < numberOfTests; ++i) {
+      VIBE_COUNT(++tailCounts.testedSamples);
+
+      if (abs_uint(currentValue - samples[i]) <= matchingThreshold) {
+        --segmentation_map[index];
+
+        /* Swaping: Putting found value in history image buffer (the samples of a block stay in place). */
+        if (swapping) {
+          VIBE_COUNT(++tailCounts.swappedSamples);
+          uint8_t temp = swappingImageBuffer[index];
+          swappingImageBuffer[index] = samples[i];
+          samples[i] = temp;
+        }
+
+        /* Move-to-front ordering. */
+        if (moving && (i > 0)) {
+          VIBE_COUNT(++tailCounts.movedSamples);
+          moveToFront(samples, i, 1);
+        }
+
+        /* Exit inner loop. */
+        if (segmentation_map[index] <= 0) break;
+      }
+    } // for
+
+    /* Produces the output. Note that this step is application-dependent.
+     * The other pixels already hold COLOR_BACKGROUND (a null counter).
+     */
+    if (segmentation_map[index] > 0) segmentation_map[index] = COLOR_FOREGROUND;
+  } // for
+
+  VIBE_COUNT(countSegmentation(model, numberOfPixels, numberOfTails, &tailCounts));
+}
+
+// -----------------------------------------------------------------------------
+static void segmentationTask_8u_C1R(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t width = job->model->width;
+  uint32_t firstRow = bandRow(job->model->height, job->numberOfBands, band);
+  uint32_t lastRow = bandRow(job->model->height, job->numberOfBands, band + 1);
+
+  segmentInput(job->model, segmentation_8u_C1R, job->image_data, job->map + firstRow * width, firstRow * width, (lastRow - firstRow) * width);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a C1R model
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Segmentation_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+) {
+  /* Basic checks. */
+  assert((image_data != NULL) && (model != NULL) && (segmentation_map != NULL));
+  assert((model->width > 0) && (model->height > 0));
+  assert((model->historyBuffer != NULL) && (model->sampleSize == 1));
+  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  /* For swapping. */
+  model->lastHistoryImageSwapped = (model->lastHistoryImageSwapped + 1) % model->numberOfHistoryImages;
+
+  /* The pixels are segmented independently of each other: the bands can run in parallel. */
+  vibeBandJob_t job = { model, image_data, segmentation_map, numberOfBands(model, model->height) };
+
+  beginStaticBlocks(model, image_data);
+  runBands(model, segmentationTask_8u_C1R, &job);
+  endStaticBlocks(model, segmentation_map, 0);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a band of a packed mask: the pixels are segmented by chunks
+// into counters that stay in cache, which are then packed into bits
+// -----------------------------------------------------------------------------
+static void segmentationPackedTask_8u_C1R(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t numberOfPixels = job->model->width * job->model->height;
+  uint32_t numberOfBytes = (numberOfPixels + 7) / 8;
+
+  /* The bands start on a byte of the mask. */
+  uint32_t first = 8 * bandRow(numberOfBytes, job->numberOfBands, band);
+  uint32_t last = 8 * bandRow(numberOfBytes, job->numberOfBands, band + 1);
+  uint8_t counts[PACK_CHUNK_SIZE];
+
+  if (last > numberOfPixels)
+    last = numberOfPixels;
+
+  for (uint32_t chunk = first; chunk < last; chunk += PACK_CHUNK_SIZE) {
+    uint32_t size = (last - chunk < PACK_CHUNK_SIZE) ? last - chunk : PACK_CHUNK_SIZE;
+
+    segmentInput(job->model, segmentation_8u_C1R, job->image_data, counts, chunk, size);
+    job->model->kernels->pack_8u1u_C1R(counts, job->map + chunk / 8, size);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a C1R model into a packed mask
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Segmentation_8u1u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_mask
+) {
+  /* Basic checks. */
+  assert((image_data != NULL) && (model != NULL) && (segmentation_mask != NULL));
+  assert((model->width > 0) && (model->height > 0));
+  assert((model->historyBuffer != NULL) && (model->sampleSize == 1));
+  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  /* For swapping. */
+  model->lastHistoryImageSwapped = (model->lastHistoryImageSwapped + 1) % model->numberOfHistoryImages;
+
+  /* Bands of whole bytes, so that no byte of the mask is written by two threads. */
+  uint32_t numberOfBytes = (model->width * model->height + 7) / 8;
+  vibeBandJob_t job = { model, image_data, segmentation_mask, numberOfBands(model, numberOfBytes) };
+
+  beginStaticBlocks(model, image_data);
+  runBands(model, segmentationPackedTask_8u_C1R, &job);
+  endStaticBlocks(model, segmentation_mask, 1);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Update of the rows [firstRow, lastRow) of a C1R model (the frame border excepted)
+// -----------------------------------------------------------------------------
+static void updateRows_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask,
+  int packed,
+  uint32_t firstRow,
+  uint32_t lastRow,
+  vibeRandom_t *random
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+  uint32_t height = model->height;
+
+  uint8_t *historyImage = model->historyImage;
+  uint8_t *historyBuffer = model->historyBuffer;
+
+  /* Some utility variables. */
+  uint32_t bufferPixelStride = model->bufferPixelStride;
+  uint32_t bufferSampleStride = model->bufferSampleStride;
+  uint32_t numberOfHistoryImages = model->numberOfHistoryImages;
+
+  /* Updating. */
+  const uint32_t *jump = model->jump;
+  const int *neighbor = model->neighbor;
+  const uint32_t *position = model->position;
+
+  uint32_t shift, indX;
+  size_t step = inputStep(model);
+
+  VIBE_COUNT(uint64_t updates = 0);
+
+  for (uint32_t y = firstRow; y < lastRow; ++y) {
+    const uint8_t *row = image_data + y * step;
+
+    const vibeSpan_t *spans;
+    uint32_t numberOfSpans = rowSpans(model, y, &spans);
+
+    for (uint32_t s = 0; s < numberOfSpans; ++s) {
+      /* The span, the first and last columns excepted. */
+      uint32_t first = (spans[s].first > 1) ? spans[s].first : 1;
+      uint32_t last = (spans[s].last < width - 1) ? spans[s].last : width - 1;
+
+      shift = vibe_rand_below(random, width);
+      indX = first - 1 + jump[shift]; // index_jump should never be zero (> 1).
+
+      while (indX < last) {
+        int index = indX + y * width;
+
+        if (isBackground(updating_mask, packed, index)) {
+          VIBE_COUNT(++updates);
+
+          /* In-place substitution. */
+          uint8_t value = row[indX];
+          int index_neighbor = index + neighbor[shift];
+
+          if (position[shift] < numberOfHistoryImages) {
+            historyImage[index + position[shift] * width * height] = value;
+            historyImage[index_neighbor + position[shift] * width * height] = value;
+          }
+          else {
+            int pos = position[shift] - numberOfHistoryImages;
+            historyBuffer[bufferIndex(model, index) * bufferPixelStride + pos * bufferSampleStride] = value;
+            historyBuffer[bufferIndex(model, index_neighbor) * bufferPixelStride + pos * bufferSampleStride] = value;
+          }
+        }
+
+        ++shift;
+        indX += jump[shift];
+      }
+    }
+  }
+
+  VIBE_COUNT(countUpdate(model, updates, updates));
+}
+
+// -----------------------------------------------------------------------------
+static void updateTask_8u_C1R(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t firstRow = 1 + bandRow(job->model->height - 2, job->numberOfBands, band);
+  uint32_t lastRow = 1 + bandRow(job->model->height - 2, job->numberOfBands, band + 1);
+
+  /* The first and last rows of the band may write in the neighboring bands: they are left for later. */
+  if (lastRow - firstRow > 2)
+    updateRows_8u_C1R(job->model, job->image_data, job->map, job->packed, firstRow + 1, lastRow - 1, &job->model->bandRandom[band]);
+}
+
+// -----------------------------------------------------------------------------
+// Update of the first and last rows of the bands, one band after the other
+// -----------------------------------------------------------------------------
+static void updateBandEdges_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask,
+  int packed,
+  uint32_t numberOfBands
+) {
+  uint32_t height = model->height;
+
+  for (uint32_t band = 0; band < numberOfBands; ++band) {
+    uint32_t firstRow = 1 + bandRow(height - 2, numberOfBands, band);
+    uint32_t lastRow = 1 + bandRow(height - 2, numberOfBands, band + 1);
+
+    updateRows_8u_C1R(model, image_data, updating_mask, packed, firstRow, firstRow + 1, &model->bandRandom[band]);
+
+    if (lastRow - 1 > firstRow)
+      updateRows_8u_C1R(model, image_data, updating_mask, packed, lastRow - 1, lastRow, &model->bandRandom[band]);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Update of the border of the frame: first and last rows, first and last
+// columns, and the first pixel
+// -----------------------------------------------------------------------------
+static void updateBorders_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask,
+  int packed
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+  uint32_t height = model->height;
+
+  uint8_t *historyImage = model->historyImage;
+  uint8_t *historyBuffer = model->historyBuffer;
+
+  /* Some utility variables. */
+  uint32_t bufferPixelStride = model->bufferPixelStride;
+  uint32_t bufferSampleStride = model->bufferSampleStride;
+  uint32_t numberOfHistoryImages = model->numberOfHistoryImages;
+
+  /* Updating. */
+  const uint32_t *jump = model->jump;
+  const uint32_t *position = model->position;
+
+  uint32_t shift, indX, indY;
+  VIBE_COUNT(uint64_t updates = 0);
+  int x, y;
+
+  /* First row. */
+  y = 0;
+  shift = vibe_rand_below(&model->random, width);
+  indX = jump[shift]; // index_jump should never be zero (> 1).
+
+  while (indX <= width - 1) {
+    int index = indX + y * width;
+
+    if (inROI(model, index) && isBackground(updating_mask, packed, index)) {
+      VIBE_COUNT(++updates);
+
+      if (position[shift] < numberOfHistoryImages)
+        historyImage[index + position[shift] * width * height] = *inputPixel(model, image_data, index);
+      else {
+        int pos = position[shift] - numberOfHistoryImages;
+        historyBuffer[bufferIndex(model, index) * bufferPixelStride + pos * bufferSampleStride] = *inputPixel(model, image_data, index);
+      }
+    }
+
+    ++shift; 
+    indX += jump[shift];
+  }
+
+  /* Last row. */
+  y = height - 1;
+  shift = vibe_rand_below(&model->random, width);
+  indX = jump[shift]; // index_jump should never be zero (> 1).
+
+  while (indX <= width - 1) {
+    int index = indX + y * width;
+
+    if (inROI(model, index) && isBackground(updating_mask, packed, index)) {
+      VIBE_COUNT(++updates);
+
+      if (position[shift] < numberOfHistoryImages)
+        historyImage[index + position[shift] * width * height] = *inputPixel(model, image_data, index);
+      else {
+        int pos = position[shift] - numberOfHistoryImages;
+        historyBuffer[bufferIndex(model, index) * bufferPixelStride + pos * bufferSampleStride] = *inputPixel(model, image_data, index);
+      }
+    }
+
+    ++shift;
+    indX += jump[shift];
+  }
+
+  /* First column. */
+  x = 0;
+  shift = vibe_rand_below(&model->random, height);
+  indY = jump[shift]; // index_jump should never be zero (> 1).
+
+  while (indY <= height - 1) {
+    int index = x + indY * width;
+
+    if (inROI(model, index) && isBackground(updating_mask, packed, index)) {
+      VIBE_COUNT(++updates);
+
+      if (position[shift] < numberOfHistoryImages)
+        historyImage[index + position[shift] * width * height] = *inputPixel(model, image_data, index);
+      else {
+        int pos = position[shift] - numberOfHistoryImages;
+        historyBuffer[bufferIndex(model, index) * bufferPixelStride + pos * bufferSampleStride] = *inputPixel(model, image_data, index);
+      }
+    }
+
+    ++shift;
+    indY += jump[shift];
+  }
+
+  /* Last column. */
+  x = width - 1;
+  shift = vibe_rand_below(&model->random, height);
+  indY = jump[shift]; // index_jump should never be zero (> 1).
+
+  while (indY <= height - 1) {
+    int index = x + indY * width;
+
+    if (inROI(model, index) && isBackground(updating_mask, packed, index)) {
+      VIBE_COUNT(++updates);
+
+      if (position[shift] < numberOfHistoryImages )
+        historyImage[index + position[shift] * width * height] = *inputPixel(model, image_data, index);
+      else {
+        int pos = position[shift] - numberOfHistoryImages;
+        historyBuffer[bufferIndex(model, index) * bufferPixelStride + pos * bufferSampleStride] = *inputPixel(model, image_data, index);
+      }
+    }
+
+    ++shift; 
+    indY += jump[shift];
+  }
+
+  /* The first pixel! */
+  if (vibe_rand_below(&model->random, model->updateFactor) == 0) {
+    if (inROI(model, 0) && isBackground(updating_mask, packed, 0)) {
+      VIBE_COUNT(++updates);
+
+      int position = vibe_rand_below(&model->random, model->numberOfSamples);
+
+      if (position < numberOfHistoryImages)
+        historyImage[position * width * height] = image_data[0];
+      else {
+        int pos = position - numberOfHistoryImages;
+        historyBuffer[pos * bufferSampleStride] =  image_data[0];
+      }
+    }
+  }
+
+  VIBE_COUNT(countUpdate(model, updates, 0));
+}
+
+// -----------------------------------------------------------------------------
+// Substitution of a sample of a pixel of the border by its input
+// -----------------------------------------------------------------------------
+static void borderSample_8u_C1R(vibeModel_Sequential_t *model, const uint8_t *image_data, uint32_t index, uint32_t position)
+{
+  uint32_t numberOfHistoryImages = model->numberOfHistoryImages;
+
+  if (position < numberOfHistoryImages)
+    model->historyImage[index + position * model->width * model->height] = *inputPixel(model, image_data, index);
+  else
+    model->historyBuffer[bufferIndex(model, index) * model->bufferPixelStride + (position - numberOfHistoryImages) * model->bufferSampleStride] = *inputPixel(model, image_data, index);
+}
+
+// ----------------------------------------------------------------------------
+// Update a C1R model, with a mask of bytes or of bits (packed)
+// ----------------------------------------------------------------------------
+static void update_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask,
+  int packed
+) {
+  /* Basic checks . */
+  assert((image_data != NULL) && (model != NULL) && (updating_mask != NULL));
+  assert((model->width > 0) && (model->height > 0));
+  assert((model->historyBuffer != NULL) && (model->sampleSize == 1));
+  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  /* All the frame, except the border. */
+  uint32_t height = model->height;
+
+  if (isBanded(model)) {
+    /* Each band draws from its own random stream, seeded in the band order. */
+    vibeBandJob_t job = { model, image_data, (uint8_t *)updating_mask, numberOfBands(model, height - 2), packed };
+
+    seedBands(model, job.numberOfBands);
+
+    runBands(model, updateTask_8u_C1R, &job);
+
+    /* Then, one band after the other, the rows next to the other bands. */
+    updateBandEdges_8u_C1R(model, image_data, updating_mask, packed, job.numberOfBands);
+  }
+  else
+    updateRows_8u_C1R(model, image_data, updating_mask, packed, 1, height - 1, &model->random);
+
+  updateBorders_8u_C1R(model, image_data, updating_mask, packed);
+}
+
+// ----------------------------------------------------------------------------
 // Update a C1R model
 // ----------------------------------------------------------------------------
-int32_t libvibeModel_Sequential_Update_8u_C1R(
+int32_t libvibeModel_Sequential_Update_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *updating_mask
+) {
+  update_8u_C1R(model, image_data, updating_mask, 0);
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// Update a C1R model with a packed mask
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Update_8u1u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask
+) {
+  update_8u_C1R(model, image_data, updating_mask, 1);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of the rows [firstRow, lastRow) and update of the rows
+// [firstUpdate, lastUpdate) of a C1R model, strip by strip. A row is updated
+// as soon as the rows around it (in which it may write) are segmented: the
+// strip stays in cache between both steps, and the results are those of a
+// segmentation of all the rows followed by their update.
+// -----------------------------------------------------------------------------
+static void processRows_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map,
+  uint32_t firstRow,
+  uint32_t lastRow,
+  uint32_t firstUpdate,
+  uint32_t lastUpdate,
+  vibeRandom_t *random
+) {
+  uint32_t width = model->width;
+  uint32_t rows = stripRows(model, 1);
+
+  for (uint32_t row = firstRow; row < lastRow;) {
+    uint32_t end = (lastRow - row > rows) ? row + rows : lastRow;
+
+    segmentInput(model, segmentation_8u_C1R, image_data, segmentation_map + row * width, row * width, (end - row) * width);
+    row = end;
+
+    /* The rows before end - 1 only write in segmented rows. */
+    uint32_t updated = (end - 1 < lastUpdate) ? end - 1 : lastUpdate;
+
+    if (firstUpdate < updated) {
+      updateRows_8u_C1R(model, image_data, segmentation_map, 0, firstUpdate, updated, random);
+      firstUpdate = updated;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+static void processTask_8u_C1R(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t height = job->model->height;
+  uint32_t firstRow = 1 + bandRow(height - 2, job->numberOfBands, band);
+  uint32_t lastRow = 1 + bandRow(height - 2, job->numberOfBands, band + 1);
+
+  /* The first and last bands also segment the border rows; the edges of the band are updated later. */
+  processRows_8u_C1R(
+    job->model, job->image_data, job->map,
+    (band == 0) ? 0 : firstRow, (band + 1 == job->numberOfBands) ? height : lastRow,
+    firstRow + 1, lastRow - 1, &job->model->bandRandom[band]
+  );
+}
+
+// -----------------------------------------------------------------------------
+static const vibeProcessSteps_t processSteps_8u_C1R = {
+  processTask_8u_C1R, processRows_8u_C1R, updateBandEdges_8u_C1R, updateBorders_8u_C1R, borderSample_8u_C1R
+};
+
+// ----------------------------------------------------------------------------
+// Segmentation and update of a C1R model in a single pass
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Process_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+) {
+  /* Basic checks. */
+  assert((image_data != NULL) && (model != NULL) && (segmentation_map != NULL));
+  assert((model->width > 0) && (model->height > 0));
+  assert((model->historyBuffer != NULL) && (model->sampleSize == 1));
+  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  process(model, image_data, segmentation_map, &processSteps_8u_C1R);
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// -------------------------- The same for C3R models -------------------------
+// ----------------------------------------------------------------------------
+
+/* Distances (in bytes) between the pixels and the channels of the historyImages of a C3R model. */
+static void setImageStrides_8u_C3R(vibeModel_Sequential_t *model)
+{
+  if (model->layout == VIBE_LAYOUT_PLANAR) {
+    model->imagePixelStride    = 1;
+    model->imageChannelStride  = model->width * model->height;
+  }
+  else {
+    model->imagePixelStride    = 3;
+    model->imageChannelStride  = 1;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Allocates and initializes a C3R model structure from an input image with
+// "channels" (3 or 4) channels
+// -----------------------------------------------------------------------------
+static void allocInit_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint32_t channels,
+  const uint32_t width,
+  const uint32_t height
+) {
+  /* Some basic checks. */
+  assert((image_data != NULL) && (model != NULL));
+  assert((width > 0) && (height > 0));
+
+  /* Finish model alloc - parameters values cannot be changed anymore. */
+  model->width = width;
+  model->height = height;
+  model->sampleSize = 1;
+  model->inputChannels = channels;
+  setNumberOfHistoryImages(model);
+
+  /* A padded or RGBX input image is copied once, as RGBRGB... without padding. */
+  uint8_t *packed = packInput(model, image_data, 3);
+
+  if (packed != NULL)
+    image_data = packed;
+
+  /* Memory layout: distances (in bytes) between pixels, samples and channels. */
+  uint32_t numberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
+
+  setImageStrides_8u_C3R(model);
+  setBufferStrides_8u(model, 3, numberOfTests);
+
+  /* Creates the historyImage structure. */
+  model->historyImage = NULL;
+  model->historyImage = (uint8_t*)allocHistory(model, model->numberOfHistoryImages * (3 * width) * height * sizeof(uint8_t));
+  assert(model->historyImage != NULL);
+
+  for (int i = 0; i < model->numberOfHistoryImages; ++i) {
+    if (model->layout == VIBE_LAYOUT_PLANAR)
+      model->kernels->deinterleave_8u_C3P3R(image_data, model->historyImage + i * (3 * width) * height, width * height, width * height);
+    else
+      memcpy(model->historyImage + i * (3 * width) * height, image_data, (3 * width) * height);
+  }
+
+  assert(model->historyImage != NULL);
+
+  /* Creates the history buffer: 3 bytes or 16 bits per sample. */
+  uint32_t sampleBytes = (model->sampleFormat == VIBE_SAMPLE_RGB888) ? 3 : sizeof(uint16_t);
+
+  model->historyBuffer = (uint8_t *)allocHistory(model, sampleBytes * bufferPixels(model) * ((numberOfTests > 0) ? numberOfTests : 1) * sizeof(uint8_t));
+  assert(model->historyBuffer != NULL);
+
+  /* Fills the history buffer */
+  fillHistoryBuffer_8u(model, image_data, 3);
+
+  free(packed);
+    
+  /* Fills the buffers with random values. */
+  allocTables(model);
+}
+
+// -----------------------------------------------------------------------------
+// Allocates and initializes a C3R model structure
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_AllocInit_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+) {
+  allocInit_8u_C3R(model, image_data, 3, width, height);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Allocates and initializes a C3R model structure from an RGBX image
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_AllocInit_8u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+) {
+  allocInit_8u_C3R(model, image_data, 4, width, height);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Search of the historyBuffer of samples of 16 bits, for the undecided pixels
+// of the segmentation of a C3R model (pixels numbered from pixel first): the
+// kernel tests up to 32 samples of a pixel at once, and the samples tested
+// (up to the match that brings the counter to zero) are then swapped with
+// swappingImageBuffer, as in the search of 3-byte samples (the matches only,
+// one by one, with the move-to-front ordering)
+// -----------------------------------------------------------------------------
+static void searchQuantized_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *swappingImageBuffer,
+  uint8_t *segmentation_map,
+  uint32_t first,
+  const uint32_t *tailIndex,
+  uint32_t numberOfTails,
+  vibeTailCounts_t *tailCounts
+) {
+  uint32_t numberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
+  int32_t threshold = vibe_threshold_8u_C3R(model->matchingThreshold);
+  uint32_t bits = greenBits(model);
+  uint32_t imagePixelStride = model->imagePixelStride;
+  uint32_t imageChannelStride = model->imageChannelStride;
+  int swapping = (model->sampleBlockSize == 1);
+  int moving = (model->sampleOrdering == VIBE_ORDERING_MOVE_TO_FRONT);
+
+  for (uint32_t t = 0; t < numberOfTails; ++t) {
+    uint32_t index = tailIndex[t];
+    const uint8_t *pixel = image_data + 3 * index;
+    uint8_t *swap = swappingImageBuffer + index * imagePixelStride;
+    uint16_t *samples = quantizedSample_8u_C3R(model, first + index, model->numberOfHistoryImages);
+    uint8_t counter = segmentation_map[index];
+    uint32_t tested = numberOfTests;
+
+    for (uint32_t start = 0; (start < numberOfTests) && (counter > 0); start += 32) {
+      uint32_t size = (numberOfTests - start < 32) ? numberOfTests - start : 32;
+      uint32_t matches = model->kernels->matches_8u_Q3R(samples + start, size, pixel, threshold, bits);
+
+      for (; (matches != 0) && (counter > 0); matches &= matches - 1) {
+        uint32_t i = start + __builtin_ctz(matches);
+
+        if (--counter == 0)
+          tested = i + 1;
+
+        /* Move-to-front ordering: the matches are swapped one by one. */
+        if (moving && swapping) {
+          VIBE_COUNT(++tailCounts->swappedSamples);
+          swapQuantized_8u_C3R(&samples[i], swap, imageChannelStride, bits);
+        }
+
+        if (moving && (i > 0)) {
+          VIBE_COUNT(++tailCounts->movedSamples);
+          moveToFront((uint8_t *)samples, i, sizeof(*samples));
+        }
+      }
+    }
+
+    /* Swaping: the buffer gets the quantized sample of the historyImage, which gets the center of the bin of the sample. */
+    VIBE_COUNT(tailCounts->testedSamples += tested);
+
+    if (swapping && !moving) {
+      VIBE_COUNT(tailCounts->swappedSamples += tested);
+
+      for (uint32_t i = 0; i < tested; ++i)
+        swapQuantized_8u_C3R(&samples[i], swap, imageChannelStride, bits);
+    }
+
+    segmentation_map[index] = (counter > 0) ? COLOR_FOREGROUND : COLOR_BACKGROUND;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of the pixels [first, first + numberOfPixels) of a C3R model
+// (image_data and segmentation_map point at pixel first, see vibeSegmentation_fn)
+// -----------------------------------------------------------------------------
+static void segmentation_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map,
+  uint32_t first,
+  uint32_t numberOfPixels
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+  uint32_t height = model->height;
+  uint32_t matchingNumber = model->matchingNumber;
+  uint32_t matchingThreshold = model->matchingThreshold;
+
+  /* From now on, the pixels are numbered from the first pixel of the band. */
+  uint8_t *historyImage = model->historyImage + first * model->imagePixelStride;
+  uint8_t *historyBuffer = model->historyBuffer + first * model->bufferPixelStride;
+  uint8_t *swappingImageBuffer = historyImage + (model->lastHistoryImageSwapped) * (3 * width) * height;
+
+  /* Segmentation: a single sweep over the historyImages writes the counters
+   * and collects the pixels that still need the historyBuffer search.
+   */
+  uint32_t *tailIndex = model->tailIndex + first;
+  uint32_t numberOfTails;
+
+  if (model->layout == VIBE_LAYOUT_PLANAR) {
+    /* The input frame is deinterleaved once (in registers) and compared with the planes. */
+    numberOfTails = model->kernels->historyCount_8u_P3R(
+      image_data, historyImage, width * height, (3 * width) * height, model->numberOfHistoryImages,
+      numberOfPixels, matchingNumber, matchingThreshold, segmentation_map, tailIndex
+    );
+  }
+  else {
+    numberOfTails = model->kernels->historyCount_8u_C3R(
+      image_data, historyImage, (3 * width) * height, model->numberOfHistoryImages,
+      numberOfPixels, matchingNumber, matchingThreshold, segmentation_map, tailIndex
+    );
+  }
+
+  // Now, we move in the buffer and leave the historyImages
+  int numberOfTests = (model->numberOfSamples - model->numberOfHistoryImages);
+  vibeTailCounts_t tailCounts = { 0, 0, 0 };
+
+  if (model->bufferLayout == VIBE_BUFFER_SAMPLE_MAJOR) {
+    /* The undecided pixels are searched together, sample plane by sample plane. */
+    if (model->layout == VIBE_LAYOUT_PLANAR) {
+      model->kernels->tailSearch_8u_P3R(
+        image_data, swappingImageBuffer, historyBuffer, width * height, (3 * width) * height, numberOfTests,
+        numberOfPixels, matchingThreshold, segmentation_map, tailIndex, numberOfTails, &tailCounts
+      );
+    }
+    else {
+      model->kernels->tailSearch_8u_C3R(
+        image_data, swappingImageBuffer, historyBuffer, (3 * width) * height, numberOfTests,
+        numberOfPixels, matchingThreshold, segmentation_map, tailIndex, numberOfTails, &tailCounts
+      );
+    }
+
+    VIBE_COUNT(countSegmentation(model, numberOfPixels, numberOfTails, &tailCounts));
+    return;
+  }
+
+  if (model->sampleFormat != VIBE_SAMPLE_RGB888) {
+    searchQuantized_8u_C3R(model, image_data, swappingImageBuffer, segmentation_map, first, tailIndex, numberOfTails, &tailCounts);
+
+    VIBE_COUNT(countSegmentation(model, numberOfPixels, numberOfTails, &tailCounts));
+    return;
+  }
+
+  int32_t threshold = vibe_threshold_8u_C3R(matchingThreshold);
+
+  uint32_t imagePixelStride = model->imagePixelStride;
+  uint32_t imageChannelStride = model->imageChannelStride;
+  uint32_t bufferPixelStride = model->bufferPixelStride;
+  uint32_t bufferSampleStride = model->bufferSampleStride;
+  uint32_t bufferChannelStride = model->bufferChannelStride;
+  int moving = (model->sampleOrdering == VIBE_ORDERING_MOVE_TO_FRONT);
+
+  for (uint32_t t = 0; t < numberOfTails; ++t) {
+    uint32_t index = tailIndex[t];
+
+    /* We need to check the full border and swap values with the first or second historyImage.
+     * We still need to find a match before we can stop our search.
+     */
+    const uint8_t *pixel = image_data + 3 * index;
+    uint8_t *swapping = swappingImageBuffer + index * imagePixelStride;
+    uint8_t *samples = model->historyBuffer + (size_t)bufferIndex(model, first + index) * bufferPixelStride;
+    uint8_t *sample = samples;
+
+    for (int i = numberOfTests; i > 0; --i, sample += bufferSampleStride) {
+      int match = distance_is_close_8u_C3R( 
+        pixel[0], pixel[1], pixel[2], 
+        sample[0], sample[bufferChannelStride], sample[2 * bufferChannelStride], 
+        threshold
+      );
+
+      if (match)
+        --segmentation_map[index]; 
+
+      /* Swaping: Putting found value in history image buffer (the samples of a block stay in place,
+       * and only the matching samples are swapped with the move-to-front ordering).
+       */
+      VIBE_COUNT(++tailCounts.testedSamples);
+
+      if ((model->sampleBlockSize == 1) && (match || !moving)) {
+        VIBE_COUNT(++tailCounts.swappedSamples);
+
+        for (int c = 0; c < 3; ++c) {
+          uint8_t temp = swapping[c * imageChannelStride];
+          swapping[c * imageChannelStride] = sample[c * bufferChannelStride];
+          sample[c * bufferChannelStride] = temp;
+        }
+      }
+
+      /* Move-to-front ordering. */
+      if (match && moving && (sample != samples)) {
+        VIBE_COUNT(++tailCounts.movedSamples);
+        moveToFront_8u_C3R(model, samples, numberOfTests - i);
+      }
+
+      /* Exit inner loop. */
+      if (segmentation_map[index] <= 0) break;
+    } // for
+
+    /* Produces the output. Note that this step is application-dependent.
+     * The other pixels already hold COLOR_BACKGROUND (a null counter).
+     */
+    if (segmentation_map[index] > 0) segmentation_map[index] = COLOR_FOREGROUND;
+  } // for
+
+  VIBE_COUNT(countSegmentation(model, numberOfPixels, numberOfTails, &tailCounts));
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of the pixels [first, first + numberOfPixels) of a C3R model
+// read from an RGBX image: the pixels are converted to RGBRGB... by chunks
+// that stay in cache (see vibeSegmentation_fn)
+// -----------------------------------------------------------------------------
+static void segmentation_8u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map,
+  uint32_t first,
+  uint32_t numberOfPixels
+) {
+  uint8_t pixels[3 * PACK_CHUNK_SIZE];
+
+  for (uint32_t chunk = 0; chunk < numberOfPixels; chunk += PACK_CHUNK_SIZE) {
+    uint32_t size = (numberOfPixels - chunk < PACK_CHUNK_SIZE) ? numberOfPixels - chunk : PACK_CHUNK_SIZE;
+
+    model->kernels->convert_8u_C4C3R(image_data + 4 * chunk, pixels, size);
+    segmentation_8u_C3R(model, pixels, segmentation_map + chunk, first + chunk, size);
+  }
+}
+
+/* Segmentation of the input images of a C3R model (RGB or RGBX). */
+static inline vibeSegmentation_fn inputSegmentation_8u_C3R(const vibeModel_Sequential_t *model)
+{
+  return (model->inputChannels == 4) ? segmentation_8u_C4R : segmentation_8u_C3R;
+}
+
+// -----------------------------------------------------------------------------
+static void segmentationTask_8u_C3R(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t width = job->model->width;
+  uint32_t firstRow = bandRow(job->model->height, job->numberOfBands, band);
+  uint32_t lastRow = bandRow(job->model->height, job->numberOfBands, band + 1);
+
+  segmentInput(job->model, inputSegmentation_8u_C3R(job->model), job->image_data, job->map + firstRow * width, firstRow * width, (lastRow - firstRow) * width);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a C3R model
+// -----------------------------------------------------------------------------
+static void segmentationImage_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+) {
+  /* Basic checks. */
+  assert((image_data != NULL) && (model != NULL) && (segmentation_map != NULL));
+  assert((model->width > 0) && (model->height > 0));
+  assert((model->historyBuffer != NULL) && (model->sampleSize == 1));
+  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  // For swapping
+  model->lastHistoryImageSwapped = (model->lastHistoryImageSwapped + 1) % model->numberOfHistoryImages;
+
+  /* The pixels are segmented independently of each other: the bands can run in parallel. */
+  vibeBandJob_t job = { model, image_data, segmentation_map, numberOfBands(model, model->height) };
+
+  beginStaticBlocks(model, image_data);
+  runBands(model, segmentationTask_8u_C3R, &job);
+  endStaticBlocks(model, segmentation_map, 0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a C3R model (RGB input images)
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Segmentation_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+) {
+  assert((model != NULL) && (model->inputChannels == 3));
+
+  segmentationImage_8u_C3R(model, image_data, segmentation_map);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a C3R model (RGBX input images)
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Segmentation_8u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+) {
+  assert((model != NULL) && (model->inputChannels == 4));
+
+  segmentationImage_8u_C3R(model, image_data, segmentation_map);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a band of a packed mask: the pixels are segmented by chunks
+// into counters that stay in cache, which are then packed into bits
+// -----------------------------------------------------------------------------
+static void segmentationPackedTask_8u_C3R(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t numberOfPixels = job->model->width * job->model->height;
+  uint32_t numberOfBytes = (numberOfPixels + 7) / 8;
+
+  /* The bands start on a byte of the mask. */
+  uint32_t first = 8 * bandRow(numberOfBytes, job->numberOfBands, band);
+  uint32_t last = 8 * bandRow(numberOfBytes, job->numberOfBands, band + 1);
+  uint8_t counts[PACK_CHUNK_SIZE];
+
+  if (last > numberOfPixels)
+    last = numberOfPixels;
+
+  for (uint32_t chunk = first; chunk < last; chunk += PACK_CHUNK_SIZE) {
+    uint32_t size = (last - chunk < PACK_CHUNK_SIZE) ? last - chunk : PACK_CHUNK_SIZE;
+
+    segmentInput(job->model, inputSegmentation_8u_C3R(job->model), job->image_data, counts, chunk, size);
+    job->model->kernels->pack_8u1u_C1R(counts, job->map + chunk / 8, size);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a C3R model into a packed mask
+// -----------------------------------------------------------------------------
+static void segmentationPacked_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_mask
+) {
+  /* Basic checks. */
+  assert((image_data != NULL) && (model != NULL) && (segmentation_mask != NULL));
+  assert((model->width > 0) && (model->height > 0));
+  assert((model->historyBuffer != NULL) && (model->sampleSize == 1));
+  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  /* For swapping. */
+  model->lastHistoryImageSwapped = (model->lastHistoryImageSwapped + 1) % model->numberOfHistoryImages;
+
+  /* Bands of whole bytes, so that no byte of the mask is written by two threads. */
+  uint32_t numberOfBytes = (model->width * model->height + 7) / 8;
+  vibeBandJob_t job = { model, image_data, segmentation_mask, numberOfBands(model, numberOfBytes) };
+
+  beginStaticBlocks(model, image_data);
+  runBands(model, segmentationPackedTask_8u_C3R, &job);
+  endStaticBlocks(model, segmentation_mask, 1);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a C3R model into a packed mask (RGB input images)
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Segmentation_8u1u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_mask
+) {
+  assert((model != NULL) && (model->inputChannels == 3));
+
+  segmentationPacked_8u_C3R(model, image_data, segmentation_mask);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a C3R model into a packed mask (RGBX input images)
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Segmentation_8u1u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_mask
+) {
+  assert((model != NULL) && (model->inputChannels == 4));
+
+  segmentationPacked_8u_C3R(model, image_data, segmentation_mask);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Update of the rows [firstRow, lastRow) of a C3R model (the frame border excepted)
+// -----------------------------------------------------------------------------
+static void updateRows_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask,
+  int packed,
+  uint32_t firstRow,
+  uint32_t lastRow,
+  vibeRandom_t *random
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+
+  /* Updating. */
+  const uint32_t *jump = model->jump;
+  const int *neighbor = model->neighbor;
+  const uint32_t *position = model->position;
+
+  uint32_t shift, indX;
+  uint32_t channels = model->inputChannels;
+  size_t step = inputStep(model);
+  int quantized = (model->sampleFormat != VIBE_SAMPLE_RGB888);
+
+  VIBE_COUNT(uint64_t updates = 0);
+
+  for (uint32_t y = firstRow; y < lastRow; ++y) {
+    const uint8_t *row = image_data + y * step;
+
+    const vibeSpan_t *spans;
+    uint32_t numberOfSpans = rowSpans(model, y, &spans);
+
+    for (uint32_t s = 0; s < numberOfSpans; ++s) {
+      /* The span, the first and last columns excepted. */
+      uint32_t first = (spans[s].first > 1) ? spans[s].first : 1;
+      uint32_t last = (spans[s].last < width - 1) ? spans[s].last : width - 1;
+
+      shift = vibe_rand_below(random, width);
+      indX = first - 1 + jump[shift]; // index_jump should never be zero (> 1).
+
+      while (indX < last) {
+        int index = indX + y * width;
+
+        if (isBackground(updating_mask, packed, index)) {
+          VIBE_COUNT(++updates);
+
+          /* In-place substitution. */
+          const uint8_t *pixel = row + channels * indX;
+          uint8_t r = pixel[0];
+          uint8_t g = pixel[1];
+          uint8_t b = pixel[2];
+
+          if (quantized && (position[shift] >= model->numberOfHistoryImages)) {
+            uint16_t value = vibe_quantize_8u_Q3R(r, g, b, greenBits(model));
+
+            *quantizedSample_8u_C3R(model, index, position[shift]) = value;
+            *quantizedSample_8u_C3R(model, index + neighbor[shift], position[shift]) = value;
+          }
+          else {
+            uint32_t pixelStride, channelStride;
+            uint8_t *sample = sample_8u_C3R(model, index, position[shift], &pixelStride, &channelStride);
+            uint8_t *sampleNeighbor = neighborSample_8u_C3R(model, sample, index, neighbor[shift], position[shift], pixelStride);
+
+            sample[0] = sampleNeighbor[0] = r;
+            sample[channelStride] = sampleNeighbor[channelStride] = g;
+            sample[2 * channelStride] = sampleNeighbor[2 * channelStride] = b;
+          }
+        }
+
+        ++shift;
+        indX += jump[shift];
+      }
+    }
+  }
+
+  VIBE_COUNT(countUpdate(model, updates, updates));
+}
+
+// -----------------------------------------------------------------------------
+static void updateTask_8u_C3R(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t firstRow = 1 + bandRow(job->model->height - 2, job->numberOfBands, band);
+  uint32_t lastRow = 1 + bandRow(job->model->height - 2, job->numberOfBands, band + 1);
+
+  /* The first and last rows of the band may write in the neighboring bands: they are left for later. */
+  if (lastRow - firstRow > 2)
+    updateRows_8u_C3R(job->model, job->image_data, job->map, job->packed, firstRow + 1, lastRow - 1, &job->model->bandRandom[band]);
+}
+
+// -----------------------------------------------------------------------------
+// Update of the first and last rows of the bands, one band after the other
+// -----------------------------------------------------------------------------
+static void updateBandEdges_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask,
+  int packed,
+  uint32_t numberOfBands
+) {
+  uint32_t height = model->height;
+
+  for (uint32_t band = 0; band < numberOfBands; ++band) {
+    uint32_t firstRow = 1 + bandRow(height - 2, numberOfBands, band);
+    uint32_t lastRow = 1 + bandRow(height - 2, numberOfBands, band + 1);
+
+    updateRows_8u_C3R(model, image_data, updating_mask, packed, firstRow, firstRow + 1, &model->bandRandom[band]);
+
+    if (lastRow - 1 > firstRow)
+      updateRows_8u_C3R(model, image_data, updating_mask, packed, lastRow - 1, lastRow, &model->bandRandom[band]);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Update of the border of the frame: first and last rows, first and last
+// columns, and the first pixel
+// -----------------------------------------------------------------------------
+static void updateBorders_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask,
+  int packed
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+  uint32_t height = model->height;
+
+  /* Updating. */
+  const uint32_t *jump = model->jump;
+  const uint32_t *position = model->position;
+
+  uint32_t shift, indX, indY;
+  VIBE_COUNT(uint64_t updates = 0);
+  int x, y;
+
+  /* First row. */
+  y = 0;
+  shift = vibe_rand_below(&model->random, width);
+  indX = jump[shift]; // index_jump should never be zero (> 1).
+
+  while (indX <= width - 1) {
+    int index = indX + y * width;
+
+    if (inROI(model, index) && isBackground(updating_mask, packed, index)) {
+      VIBE_COUNT(++updates);
+
+      const uint8_t *pixel = inputPixel(model, image_data, index);
+
+      setSample_8u_C3R(model, index, position[shift], pixel[0], pixel[1], pixel[2]);
+    }
+
+    ++shift;
+    indX += jump[shift];
+  }
+
+  /* Last row. */
+  y = height - 1;
+  shift = vibe_rand_below(&model->random, width);
+  indX = jump[shift]; // index_jump should never be zero (> 1).
+
+  while (indX <= width - 1) {
+    int index = indX + y * width;
+
+    if (inROI(model, index) && isBackground(updating_mask, packed, index)) {
+      VIBE_COUNT(++updates);
+
+      const uint8_t *pixel = inputPixel(model, image_data, index);
+
+      setSample_8u_C3R(model, index, position[shift], pixel[0], pixel[1], pixel[2]);
+    }
+
+    ++shift;
+    indX += jump[shift];
+  }
+
+  /* First column. */
+  x = 0;
+  shift = vibe_rand_below(&model->random, height);
+  indY = jump[shift]; // index_jump should never be zero (> 1).
+
+  while (indY <= height - 1) {
+    int index = x + indY * width;
+
+    if (inROI(model, index) && isBackground(updating_mask, packed, index)) {
+      VIBE_COUNT(++updates);
+
+      const uint8_t *pixel = inputPixel(model, image_data, index);
+
+      setSample_8u_C3R(model, index, position[shift], pixel[0], pixel[1], pixel[2]);
+    }
+
+    ++shift;
+    indY += jump[shift];
+  }
+
+  /* Last column. */
+  x = width - 1;
+  shift = vibe_rand_below(&model->random, height);
+  indY = jump[shift]; // index_jump should never be zero (> 1).
+
+  while (indY <= height - 1) {
+    int index = x + indY * width;
+
+    if (inROI(model, index) && isBackground(updating_mask, packed, index)) {
+      VIBE_COUNT(++updates);
+
+      const uint8_t *pixel = inputPixel(model, image_data, index);
+
+      setSample_8u_C3R(model, index, position[shift], pixel[0], pixel[1], pixel[2]);
+    }
+
+    ++shift;
+    indY += jump[shift];
+  }
+
+  /* The first pixel! */
+  if (vibe_rand_below(&model->random, model->updateFactor) == 0) {
+    if (inROI(model, 0) && isBackground(updating_mask, packed, 0)) {
+      VIBE_COUNT(++updates);
+
+      int position = vibe_rand_below(&model->random, model->numberOfSamples);
+
+      setSample_8u_C3R(model, 0, position, image_data[0], image_data[1], image_data[2]);
+    }
+  }
+
+  VIBE_COUNT(countUpdate(model, updates, 0));
+}
+
+// -----------------------------------------------------------------------------
+// Substitution of a sample of a pixel of the border by its input
+// -----------------------------------------------------------------------------
+static void borderSample_8u_C3R(vibeModel_Sequential_t *model, const uint8_t *image_data, uint32_t index, uint32_t position)
+{
+  const uint8_t *pixel = inputPixel(model, image_data, index);
+
+  setSample_8u_C3R(model, index, position, pixel[0], pixel[1], pixel[2]);
+}
+
+// ----------------------------------------------------------------------------
+// Update a C3R model, with a mask of bytes or of bits (packed)
+// ----------------------------------------------------------------------------
+static void update_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask,
+  int packed
+) {
+  /* Basic checks. */
+  assert((image_data != NULL) && (model != NULL) && (updating_mask != NULL));
+  assert((model->width > 0) && (model->height > 0));
+  assert((model->historyBuffer != NULL) && (model->sampleSize == 1));
+  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  /* All the frame, except the border. */
+  uint32_t height = model->height;
+
+  if (isBanded(model)) {
+    /* Each band draws from its own random stream, seeded in the band order. */
+    vibeBandJob_t job = { model, image_data, (uint8_t *)updating_mask, numberOfBands(model, height - 2), packed };
+
+    seedBands(model, job.numberOfBands);
+
+    runBands(model, updateTask_8u_C3R, &job);
+
+    /* Then, one band after the other, the rows next to the other bands. */
+    updateBandEdges_8u_C3R(model, image_data, updating_mask, packed, job.numberOfBands);
+  }
+  else
+    updateRows_8u_C3R(model, image_data, updating_mask, packed, 1, height - 1, &model->random);
+
+  updateBorders_8u_C3R(model, image_data, updating_mask, packed);
+}
+
+// ----------------------------------------------------------------------------
+// Update a C3R model
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Update_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *updating_mask
+) {
+  assert((model != NULL) && (model->inputChannels == 3));
+
+  update_8u_C3R(model, image_data, updating_mask, 0);
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// Update a C3R model (RGBX input images)
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Update_8u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *updating_mask
+) {
+  assert((model != NULL) && (model->inputChannels == 4));
+
+  update_8u_C3R(model, image_data, updating_mask, 0);
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// Update a C3R model with a packed mask
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Update_8u1u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask
+) {
+  assert((model != NULL) && (model->inputChannels == 3));
+
+  update_8u_C3R(model, image_data, updating_mask, 1);
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// Update a C3R model with a packed mask (RGBX input images)
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Update_8u1u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask
+) {
+  assert((model != NULL) && (model->inputChannels == 4));
+
+  update_8u_C3R(model, image_data, updating_mask, 1);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of the rows [firstRow, lastRow) and update of the rows
+// [firstUpdate, lastUpdate) of a C3R model, strip by strip. A row is updated
+// as soon as the rows around it (in which it may write) are segmented: the
+// strip stays in cache between both steps, and the results are those of a
+// segmentation of all the rows followed by their update.
+// -----------------------------------------------------------------------------
+static void processRows_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map,
+  uint32_t firstRow,
+  uint32_t lastRow,
+  uint32_t firstUpdate,
+  uint32_t lastUpdate,
+  vibeRandom_t *random
+) {
+  uint32_t width = model->width;
+  uint32_t rows = stripRows(model, 3);
+
+  for (uint32_t row = firstRow; row < lastRow;) {
+    uint32_t end = (lastRow - row > rows) ? row + rows : lastRow;
+
+    segmentInput(model, inputSegmentation_8u_C3R(model), image_data, segmentation_map + row * width, row * width, (end - row) * width);
+    row = end;
+
+    /* The rows before end - 1 only write in segmented rows. */
+    uint32_t updated = (end - 1 < lastUpdate) ? end - 1 : lastUpdate;
+
+    if (firstUpdate < updated) {
+      updateRows_8u_C3R(model, image_data, segmentation_map, 0, firstUpdate, updated, random);
+      firstUpdate = updated;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+static void processTask_8u_C3R(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t height = job->model->height;
+  uint32_t firstRow = 1 + bandRow(height - 2, job->numberOfBands, band);
+  uint32_t lastRow = 1 + bandRow(height - 2, job->numberOfBands, band + 1);
+
+  /* The first and last bands also segment the border rows; the edges of the band are updated later. */
+  processRows_8u_C3R(
+    job->model, job->image_data, job->map,
+    (band == 0) ? 0 : firstRow, (band + 1 == job->numberOfBands) ? height : lastRow,
+    firstRow + 1, lastRow - 1, &job->model->bandRandom[band]
+  );
+}
+
+// -----------------------------------------------------------------------------
+static const vibeProcessSteps_t processSteps_8u_C3R = {
+  processTask_8u_C3R, processRows_8u_C3R, updateBandEdges_8u_C3R, updateBorders_8u_C3R, borderSample_8u_C3R
+};
+
+// ----------------------------------------------------------------------------
+// Segmentation and update of a C3R model in a single pass
+// ----------------------------------------------------------------------------
+static void process_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+) {
+  /* Basic checks. */
+  assert((image_data != NULL) && (model != NULL) && (segmentation_map != NULL));
+  assert((model->width > 0) && (model->height > 0));
+  assert((model->historyBuffer != NULL) && (model->sampleSize == 1));
+  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  process(model, image_data, segmentation_map, &processSteps_8u_C3R);
+}
+
+// ----------------------------------------------------------------------------
+// Segmentation and update of a C3R model in a single pass (RGB input images)
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Process_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+) {
+  assert((model != NULL) && (model->inputChannels == 3));
+
+  process_8u_C3R(model, image_data, segmentation_map);
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// Segmentation and update of a C3R model in a single pass (RGBX input images)
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Process_8u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+) {
+  assert((model != NULL) && (model->inputChannels == 4));
+
+  process_8u_C3R(model, image_data, segmentation_map);
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// -------------------- The same for 16u (16-bit) models ----------------------
+// ----------------------------------------------------------------------------
+//
+// The samples of a 16u model are uint16_t values stored in historyImage and
+// historyBuffer, and all the strides count samples instead of bytes. The
+// segmentation maps and the updating masks still hold one byte per pixel.
+// A C3R 16u model is always interleaved (RGBRGB...), and the C1R models use
+// imagePixelStride = 1, so that both share the update code below.
+
+/* The threshold is the integer bound given by vibe_threshold_16u_C3R (equivalent to 4.5 * matchingThreshold). */
+static inline int32_t distance_is_close_16u_C3R(const uint16_t *a, const uint16_t *b, int32_t threshold)
+{
+  return (abs_uint(a[0] - b[0]) + abs_uint(a[1] - b[1]) + abs_uint(a[2] - b[2]) <= threshold);
+}
+
+// -----------------------------------------------------------------------------
+// Address of the sample "position" of pixel "index" of a 16u model; the same
+// sample of pixel index + 1 is at pixelStride
+// -----------------------------------------------------------------------------
+static inline uint16_t *sample_16u(const vibeModel_Sequential_t *model, uint32_t index, uint32_t position, uint32_t *pixelStride)
+{
+  if (position < model->numberOfHistoryImages) {
+    *pixelStride = model->imagePixelStride;
+    return((uint16_t *)model->historyImage + (position * model->width * model->height + index) * model->imagePixelStride);
+  }
+
+  *pixelStride = model->bufferPixelStride;
+  return((uint16_t *)model->historyBuffer + index * model->bufferPixelStride + (position - model->numberOfHistoryImages) * model->bufferSampleStride);
+}
+
+/* Initial sample of a 16u model: the value plus a noise as wide as the matching
+ * threshold (the [-10, 10) noise of the 8u models for the default threshold).
+ */
+static inline uint16_t noisySample_16u(vibeRandom_t *random, int32_t value, uint32_t matchingThreshold)
+{
+  int32_t value_plus_noise = value + (int32_t)vibe_rand_below(random, matchingThreshold) - (int32_t)(matchingThreshold / 2);
+
+  if (value_plus_noise < 0) { value_plus_noise = 0; }
+  if (value_plus_noise > 65535) { value_plus_noise = 65535; }
+
+  return((uint16_t)value_plus_noise);
+}
+
+/* Distances (in samples) between the pixels, samples and channels of a 16u model with "channels" interleaved channels. */
+static void setStrides_16u(vibeModel_Sequential_t *model, uint32_t channels, uint32_t numberOfTests)
+{
+  model->imagePixelStride    = channels;
+  model->imageChannelStride  = 1;
+  model->bufferChannelStride = 1;
+
+  if (model->bufferLayout == VIBE_BUFFER_SAMPLE_MAJOR) {
+    model->bufferPixelStride  = channels;
+    model->bufferSampleStride = (channels * model->width) * model->height;
+  }
+  else {
+    model->bufferPixelStride  = channels * numberOfTests;
+    model->bufferSampleStride = channels;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Allocates and initializes a 16u model with "channels" (1 or 3) interleaved channels
+// -----------------------------------------------------------------------------
+static void allocInit_16u(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  uint32_t channels,
+  const uint32_t width,
+  const uint32_t height
+) {
+  /* The samples of the 16u models are neither shared by blocks of pixels nor quantized. */
+  assert((model->sampleBlockSize == 1) && (model->sampleFormat == VIBE_SAMPLE_RGB888));
+
+  /* Finish model alloc - parameters values cannot be changed anymore. */
+  model->width = width;
+  model->height = height;
+  model->sampleSize = 2;
+  model->inputChannels = channels;
+  setNumberOfHistoryImages(model);
+
+  /* A padded input image is copied once, without its padding. */
+  uint16_t *packed = (uint16_t *)packInput(model, (const uint8_t *)image_data, channels);
+
+  if (packed != NULL)
+    image_data = packed;
+
+  /* Memory layout: distances (in samples) between pixels, samples and channels. */
+  uint32_t numberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
+
+  setStrides_16u(model, channels, numberOfTests);
+
+  /* Creates the historyImage structure. */
+  uint16_t *historyImage = (uint16_t *)allocHistory(model, model->numberOfHistoryImages * (channels * width) * height * sizeof(uint16_t));
+  assert(historyImage != NULL);
+
+  for (int i = 0; i < model->numberOfHistoryImages; ++i)
+    memcpy(historyImage + i * (channels * width) * height, image_data, (channels * width) * height * sizeof(uint16_t));
+
+  /* Creates and fills the history buffer. */
+  uint16_t *historyBuffer = (uint16_t *)allocHistory(model, (channels * width) * height * ((numberOfTests > 0) ? numberOfTests : 1) * sizeof(uint16_t));
+  assert(historyBuffer != NULL);
+
+  for (uint32_t index = 0; index < width * height; ++index) {
+    for (uint32_t x = 0; x < numberOfTests; ++x) {
+      uint16_t *sample = historyBuffer + index * model->bufferPixelStride + x * model->bufferSampleStride;
+
+      for (uint32_t c = 0; c < channels; ++c)
+        sample[c] = noisySample_16u(&model->random, image_data[channels * index + c], model->matchingThreshold);
+    }
+  }
+
+  model->historyImage = (uint8_t *)historyImage;
+  model->historyBuffer = (uint8_t *)historyBuffer;
+
+  free(packed);
+
+  /* Fills the buffers with random values. */
+  allocTables(model);
+}
+
+// -----------------------------------------------------------------------------
+// Allocates and initializes a 16u C1R model structure
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_AllocInit_16u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+) {
+  /* Some basic checks. */
+  assert((image_data != NULL) && (model != NULL));
+  assert((width > 0) && (height > 0));
+
+  allocInit_16u(model, image_data, 1, width, height);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Allocates and initializes a 16u C3R model structure
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_AllocInit_16u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+) {
+  /* Some basic checks. */
+  assert((image_data != NULL) && (model != NULL));
+  assert((width > 0) && (height > 0));
+
+  /* The 16u C3R models are always interleaved. */
+  assert(model->layout == VIBE_LAYOUT_INTERLEAVED);
+
+  allocInit_16u(model, image_data, 3, width, height);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of the pixels [first, first + numberOfPixels) of a 16u C1R model
+// (input and segmentation_map point at pixel first, see vibeSegmentation_fn)
+// -----------------------------------------------------------------------------
+static void segmentation_16u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *input,
+  uint8_t *segmentation_map,
+  uint32_t first,
+  uint32_t numberOfPixels
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+  uint32_t height = model->height;
+  uint32_t matchingThreshold = model->matchingThreshold;
+  uint32_t bufferPixelStride = model->bufferPixelStride;
+  uint32_t bufferSampleStride = model->bufferSampleStride;
+
+  /* From now on, the pixels are numbered from the first pixel of the band. */
+  const uint16_t *image_data = (const uint16_t *)input;
+  uint16_t *historyImage = (uint16_t *)model->historyImage + first;
+  uint16_t *historyBuffer = (uint16_t *)model->historyBuffer + first * bufferPixelStride;
+  uint16_t *swappingImageBuffer = historyImage + (model->lastHistoryImageSwapped) * width * height;
+
+  /* A single sweep over the historyImages, as for the 8u models. */
+  uint32_t *tailIndex = model->tailIndex + first;
+  uint32_t numberOfTails = model->kernels->historyCount_16u_C1R(
+    image_data, historyImage, width * height, model->numberOfHistoryImages,
+    numberOfPixels, model->matchingNumber, matchingThreshold, segmentation_map, tailIndex
+  );
+
+  /* Now, we move in the buffer and leave the historyImages. */
+  int numberOfTests = (model->numberOfSamples - model->numberOfHistoryImages);
+  VIBE_COUNT(vibeTailCounts_t tailCounts = { 0 });
+
+  for (uint32_t t = 0; t < numberOfTails; ++t) {
+    uint32_t index = tailIndex[t];
+    int32_t currentValue = image_data[index];
+    uint16_t *sample = historyBuffer + index * bufferPixelStride;
+
+    for (int i = numberOfTests; i > 0; --i, sample += bufferSampleStride) {
+      VIBE_COUNT(++tailCounts.testedSamples);
+
+      if (abs_uint(currentValue - *sample) <= matchingThreshold) {
+        --segmentation_map[index];
+
+        /* Swaping: Putting found value in history image buffer. */
+        VIBE_COUNT(++tailCounts.swappedSamples);
+        uint16_t temp = swappingImageBuffer[index];
+        swappingImageBuffer[index] = *sample;
+        *sample = temp;
+
+        /* Exit inner loop. */
+        if (segmentation_map[index] <= 0) break;
+      }
+    } // for
+
+    if (segmentation_map[index] > 0) segmentation_map[index] = COLOR_FOREGROUND;
+  } // for
+
+  VIBE_COUNT(countSegmentation(model, numberOfPixels, numberOfTails, &tailCounts));
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of the pixels [first, first + numberOfPixels) of a 16u C3R model
+// (input and segmentation_map point at pixel first, see vibeSegmentation_fn)
+// -----------------------------------------------------------------------------
+static void segmentation_16u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *input,
+  uint8_t *segmentation_map,
+  uint32_t first,
+  uint32_t numberOfPixels
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+  uint32_t height = model->height;
+  uint32_t bufferPixelStride = model->bufferPixelStride;
+  uint32_t bufferSampleStride = model->bufferSampleStride;
+
+  /* From now on, the pixels are numbered from the first pixel of the band. */
+  const uint16_t *image_data = (const uint16_t *)input;
+  uint16_t *historyImage = (uint16_t *)model->historyImage + 3 * first;
+  uint16_t *historyBuffer = (uint16_t *)model->historyBuffer + first * bufferPixelStride;
+  uint16_t *swappingImageBuffer = historyImage + (model->lastHistoryImageSwapped) * (3 * width) * height;
+
+  /* A single sweep over the historyImages, as for the 8u models. */
+  uint32_t *tailIndex = model->tailIndex + first;
+  uint32_t numberOfTails = model->kernels->historyCount_16u_C3R(
+    image_data, historyImage, (3 * width) * height, model->numberOfHistoryImages,
+    numberOfPixels, model->matchingNumber, model->matchingThreshold, segmentation_map, tailIndex
+  );
+
+  /* Now, we move in the buffer and leave the historyImages. */
+  int numberOfTests = (model->numberOfSamples - model->numberOfHistoryImages);
+  int32_t threshold = vibe_threshold_16u_C3R(model->matchingThreshold);
+  VIBE_COUNT(vibeTailCounts_t tailCounts = { 0 });
+
+  for (uint32_t t = 0; t < numberOfTails; ++t) {
+    uint32_t index = tailIndex[t];
+    const uint16_t *pixel = image_data + 3 * index;
+    uint16_t *swapping = swappingImageBuffer + 3 * index;
+    uint16_t *sample = historyBuffer + index * bufferPixelStride;
+
+    for (int i = numberOfTests; i > 0; --i, sample += bufferSampleStride) {
+      if (distance_is_close_16u_C3R(pixel, sample, threshold))
+        --segmentation_map[index];
+
+      /* Swaping: Putting found value in history image buffer (as for the 8u C3R models, every tested sample). */
+      VIBE_COUNT(++tailCounts.testedSamples; ++tailCounts.swappedSamples);
+
+      for (int c = 0; c < 3; ++c) {
+        uint16_t temp = swapping[c];
+        swapping[c] = sample[c];
+        sample[c] = temp;
+      }
+
+      /* Exit inner loop. */
+      if (segmentation_map[index] <= 0) break;
+    } // for
+
+    if (segmentation_map[index] > 0) segmentation_map[index] = COLOR_FOREGROUND;
+  } // for
+
+  VIBE_COUNT(countSegmentation(model, numberOfPixels, numberOfTails, &tailCounts));
+}
+
+// -----------------------------------------------------------------------------
+static void segmentationTask_16u_C1R(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t width = job->model->width;
+  uint32_t firstRow = bandRow(job->model->height, job->numberOfBands, band);
+  uint32_t lastRow = bandRow(job->model->height, job->numberOfBands, band + 1);
+
+  segmentInput(job->model, segmentation_16u_C1R, job->image_data, job->map + firstRow * width, firstRow * width, (lastRow - firstRow) * width);
+}
+
+// -----------------------------------------------------------------------------
+static void segmentationTask_16u_C3R(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t width = job->model->width;
+  uint32_t firstRow = bandRow(job->model->height, job->numberOfBands, band);
+  uint32_t lastRow = bandRow(job->model->height, job->numberOfBands, band + 1);
+
+  segmentInput(job->model, segmentation_16u_C3R, job->image_data, job->map + firstRow * width, firstRow * width, (lastRow - firstRow) * width);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a 16u model, band by band
+// -----------------------------------------------------------------------------
+static void segmentation_16u(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  uint8_t *segmentation_map,
+  vibeTask_fn task
+) {
+  /* Basic checks. */
+  assert((image_data != NULL) && (model != NULL) && (segmentation_map != NULL));
+  assert((model->width > 0) && (model->height > 0));
+  assert((model->historyBuffer != NULL) && (model->sampleSize == 2));
+  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  /* For swapping. */
+  model->lastHistoryImageSwapped = (model->lastHistoryImageSwapped + 1) % model->numberOfHistoryImages;
+
+  /* The pixels are segmented independently of each other: the bands can run in parallel. */
+  vibeBandJob_t job = { model, (const uint8_t *)image_data, segmentation_map, numberOfBands(model, model->height) };
+  runBands(model, task, &job);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a 16u C1R model
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Segmentation_16u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  uint8_t *segmentation_map
+) {
+  assert((model != NULL) && (model->imagePixelStride == 1));
+
+  segmentation_16u(model, image_data, segmentation_map, segmentationTask_16u_C1R);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a 16u C3R model
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Segmentation_16u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  uint8_t *segmentation_map
+) {
+  assert((model != NULL) && (model->imagePixelStride == 3));
+
+  segmentation_16u(model, image_data, segmentation_map, segmentationTask_16u_C3R);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Stores the pixel "pixel" as the sample "position" of pixel "index" of a 16u model
+// -----------------------------------------------------------------------------
+static inline void setSample_16u(vibeModel_Sequential_t *model, uint32_t index, uint32_t position, const uint16_t *pixel)
+{
+  uint32_t pixelStride;
+  uint16_t *sample = sample_16u(model, index, position, &pixelStride);
+
+  for (uint32_t c = 0; c < model->imagePixelStride; ++c)
+    sample[c] = pixel[c];
+}
+
+// -----------------------------------------------------------------------------
+// Update of the rows [firstRow, lastRow) of a 16u model (the frame border excepted)
+// -----------------------------------------------------------------------------
+static void updateRows_16u(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  const uint8_t *updating_mask,
+  uint32_t firstRow,
+  uint32_t lastRow,
+  vibeRandom_t *random
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+  uint32_t channels = model->imagePixelStride;
+
+  /* Updating. */
+  const uint32_t *jump = model->jump;
+  const int *neighbor = model->neighbor;
+  const uint32_t *position = model->position;
+
+  uint32_t shift, indX;
+  size_t step = inputStep(model);
+
+  VIBE_COUNT(uint64_t updates = 0);
+
+  for (uint32_t y = firstRow; y < lastRow; ++y) {
+    const uint16_t *row = (const uint16_t *)((const uint8_t *)image_data + y * step);
+
+    const vibeSpan_t *spans;
+    uint32_t numberOfSpans = rowSpans(model, y, &spans);
+
+    for (uint32_t s = 0; s < numberOfSpans; ++s) {
+      /* The span, the first and last columns excepted. */
+      uint32_t first = (spans[s].first > 1) ? spans[s].first : 1;
+      uint32_t last = (spans[s].last < width - 1) ? spans[s].last : width - 1;
+
+      shift = vibe_rand_below(random, width);
+      indX = first - 1 + jump[shift]; // index_jump should never be zero (> 1).
+
+      while (indX < last) {
+        int index = indX + y * width;
+
+        if (updating_mask[index] == COLOR_BACKGROUND) {
+          VIBE_COUNT(++updates);
+
+          /* In-place substitution. */
+          const uint16_t *pixel = row + channels * indX;
+
+          uint32_t pixelStride;
+          uint16_t *sample = sample_16u(model, index, position[shift], &pixelStride);
+          uint16_t *sampleNeighbor = sample + neighbor[shift] * (int)pixelStride;
+
+          for (uint32_t c = 0; c < channels; ++c)
+            sample[c] = sampleNeighbor[c] = pixel[c];
+        }
+
+        ++shift;
+        indX += jump[shift];
+      }
+    }
+  }
+
+  VIBE_COUNT(countUpdate(model, updates, updates));
+}
+
+// -----------------------------------------------------------------------------
+static void updateTask_16u(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t firstRow = 1 + bandRow(job->model->height - 2, job->numberOfBands, band);
+  uint32_t lastRow = 1 + bandRow(job->model->height - 2, job->numberOfBands, band + 1);
+
+  /* The first and last rows of the band may write in the neighboring bands: they are left for later. */
+  if (lastRow - firstRow > 2)
+    updateRows_16u(job->model, (const uint16_t *)job->image_data, job->map, firstRow + 1, lastRow - 1, &job->model->bandRandom[band]);
+}
+
+// -----------------------------------------------------------------------------
+// Update of the first and last rows of the bands, one band after the other
+// -----------------------------------------------------------------------------
+static void updateBandEdges_16u(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  const uint8_t *updating_mask,
+  uint32_t numberOfBands
+) {
+  uint32_t height = model->height;
+
+  for (uint32_t band = 0; band < numberOfBands; ++band) {
+    uint32_t firstRow = 1 + bandRow(height - 2, numberOfBands, band);
+    uint32_t lastRow = 1 + bandRow(height - 2, numberOfBands, band + 1);
+
+    updateRows_16u(model, image_data, updating_mask, firstRow, firstRow + 1, &model->bandRandom[band]);
+
+    if (lastRow - 1 > firstRow)
+      updateRows_16u(model, image_data, updating_mask, lastRow - 1, lastRow, &model->bandRandom[band]);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Update of the border of the frame: first and last rows, first and last
+// columns, and the first pixel
+// -----------------------------------------------------------------------------
+static void updateBorders_16u(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  const uint8_t *updating_mask
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+  uint32_t height = model->height;
+
+  /* Updating. */
+  const uint32_t *jump = model->jump;
+  const uint32_t *position = model->position;
+
+  uint32_t shift, indX, indY;
+  VIBE_COUNT(uint64_t updates = 0);
+
+  /* First and last rows. */
+  for (uint32_t y = 0; y < height; y += (height > 1) ? height - 1 : 1) {
+    shift = vibe_rand_below(&model->random, width);
+    indX = jump[shift]; // index_jump should never be zero (> 1).
+
+    while (indX <= width - 1) {
+      int index = indX + y * width;
+
+      if (inROI(model, index) && (updating_mask[index] == COLOR_BACKGROUND)) {
+        VIBE_COUNT(++updates);
+        setSample_16u(model, index, position[shift], (const uint16_t *)inputPixel(model, (const uint8_t *)image_data, index));
+      }
+
+      ++shift;
+      indX += jump[shift];
+    }
+  }
+
+  /* First and last columns. */
+  for (uint32_t x = 0; x < width; x += (width > 1) ? width - 1 : 1) {
+    shift = vibe_rand_below(&model->random, height);
+    indY = jump[shift]; // index_jump should never be zero (> 1).
+
+    while (indY <= height - 1) {
+      int index = x + indY * width;
+
+      if (inROI(model, index) && (updating_mask[index] == COLOR_BACKGROUND)) {
+        VIBE_COUNT(++updates);
+        setSample_16u(model, index, position[shift], (const uint16_t *)inputPixel(model, (const uint8_t *)image_data, index));
+      }
+
+      ++shift;
+      indY += jump[shift];
+    }
+  }
+
+  /* The first pixel! */
+  if (vibe_rand_below(&model->random, model->updateFactor) == 0) {
+    if (inROI(model, 0) && (updating_mask[0] == COLOR_BACKGROUND)) {
+      VIBE_COUNT(++updates);
+
+      int position = vibe_rand_below(&model->random, model->numberOfSamples);
+
+      setSample_16u(model, 0, position, image_data);
+    }
+  }
+
+  VIBE_COUNT(countUpdate(model, updates, 0));
+}
+
+// ----------------------------------------------------------------------------
+// Update a 16u model
+// ----------------------------------------------------------------------------
+static void update_16u(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  const uint8_t *updating_mask
+) {
+  /* Basic checks. */
+  assert((image_data != NULL) && (model != NULL) && (updating_mask != NULL));
+  assert((model->width > 0) && (model->height > 0));
+  assert((model->historyBuffer != NULL) && (model->sampleSize == 2));
+  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  /* All the frame, except the border. */
+  uint32_t height = model->height;
+
+  if ((model->numberOfThreads > 1) && (height > 2)) {
+    /* Each band draws from its own random stream, seeded in the band order. */
+    vibeBandJob_t job = { model, (const uint8_t *)image_data, (uint8_t *)updating_mask, numberOfBands(model, height - 2) };
+
+    seedBands(model, job.numberOfBands);
+
+    runBands(model, updateTask_16u, &job);
+
+    /* Then, one band after the other, the rows next to the other bands. */
+    updateBandEdges_16u(model, image_data, updating_mask, job.numberOfBands);
+  }
+  else
+    updateRows_16u(model, image_data, updating_mask, 1, height - 1, &model->random);
+
+  updateBorders_16u(model, image_data, updating_mask);
+}
+
+// ----------------------------------------------------------------------------
+// Update a 16u C1R model
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Update_16u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  uint8_t *updating_mask
+) {
+  assert((model != NULL) && (model->imagePixelStride == 1));
+
+  update_16u(model, image_data, updating_mask);
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// Update a 16u C3R model
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Update_16u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  uint8_t *updating_mask
+) {
+  assert((model != NULL) && (model->imagePixelStride == 3));
+
+  update_16u(model, image_data, updating_mask);
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// ------------------- The same for YUV 4:2:0 (I420/NV12) models --------------
+// ----------------------------------------------------------------------------
+//
+// A YUV 4:2:0 model keeps a luma sample per pixel and a chroma sample (U and
+// V) per 2x2 block of pixels, that is 1.5 bytes per sample instead of 3 for a
+// C3R model. Every historyImage is a luma plane (width * height bytes)
+// followed by a chroma plane of interleaved UV pairs (width * height / 2
+// bytes, the pair of the block of pixel (x, y) at (y / 2) * width + (x & ~1)).
+// The historyBuffer keeps the samples of a block together (Y00 Y01 Y10 Y11 U V,
+// 6 bytes), so that the update of a sample writes a single cache line; its
+// bufferPixelStride and bufferSampleStride are the distances between blocks
+// and between samples.
+//
+// A pixel is close to a sample when |Y - Y'| + |U - U'| + |V - V'| is at most
+// the bound of the C3R models. The four pixels of a block share their chroma
+// samples, so the bands always start on an even row: no chroma sample is
+// written by two threads. The input images are read in place; with
+// SetImageStep, imageStep is the step of the luma rows (and of the UV rows of
+// an NV12 image), the U and V rows of an I420 image having imageStep / 2 bytes.
+
+/* Number of bytes of a historyImage (luma, then chroma). */
+static inline size_t planeSize_8u_420(const vibeModel_Sequential_t *model)
+{
+  return (size_t)model->width * model->height * 3 / 2;
+}
+
+/* Chroma of the input row y from pixel x (even) to pixel x + numberOfPixels, as
+ * UVUV...: read in place for NV12, interleaved into "buffer" for I420.
+ */
+static inline const uint8_t *inputChroma_8u_420(
+  const vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint32_t x,
+  uint32_t y,
+  uint32_t numberOfPixels,
+  uint8_t *buffer
+) {
+  size_t step = inputStep(model);
+  const uint8_t *chroma = image_data + step * model->height;
+
+  if (model->chromaFormat == VIBE_CHROMA_NV12)
+    return(chroma + (y / 2) * step + x);
+
+  const uint8_t *u = chroma + (y / 2) * (step / 2) + x / 2;
+  const uint8_t *v = u + (step / 2) * (model->height / 2);
+
+  for (uint32_t i = 0; i < numberOfPixels / 2; ++i) {
+    buffer[2 * i]     = u[i];
+    buffer[2 * i + 1] = v[i];
+  }
+
+  return(buffer);
+}
+
+/* Luma and chroma of pixel (x, y) of an input image, as yuv[0], yuv[1] and yuv[2]. */
+static inline void inputPixel_8u_420(const vibeModel_Sequential_t *model, const uint8_t *image_data, uint32_t x, uint32_t y, uint8_t *yuv)
+{
+  uint8_t buffer[2];
+  const uint8_t *uv = inputChroma_8u_420(model, image_data, x & ~1u, y, 2, buffer);
+
+  yuv[0] = image_data[y * inputStep(model) + x];
+  yuv[1] = uv[0];
+  yuv[2] = uv[1];
+}
+
+/* First sample of the 2x2 block of pixel (x, y) in the historyBuffer. */
+static inline uint8_t *bufferSample_8u_420(const vibeModel_Sequential_t *model, uint32_t x, uint32_t y)
+{
+  return model->historyBuffer + ((y / 2) * (model->width / 2) + x / 2) * model->bufferPixelStride;
+}
+
+// -----------------------------------------------------------------------------
+// Stores yuv as the sample "position" of pixel (x, y) of a YUV 4:2:0 model
+// (the chroma being shared by the pixels of the 2x2 block)
+// -----------------------------------------------------------------------------
+static inline void setSample_8u_420(vibeModel_Sequential_t *model, uint32_t x, uint32_t y, uint32_t position, const uint8_t *yuv)
+{
+  uint32_t width = model->width;
+  uint32_t height = model->height;
+  uint8_t *luma, *chroma;
+
+  if (position < model->numberOfHistoryImages) {
+    uint8_t *historyImage = model->historyImage + position * planeSize_8u_420(model);
+
+    luma = historyImage + y * width + x;
+    chroma = historyImage + width * height + (y / 2) * width + (x & ~1u);
+  }
+  else {
+    uint8_t *sample = bufferSample_8u_420(model, x, y) + (position - model->numberOfHistoryImages) * model->bufferSampleStride;
+
+    luma = sample + 2 * (y & 1) + (x & 1);
+    chroma = sample + 4;
+  }
+
+  luma[0] = yuv[0];
+  chroma[0] = yuv[1];
+  chroma[1] = yuv[2];
+}
+
+/* Initial sample of a YUV 4:2:0 model: the value plus the [-10, 10) noise of the 8u models. */
+static inline uint8_t noisySample_8u_420(vibeRandom_t *random, int value)
+{
+  int value_plus_noise = value + (int)vibe_rand_below(random, 20) - 10;
+
+  if (value_plus_noise < 0) { value_plus_noise = 0; }
+  if (value_plus_noise > 255) { value_plus_noise = 255; }
+
+  return((uint8_t)value_plus_noise);
+}
+
+/* Distances (in bytes) between the 2x2 blocks and the samples of the historyBuffer of a YUV 4:2:0 model. */
+static void setBufferStrides_8u_420(vibeModel_Sequential_t *model, uint32_t numberOfTests)
+{
+  if (model->bufferLayout == VIBE_BUFFER_SAMPLE_MAJOR) {
+    model->bufferPixelStride  = 6;
+    model->bufferSampleStride = 6 * (model->width / 2) * (model->height / 2);
+  }
+  else {
+    model->bufferPixelStride  = 6 * numberOfTests;
+    model->bufferSampleStride = 6;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Allocates and initializes a YUV 4:2:0 model from an I420 or NV12 image
+// -----------------------------------------------------------------------------
+static void allocInit_8u_420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint32_t chromaFormat,
+  const uint32_t width,
+  const uint32_t height
+) {
+  /* Some basic checks: the 2x2 blocks cover the image. */
+  assert((image_data != NULL) && (model != NULL));
+  assert((width > 0) && (height > 0));
+  assert((width % 2 == 0) && (height % 2 == 0));
+  assert((model->sampleBlockSize == 1) && (model->sampleFormat == VIBE_SAMPLE_RGB888));
+
+  /* Finish model alloc - parameters values cannot be changed anymore. */
+  model->width = width;
+  model->height = height;
+  model->sampleSize = 1;
+  model->inputChannels = 1;
+  model->imagePixelStride = 1;
+  model->chromaFormat = chromaFormat;
+  setNumberOfHistoryImages(model);
+
+  assert((chromaFormat == VIBE_CHROMA_NV12) || (inputStep(model) % 2 == 0));
+
+  /* Memory layout: distances (in bytes) between the 2x2 blocks and the samples of the historyBuffer. */
+  uint32_t numberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
+
+  setBufferStrides_8u_420(model, numberOfTests);
+
+  /* Creates the historyImage structure: luma and chroma of the input image. */
+  size_t planeSize = planeSize_8u_420(model);
+  size_t step = inputStep(model);
+
+  model->historyImage = (uint8_t*)allocHistory(model, model->numberOfHistoryImages * planeSize);
+  assert(model->historyImage != NULL);
+
+  for (uint32_t y = 0; y < height; ++y)
+    memcpy(model->historyImage + y * width, image_data + y * step, width);
+
+  for (uint32_t y = 0; y < height; y += 2) {
+    uint8_t *chroma = model->historyImage + width * height + (y / 2) * width;
+    const uint8_t *uv = inputChroma_8u_420(model, image_data, 0, y, width, chroma);
+
+    if (uv != chroma)
+      memcpy(chroma, uv, width);
+  }
+
+  for (uint32_t i = 1; i < model->numberOfHistoryImages; ++i)
+    memcpy(model->historyImage + i * planeSize, model->historyImage, planeSize);
+
+  /* Now creates and fills the history buffer, block by block. */
+  model->historyBuffer = (uint8_t*)allocHistory(model, planeSize * ((numberOfTests > 0) ? numberOfTests : 1));
+  assert(model->historyBuffer != NULL);
+
+  for (uint32_t y = 0; y < height; y += 2) {
+    for (uint32_t x = 0; x < width; x += 2) {
+      const uint8_t *luma = model->historyImage + y * width + x;
+      const uint8_t *uv = model->historyImage + width * height + (y / 2) * width + x;
+      uint8_t block[6] = { luma[0], luma[1], luma[width], luma[width + 1], uv[0], uv[1] };
+
+      for (uint32_t i = 0; i < numberOfTests; ++i) {
+        uint8_t *sample = bufferSample_8u_420(model, x, y) + i * model->bufferSampleStride;
+
+        for (int c = 0; c < 6; ++c)
+          sample[c] = noisySample_8u_420(&model->random, block[c]);
+      }
+    }
+  }
+
+  /* Fills the buffers with random values. */
+  allocTables(model);
+}
+
+// -----------------------------------------------------------------------------
+// Allocates and initializes a YUV 4:2:0 model structure from an I420 image
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_AllocInit_8u_I420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+) {
+  allocInit_8u_420(model, image_data, VIBE_CHROMA_I420, width, height);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Allocates and initializes a YUV 4:2:0 model structure from an NV12 image
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_AllocInit_8u_NV12(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+) {
+  allocInit_8u_420(model, image_data, VIBE_CHROMA_NV12, width, height);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of the pixels [x, x + numberOfPixels) of row y of a YUV 4:2:0
+// model (x and numberOfPixels even; luma, chroma and segmentation_map point
+// at pixel (x, y))
+// -----------------------------------------------------------------------------
+static void segmentationRun_8u_420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *luma,
+  const uint8_t *chroma,
+  uint8_t *segmentation_map,
+  uint32_t x,
+  uint32_t y,
+  uint32_t numberOfPixels
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+  uint32_t height = model->height;
+  uint32_t first = y * width + x;
+  size_t planeSize = planeSize_8u_420(model);
+  size_t chromaOffset = width * height + (y / 2) * width + x;
+
+  /* From now on, the pixels are numbered from the first pixel of the run. */
+  uint8_t *historyImage = model->historyImage + first;
+  uint8_t *historyChroma = model->historyImage + chromaOffset;
+  uint8_t *swappingImage = model->historyImage + model->lastHistoryImageSwapped * planeSize;
+
+  /* A single sweep over the historyImages, as for the other models. */
+  uint32_t *tailIndex = model->tailIndex + first;
+  uint32_t numberOfTails = model->kernels->historyCount_8u_420(
+    luma, chroma, historyImage, historyChroma, planeSize, model->numberOfHistoryImages,
+    numberOfPixels, model->matchingNumber, model->matchingThreshold, segmentation_map, tailIndex
+  );
+
+  /* Now, we move in the buffer and leave the historyImages. */
+  uint32_t numberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
+  int32_t threshold = vibe_threshold_8u_C3R(model->matchingThreshold);
+  VIBE_COUNT(vibeTailCounts_t tailCounts = { 0 });
+
+  for (uint32_t t = 0; t < numberOfTails; ++t) {
+    uint32_t index = tailIndex[t];
+    const uint8_t *uv = chroma + (index & ~1u);
+
+    uint8_t *swappingLuma = swappingImage + first + index;
+    uint8_t *swappingChroma = swappingImage + chromaOffset + (index & ~1u);
+
+    /* Luma of the pixel in the samples of its block, then the chroma. */
+    uint8_t *sample = bufferSample_8u_420(model, x + index, y) + 2 * (y & 1) + ((x + index) & 1);
+    uint8_t *chromaSample = bufferSample_8u_420(model, x + index, y) + 4;
+
+    for (uint32_t i = numberOfTests; i > 0; --i, sample += model->bufferSampleStride, chromaSample += model->bufferSampleStride) {
+      VIBE_COUNT(++tailCounts.testedSamples);
+
+      if (abs_uint(luma[index] - sample[0]) + abs_uint(uv[0] - chromaSample[0]) + abs_uint(uv[1] - chromaSample[1]) <= threshold) {
+        --segmentation_map[index];
+
+        /* Swaping: Putting found value in history image buffer. */
+        VIBE_COUNT(++tailCounts.swappedSamples);
+        uint8_t temp = swappingLuma[0];
+        swappingLuma[0] = sample[0];
+        sample[0] = temp;
+
+        for (int c = 0; c < 2; ++c) {
+          temp = swappingChroma[c];
+          swappingChroma[c] = chromaSample[c];
+          chromaSample[c] = temp;
+        }
+
+        /* Exit inner loop. */
+        if (segmentation_map[index] <= 0) break;
+      }
+    } // for
+
+    if (segmentation_map[index] > 0) segmentation_map[index] = COLOR_FOREGROUND;
+  } // for
+
+  VIBE_COUNT(countSegmentation(model, numberOfPixels, numberOfTails, &tailCounts));
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a band of a YUV 4:2:0 model, row by row and by runs of at
+// most PACK_CHUNK_SIZE pixels (the chroma of an I420 run is interleaved on
+// the stack)
+// -----------------------------------------------------------------------------
+static void segmentationTask_8u_420(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  vibeModel_Sequential_t *model = job->model;
+  uint32_t width = model->width;
+  size_t step = inputStep(model);
+
+  /* The bands start on an even row: the 2x2 blocks are not shared between bands. */
+  uint32_t firstRow = 2 * bandRow(model->height / 2, job->numberOfBands, band);
+  uint32_t lastRow = 2 * bandRow(model->height / 2, job->numberOfBands, band + 1);
+  uint8_t buffer[PACK_CHUNK_SIZE];
+
+  for (uint32_t y = firstRow; y < lastRow; ++y) {
+    uint8_t *map = job->map + y * width;
+    const vibeSpan_t *spans;
+    uint32_t numberOfSpans = rowSpans(model, y, &spans);
+    uint32_t labeled = 0;
+
+    /* The spans of the region of interest are made of whole 2x2 blocks. */
+    for (uint32_t s = 0; s < numberOfSpans; ++s) {
+      uint32_t last = (spans[s].last < width) ? spans[s].last : width;
+
+      memset(map + labeled, model->roiLabel, spans[s].first - labeled);
+
+      for (uint32_t x = spans[s].first; x < last; x += PACK_CHUNK_SIZE) {
+        uint32_t size = (last - x < PACK_CHUNK_SIZE) ? last - x : PACK_CHUNK_SIZE;
+        const uint8_t *chroma = inputChroma_8u_420(model, job->image_data, x, y, size, buffer);
+
+        segmentationRun_8u_420(model, job->image_data + y * step + x, chroma, map + x, x, y, size);
+      }
+
+      labeled = last;
+    }
+
+    memset(map + labeled, model->roiLabel, width - labeled);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a YUV 4:2:0 model
+// -----------------------------------------------------------------------------
+static void segmentation_8u_420(
   vibeModel_Sequential_t *model,
   const uint8_t *image_data,
-  uint8_t *updating_mask
+  uint8_t *segmentation_map,
+  uint32_t chromaFormat
 ) {
-  /* Basic checks . */
-  assert((image_data != NULL) && (model != NULL) && (updating_mask != NULL));
+  /* Basic checks. */
+  assert((image_data != NULL) && (model != NULL) && (segmentation_map != NULL));
   assert((model->width > 0) && (model->height > 0));
-  assert(model->historyBuffer != NULL);
+  assert((model->historyBuffer != NULL) && (model->chromaFormat == chromaFormat));
   assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
 
+  /* For swapping. */
+  model->lastHistoryImageSwapped = (model->lastHistoryImageSwapped + 1) % model->numberOfHistoryImages;
+
+  /* The bands are pairs of rows segmented independently of each other: they can run in parallel. */
+  vibeBandJob_t job = { model, image_data, segmentation_map, numberOfBands(model, model->height / 2) };
+  runBands(model, segmentationTask_8u_420, &job);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a YUV 4:2:0 model from an I420 image
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Segmentation_8u_I420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+) {
+  segmentation_8u_420(model, image_data, segmentation_map, VIBE_CHROMA_I420);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation of a YUV 4:2:0 model from an NV12 image
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Segmentation_8u_NV12(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+) {
+  segmentation_8u_420(model, image_data, segmentation_map, VIBE_CHROMA_NV12);
+
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Update of the rows [firstRow, lastRow) of a YUV 4:2:0 model (the frame border excepted)
+// -----------------------------------------------------------------------------
+static void updateRows_8u_420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask,
+  uint32_t firstRow,
+  uint32_t lastRow,
+  vibeRandom_t *random
+) {
   /* Some variables. */
   uint32_t width = model->width;
+
+  /* Updating. */
+  const uint32_t *jump = model->jump;
+  const int *neighbor = model->neighbor;
+  const uint32_t *position = model->position;
+
+  uint32_t shift, indX;
+
+  VIBE_COUNT(uint64_t updates = 0);
+
+  for (uint32_t y = firstRow; y < lastRow; ++y) {
+    const vibeSpan_t *spans;
+    uint32_t numberOfSpans = rowSpans(model, y, &spans);
+
+    for (uint32_t s = 0; s < numberOfSpans; ++s) {
+      /* The span, the first and last columns excepted. */
+      uint32_t first = (spans[s].first > 1) ? spans[s].first : 1;
+      uint32_t last = (spans[s].last < width - 1) ? spans[s].last : width - 1;
+
+      shift = vibe_rand_below(random, width);
+      indX = first - 1 + jump[shift]; // index_jump should never be zero (> 1).
+
+      while (indX < last) {
+        int index = indX + y * width;
+
+        if (updating_mask[index] == COLOR_BACKGROUND) {
+          VIBE_COUNT(++updates);
+
+          /* In-place substitution, in the pixel and in its neighbor (dx + dy * width, with |dx| <= 1 < width - 1). */
+          uint8_t yuv[3];
+          int dy = (neighbor[shift] > 1) - (neighbor[shift] < -1);
+          int dx = neighbor[shift] - dy * (int)width;
+
+          inputPixel_8u_420(model, image_data, indX, y, yuv);
+
+          setSample_8u_420(model, indX, y, position[shift], yuv);
+          setSample_8u_420(model, indX + dx, y + dy, position[shift], yuv);
+        }
+
+        ++shift;
+        indX += jump[shift];
+      }
+    }
+  }
+
+  VIBE_COUNT(countUpdate(model, updates, updates));
+}
+
+/* Rows [firstRow, lastRow) of a band of the update: the bands start on an even
+ * row, so that the inner rows of two bands never write in a same 2x2 block.
+ */
+static inline void updateBand_8u_420(const vibeModel_Sequential_t *model, uint32_t numberOfBands, uint32_t band, uint32_t *firstRow, uint32_t *lastRow)
+{
   uint32_t height = model->height;
 
-  uint8_t *historyImage = model->historyImage;
-  uint8_t *historyBuffer = model->historyBuffer;
+  *firstRow = 2 * bandRow(height / 2, numberOfBands, band);
+  *lastRow = 2 * bandRow(height / 2, numberOfBands, band + 1);
+
+  if (*firstRow < 1)
+    *firstRow = 1;
+
+  if (*lastRow > height - 1)
+    *lastRow = height - 1;
+}
+
+// -----------------------------------------------------------------------------
+static void updateTask_8u_420(void *context, uint32_t band)
+{
+  vibeBandJob_t *job = (vibeBandJob_t *)context;
+  uint32_t firstRow, lastRow;
+
+  updateBand_8u_420(job->model, job->numberOfBands, band, &firstRow, &lastRow);
+
+  /* The first and last rows of the band may write in the neighboring bands: they are left for later. */
+  if (lastRow - firstRow > 2)
+    updateRows_8u_420(job->model, job->image_data, job->map, firstRow + 1, lastRow - 1, &job->model->bandRandom[band]);
+}
+
+// -----------------------------------------------------------------------------
+// Update of the first and last rows of the bands, one band after the other
+// -----------------------------------------------------------------------------
+static void updateBandEdges_8u_420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask,
+  uint32_t numberOfBands
+) {
+  for (uint32_t band = 0; band < numberOfBands; ++band) {
+    uint32_t firstRow, lastRow;
+
+    updateBand_8u_420(model, numberOfBands, band, &firstRow, &lastRow);
+
+    updateRows_8u_420(model, image_data, updating_mask, firstRow, firstRow + 1, &model->bandRandom[band]);
+
+    if (lastRow - 1 > firstRow)
+      updateRows_8u_420(model, image_data, updating_mask, lastRow - 1, lastRow, &model->bandRandom[band]);
+  }
+}
 
-  /* Some utility variable. */
-  int numberOfTests = (model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES);
+// -----------------------------------------------------------------------------
+// Update of the border of the frame: first and last rows, first and last
+// columns, and the first pixel
+// -----------------------------------------------------------------------------
+static void updateBorders_8u_420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask
+) {
+  /* Some variables. */
+  uint32_t width = model->width;
+  uint32_t height = model->height;
 
   /* Updating. */
-  uint32_t *jump = model->jump;
-  int *neighbor = model->neighbor;
-  uint32_t *position = model->position;
+  const uint32_t *jump = model->jump;
+  const uint32_t *position = model->position;
 
-  /* All the frame, except the border. */
   uint32_t shift, indX, indY;
-  int x, y;
+  VIBE_COUNT(uint64_t updates = 0);
+  uint8_t yuv[3];
 
-  for (y = 1; y < height - 1; ++y) {
-    shift = rand() % width;
+  /* First and last rows. */
+  for (uint32_t y = 0; y < height; y += height - 1) {
+    shift = vibe_rand_below(&model->random, width);
     indX = jump[shift]; // index_jump should never be zero (> 1).
 
-    while (indX < width - 1) {
-      int index = indX + y * width;
-
-      if (updating_mask[index] == COLOR_BACKGROUND) {
-        /* In-place substitution. */
-        uint8_t value = image_data[index];
-        int index_neighbor = index + neighbor[shift];
+    while (indX <= width - 1) {
+      if (inROI(model, indX + y * width) && (updating_mask[indX + y * width] == COLOR_BACKGROUND)) {
+        VIBE_COUNT(++updates);
 
-        if (position[shift] < NUMBER_OF_HISTORY_IMAGES) {
-          historyImage[index + position[shift] * width * height] = value;
-          historyImage[index_neighbor + position[shift] * width * height] = value;
-        }
-        else {
-          int pos = position[shift] - NUMBER_OF_HISTORY_IMAGES;
-          historyBuffer[index * numberOfTests + pos] = value;
-          historyBuffer[index_neighbor * numberOfTests + pos] = value;
-        }
+        inputPixel_8u_420(model, image_data, indX, y, yuv);
+        setSample_8u_420(model, indX, y, position[shift], yuv);
       }
 
       ++shift;
@@ -448,516 +5118,829 @@ int32_t libvibeModel_Sequential_Update_8u_C1R(
     }
   }
 
-  /* First row. */
-  y = 0;
-  shift = rand() % width;
-  indX = jump[shift]; // index_jump should never be zero (> 1).
+  /* First and last columns. */
+  for (uint32_t x = 0; x < width; x += width - 1) {
+    shift = vibe_rand_below(&model->random, height);
+    indY = jump[shift]; // index_jump should never be zero (> 1).
+
+    while (indY <= height - 1) {
+      if (inROI(model, x + indY * width) && (updating_mask[x + indY * width] == COLOR_BACKGROUND)) {
+        VIBE_COUNT(++updates);
+
+        inputPixel_8u_420(model, image_data, x, indY, yuv);
+        setSample_8u_420(model, x, indY, position[shift], yuv);
+      }
+
+      ++shift;
+      indY += jump[shift];
+    }
+  }
+
+  /* The first pixel! */
+  if (vibe_rand_below(&model->random, model->updateFactor) == 0) {
+    if (inROI(model, 0) && (updating_mask[0] == COLOR_BACKGROUND)) {
+      VIBE_COUNT(++updates);
+
+      int position = vibe_rand_below(&model->random, model->numberOfSamples);
+
+      inputPixel_8u_420(model, image_data, 0, 0, yuv);
+      setSample_8u_420(model, 0, 0, position, yuv);
+    }
+  }
+
+  VIBE_COUNT(countUpdate(model, updates, 0));
+}
+
+// ----------------------------------------------------------------------------
+// Update a YUV 4:2:0 model
+// ----------------------------------------------------------------------------
+static void update_8u_420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask,
+  uint32_t chromaFormat
+) {
+  /* Basic checks. */
+  assert((image_data != NULL) && (model != NULL) && (updating_mask != NULL));
+  assert((model->width > 0) && (model->height > 0));
+  assert((model->historyBuffer != NULL) && (model->chromaFormat == chromaFormat));
+  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  /* All the frame, except the border. */
+  uint32_t height = model->height;
+
+  if ((model->numberOfThreads > 1) && (height > 2)) {
+    /* Each band draws from its own random stream, seeded in the band order. */
+    vibeBandJob_t job = { model, image_data, (uint8_t *)updating_mask, numberOfBands(model, height / 2) };
+
+    seedBands(model, job.numberOfBands);
+
+    runBands(model, updateTask_8u_420, &job);
+
+    /* Then, one band after the other, the rows next to the other bands. */
+    updateBandEdges_8u_420(model, image_data, updating_mask, job.numberOfBands);
+  }
+  else
+    updateRows_8u_420(model, image_data, updating_mask, 1, height - 1, &model->random);
+
+  updateBorders_8u_420(model, image_data, updating_mask);
+}
+
+// ----------------------------------------------------------------------------
+// Update a YUV 4:2:0 model from an I420 image
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Update_8u_I420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *updating_mask
+) {
+  update_8u_420(model, image_data, updating_mask, VIBE_CHROMA_I420);
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// Update a YUV 4:2:0 model from an NV12 image
+// ----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Update_8u_NV12(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *updating_mask
+) {
+  update_8u_420(model, image_data, updating_mask, VIBE_CHROMA_NV12);
+
+  return(0);
+}
+
+// ----------------------------------------------------------------------------
+// ----------------------------- Batches of models ----------------------------
+// ----------------------------------------------------------------------------
+//
+// A batch runs the Process function of several models (e.g. one per camera)
+// on a single pool of threads. The bands of all the models are the tasks of
+// a single job: the threads take the next task as soon as they are done with
+// the previous one, the bands of the largest models first, so that models of
+// different sizes keep all the threads busy. The edges of the bands and the
+// border of the frame are then updated model by model, again in parallel.
+// Every model uses its own bands and random streams: the results are those of
+// its Process function, whatever the batch.
+
+struct vibeBatch
+{
+  vibeThreadPool_t *pool;
+
+  /* Jobs of the models of the current batch (largest first) and first task of each. */
+  uint32_t capacity;
+  uint32_t numberOfModels;
+  vibeBandJob_t *jobs;
+  uint32_t *firstTask;
+};
+
+// -----------------------------------------------------------------------------
+// Creates a batch
+// -----------------------------------------------------------------------------
+vibeBatch_t *libvibeModel_Sequential_NewBatch(const uint32_t numberOfThreads)
+{
+  assert(numberOfThreads > 0);
+
+  vibeBatch_t *batch = (vibeBatch_t *)calloc(1, sizeof(*batch));
+  assert(batch != NULL);
+
+  batch->pool = libvibeThreadPool_New(numberOfThreads);
+
+  return(batch);
+}
+
+// -----------------------------------------------------------------------------
+// Frees a batch
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_FreeBatch(vibeBatch_t *batch)
+{
+  if (batch == NULL)
+    return(-1);
+
+  libvibeThreadPool_Free(batch->pool);
+  free(batch->jobs);
+  free(batch->firstTask);
+  free(batch);
+
+  return(0);
+}
+
+/* Process steps of a model: the 8u C1R, C3R and C4R models have a Process function. */
+static const vibeProcessSteps_t *processSteps(const vibeModel_Sequential_t *model)
+{
+  assert((model->sampleSize == 1) && (model->chromaFormat == 0));
+
+  if (model->inputChannels == 1)
+    return(&processSteps_8u_C1R);
+
+  assert((model->inputChannels == 3) || (model->inputChannels == 4));
+
+  return(&processSteps_8u_C3R);
+}
+
+// -----------------------------------------------------------------------------
+static void batchBandTask(void *context, uint32_t task)
+{
+  vibeBatch_t *batch = (vibeBatch_t *)context;
+
+  /* The model of the task: the last one whose first task is not after it. */
+  uint32_t low = 0;
+  uint32_t high = batch->numberOfModels;
+
+  while (high - low > 1) {
+    uint32_t middle = (low + high) / 2;
+
+    if (batch->firstTask[middle] <= task)
+      low = middle;
+    else
+      high = middle;
+  }
+
+  processBandTask(&batch->jobs[low], task - batch->firstTask[low]);
+}
+
+// -----------------------------------------------------------------------------
+static void batchBlocksTask(void *context, uint32_t model)
+{
+  vibeBandJob_t *job = &((vibeBatch_t *)context)->jobs[model];
+
+  if (hasStaticBlocks(job->model))
+    checkBlocks(job->model, job->image_data, 0, numberOfBlocks(job->model->height));
+}
+
+// -----------------------------------------------------------------------------
+static void batchEndTask(void *context, uint32_t model)
+{
+  vibeBandJob_t *job = &((vibeBatch_t *)context)->jobs[model];
+
+  endProcess(job);
+
+  if (hasStaticBlocks(job->model))
+    recordBlocks(job->model, job->map, 0, 0, numberOfBlocks(job->model->height));
+}
+
+// -----------------------------------------------------------------------------
+// Segmentation and update of several models in a single pass
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_ProcessBatch(
+  vibeBatch_t *batch,
+  vibeModel_Sequential_t **models,
+  const uint8_t **images,
+  uint8_t **segmentation_maps,
+  const uint32_t numberOfModels
+) {
+  /* Basic checks. */
+  assert((batch != NULL) && (models != NULL) && (images != NULL) && (segmentation_maps != NULL));
+
+  if (numberOfModels == 0)
+    return(0);
+
+  if (numberOfModels > batch->capacity) {
+    free(batch->jobs);
+    free(batch->firstTask);
+
+    batch->jobs = (vibeBandJob_t *)malloc(numberOfModels * sizeof(*(batch->jobs)));
+    batch->firstTask = (uint32_t *)malloc(numberOfModels * sizeof(*(batch->firstTask)));
+    assert((batch->jobs != NULL) && (batch->firstTask != NULL));
+
+    batch->capacity = numberOfModels;
+  }
+
+  batch->numberOfModels = numberOfModels;
+
+  /* The models, largest first (insertion sort, stable). */
+  int staticBlocks = 0;
+
+  for (uint32_t i = 0; i < numberOfModels; ++i) {
+    vibeModel_Sequential_t *model = models[i];
+    uint64_t size = (uint64_t)model->width * model->height;
+    uint32_t j = i;
+
+    assert((images[i] != NULL) && (segmentation_maps[i] != NULL));
+    assert((model->historyBuffer != NULL) && (model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+    while ((j > 0) && ((uint64_t)batch->jobs[j - 1].model->width * batch->jobs[j - 1].model->height < size)) {
+      batch->jobs[j] = batch->jobs[j - 1];
+      --j;
+    }
 
-  while (indX <= width - 1) {
-    int index = indX + y * width;
+    /* A model must not appear twice in a batch. */
+    for (uint32_t k = 0; k < i; ++k)
+      assert(models[k] != model);
 
-    if (updating_mask[index] == COLOR_BACKGROUND) {
-      if (position[shift] < NUMBER_OF_HISTORY_IMAGES)
-        historyImage[index + position[shift] * width * height] = image_data[index];
-      else {
-        int pos = position[shift] - NUMBER_OF_HISTORY_IMAGES;
-        historyBuffer[index * numberOfTests + pos] = image_data[index];
-      }
+    beginProcess(model, images[i], segmentation_maps[i], processSteps(model), &batch->jobs[j]);
+
+    if (hasStaticBlocks(model)) {
+      allocBlocks(model);
+      staticBlocks = 1;
     }
+  }
 
-    ++shift; 
-    indX += jump[shift];
+  /* The static blocks of every model, then all the bands of all the models,
+   * then the edges and the border (and the static blocks) of each model.
+   */
+  if (staticBlocks)
+    libvibeThreadPool_Run(batch->pool, batchBlocksTask, batch, numberOfModels);
+
+  uint32_t numberOfTasks = 0;
+
+  for (uint32_t i = 0; i < numberOfModels; ++i) {
+    batch->firstTask[i] = numberOfTasks;
+    numberOfTasks += batch->jobs[i].numberOfBands;
   }
 
-  /* Last row. */
-  y = height - 1;
-  shift = rand() % width;
-  indX = jump[shift]; // index_jump should never be zero (> 1).
+  libvibeThreadPool_Run(batch->pool, batchBandTask, batch, numberOfTasks);
+  libvibeThreadPool_Run(batch->pool, batchEndTask, batch, numberOfModels);
 
-  while (indX <= width - 1) {
-    int index = indX + y * width;
+  return(0);
+}
 
-    if (updating_mask[index] == COLOR_BACKGROUND) {
-      if (position[shift] < NUMBER_OF_HISTORY_IMAGES)
-        historyImage[index + position[shift] * width * height] = image_data[index];
-      else {
-        int pos = position[shift] - NUMBER_OF_HISTORY_IMAGES;
-        historyBuffer[index * numberOfTests + pos] = image_data[index];
-      }
-    }
+// ----------------------------------------------------------------------------
+// ---------------------------- Batches of frames -----------------------------
+// ----------------------------------------------------------------------------
+//
+// When the frames are known in advance (offline jobs), the frames of a batch
+// are processed strip by strip: a strip of rows of the model is segmented and
+// updated for every frame before the next strip, so that the model goes
+// through the caches once per batch instead of once per frame.
+//
+// A frame may only see the samples of a row once the previous frame wrote all
+// its values in that row: the update of a row writes in the rows above and
+// below (neighbor diffusion), and the update of the border of the frame
+// (first and last rows and columns) comes after that of the inner rows. Each
+// frame therefore keeps three fronts: its segmented rows, its updated inner
+// rows (up to the last segmented row but one), and the rows whose border is
+// updated (up to the last updated row but one, whose neighbors are all
+// updated). The next frame is segmented up to the last of these fronts, so
+// that every frame runs two rows behind the previous one.
+//
+// The random values are those of the Process functions. The inner rows of a
+// frame draw one value per span of the region of interest whatever the input:
+// the values of the border (and the stream of the next frame) are known as
+// soon as the first pixel of the frame is segmented, and the walks along the
+// first and last columns are then split by rows.
+// ----------------------------------------------------------------------------
+typedef struct
+{
+  const uint8_t *image_data;
+  uint8_t *map;
+  vibeRandom_t random;     /* Stream of the inner rows. */
+  uint32_t swapped;        /* lastHistoryImageSwapped of the frame. */
+  uint32_t segmented;      /* Rows [0, segmented) are segmented, */
+  uint32_t updated;        /* inner rows [1, updated) are updated, */
+  uint32_t bordered;       /* and the border of rows [0, bordered) is updated. */
+  int drawn;               /* Whether the values of the border are drawn. */
+  uint32_t rowShift[2];    /* Walks along the first and last rows, */
+  uint32_t columnShift[2]; /* and along the first and last columns (next pixel at row columnRow). */
+  uint32_t columnRow[2];
+  int32_t firstPosition;   /* Sample of the first pixel to replace, or -1. */
+} vibeFrameJob_t;
+
+/* Draws the values of the border of a frame, as updateBorders does after the
+ * inner rows; "random" becomes the stream of the next frame.
+ */
+static void drawBorders(vibeModel_Sequential_t *model, vibeFrameJob_t *frame, vibeRandom_t *random)
+{
+  uint32_t height = model->height;
+  const vibeSpan_t *spans;
 
-    ++shift;
-    indX += jump[shift];
+  /* The values of the inner rows not updated yet: one per span. */
+  *random = frame->random;
+
+  for (uint32_t y = frame->updated; y < height - 1; ++y) {
+    for (uint32_t s = rowSpans(model, y, &spans); s > 0; --s)
+      vibe_rand(random);
   }
 
-  /* First column. */
-  x = 0;
-  shift = rand() % height;
-  indY = jump[shift]; // index_jump should never be zero (> 1).
+  frame->rowShift[0] = vibe_rand_below(random, model->width);
+  frame->rowShift[1] = vibe_rand_below(random, model->width);
 
-  while (indY <= height - 1) {
-    int index = x + indY * width;
+  for (int c = 0; c < 2; ++c) {
+    frame->columnShift[c] = vibe_rand_below(random, height);
+    frame->columnRow[c] = model->jump[frame->columnShift[c]];
+  }
 
-    if (updating_mask[index] == COLOR_BACKGROUND) {
-      if (position[shift] < NUMBER_OF_HISTORY_IMAGES)
-        historyImage[index + position[shift] * width * height] = image_data[index];
-      else {
-        int pos = position[shift] - NUMBER_OF_HISTORY_IMAGES;
-        historyBuffer[index * numberOfTests + pos] = image_data[index];
-      }
-    }
+  frame->firstPosition = -1;
 
-    ++shift;
-    indY += jump[shift];
+  if (vibe_rand_below(random, model->updateFactor) == 0) {
+    if (inROI(model, 0) && isBackground(frame->map, 0, 0))
+      frame->firstPosition = (int32_t)vibe_rand_below(random, model->numberOfSamples);
   }
 
-  /* Last column. */
-  x = width - 1;
-  shift = rand() % height;
-  indY = jump[shift]; // index_jump should never be zero (> 1).
+  frame->drawn = 1;
+}
 
-  while (indY <= height - 1) {
-    int index = x + indY * width;
+/* Update of the border of the rows [bordered, lastRow) of a frame. */
+static void updateBorderRows(vibeModel_Sequential_t *model, const vibeProcessSteps_t *steps, vibeFrameJob_t *frame, uint32_t lastRow)
+{
+  uint32_t width = model->width;
+  uint32_t height = model->height;
 
-    if (updating_mask[index] == COLOR_BACKGROUND) {
-      if (position[shift] < NUMBER_OF_HISTORY_IMAGES )
-        historyImage[index + position[shift] * width * height] = image_data[index];
-      else {
-        int pos = position[shift] - NUMBER_OF_HISTORY_IMAGES;
-        historyBuffer[index * numberOfTests + pos] = image_data[index];
-      }
-    }
+  const uint32_t *jump = model->jump;
+  const uint32_t *position = model->position;
 
-    ++shift; 
-    indY += jump[shift];
-  }
+  VIBE_COUNT(uint64_t updates = 0);
 
-  /* The first pixel! */
-  if (rand() % model->updateFactor == 0) {
-    if (updating_mask[0] == 0) {
-      int position = rand() % model->numberOfSamples;
+  /* First and last rows. */
+  for (int r = 0; r < 2; ++r) {
+    uint32_t y = (r == 0) ? 0 : height - 1;
 
-      if (position < NUMBER_OF_HISTORY_IMAGES)
-        historyImage[position * width * height] = image_data[0];
-      else {
-        int pos = position - NUMBER_OF_HISTORY_IMAGES;
-        historyBuffer[pos] =  image_data[0];
+    if ((y < frame->bordered) || (y >= lastRow))
+      continue;
+
+    uint32_t shift = frame->rowShift[r];
+    uint32_t indX = jump[shift];
+
+    while (indX <= width - 1) {
+      uint32_t index = indX + y * width;
+
+      if (inROI(model, index) && isBackground(frame->map, 0, index)) {
+        VIBE_COUNT(++updates);
+        steps->sample(model, frame->image_data, index, position[shift]);
       }
+
+      ++shift;
+      indX += jump[shift];
     }
   }
 
-  return(0);
-}
+  /* First and last columns, up to lastRow. */
+  for (int c = 0; c < 2; ++c) {
+    uint32_t x = (c == 0) ? 0 : width - 1;
+    uint32_t shift = frame->columnShift[c];
+    uint32_t indY = frame->columnRow[c];
 
-// ----------------------------------------------------------------------------
-// -------------------------- The same for C3R models -------------------------
-// ----------------------------------------------------------------------------
+    while ((indY <= height - 1) && (indY < lastRow)) {
+      uint32_t index = x + indY * width;
 
-// -----------------------------------------------------------------------------
-// Allocates and initializes a C3R model structure
-// -----------------------------------------------------------------------------
-int32_t libvibeModel_Sequential_AllocInit_8u_C3R(
-  vibeModel_Sequential_t *model,
-  const uint8_t *image_data,
-  const uint32_t width,
-  const uint32_t height
-) {
-  /* Some basic checks. */
-  assert((image_data != NULL) && (model != NULL));
-  assert((width > 0) && (height > 0));
+      if (inROI(model, index) && isBackground(frame->map, 0, index)) {
+        VIBE_COUNT(++updates);
+        steps->sample(model, frame->image_data, index, position[shift]);
+      }
 
-  /* Finish model alloc - parameters values cannot be changed anymore. */
-  model->width = width;
-  model->height = height;
+      ++shift;
+      indY += jump[shift];
+    }
 
-  /* Creates the historyImage structure. */
-  model->historyImage = NULL;
-  model->historyImage = (uint8_t*)malloc(NUMBER_OF_HISTORY_IMAGES * (3 * width) * height * sizeof(uint8_t));
-  assert(model->historyImage != NULL);
+    frame->columnShift[c] = shift;
+    frame->columnRow[c] = indY;
+  }
 
-  for (int i = 0; i < NUMBER_OF_HISTORY_IMAGES; ++i) {
-    for (int index = (3 * width) * height - 1; index >= 0; --index)
-      model->historyImage[i * (3 * width) * height + index] = image_data[index];
+  /* The first pixel! */
+  if ((frame->bordered == 0) && (frame->firstPosition >= 0)) {
+    VIBE_COUNT(++updates);
+    steps->sample(model, frame->image_data, 0, (uint32_t)frame->firstPosition);
   }
 
-  assert(model->historyImage != NULL);
+  frame->bordered = lastRow;
 
-  /* Creates the history buffer. */
-  model->historyBuffer = (uint8_t *)malloc((3 * width) * height * (model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES) * sizeof(uint8_t));
-  assert(model->historyBuffer != NULL);
+  VIBE_COUNT(countUpdate(model, updates, 0));
+}
 
-  /* Fills the history buffer */
-  for (int index = 0; index <  width * height; index++) {
-    uint8_t value_C1 = image_data[3*index];
-    uint8_t value_C2 = image_data[3*index + 1];
-    uint8_t value_C3 = image_data[3*index + 2];
-
-    for (int x = 0; x < model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES; ++x) {
-      /* Adds noise on the value */
-      int value_plus_noise_C1 = value_C1 + rand() % 20 - 10;
-      int value_plus_noise_C2 = value_C2 + rand() % 20 - 10;
-      int value_plus_noise_C3 = value_C3 + rand() % 20 - 10;
-    
-      /* Limits the value + noise to the [0,255] range */
-      if (value_plus_noise_C1 < 0)   { value_plus_noise_C1 = 0; }
-      if (value_plus_noise_C1 > 255) { value_plus_noise_C1 = 255; }
-      if (value_plus_noise_C2 < 0)   { value_plus_noise_C2 = 0; }
-      if (value_plus_noise_C2 > 255) { value_plus_noise_C2 = 255; }
-      if (value_plus_noise_C3 < 0)   { value_plus_noise_C3 = 0; }
-      if (value_plus_noise_C3 > 255) { value_plus_noise_C3 = 255; }
+/* Segmentation of a frame up to lastRow, and update of its rows as far as possible. */
+static void advanceFrame(vibeModel_Sequential_t *model, const vibeProcessSteps_t *steps, vibeFrameJob_t *frame, vibeRandom_t *next, uint32_t lastRow)
+{
+  uint32_t height = model->height;
 
-      model->historyBuffer[index * 3 * (model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES) + 3*x]     = value_plus_noise_C1;
-      model->historyBuffer[index * 3 * (model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES) + 3*x + 1] = value_plus_noise_C2;
-      model->historyBuffer[index * 3 * (model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES) + 3*x + 2] = value_plus_noise_C3;
-    }
-  }
-    
-  /* Fills the buffers with random values. */
-  int size = (width > height) ? 2 * width + 1 : 2 * height + 1;
+  if (lastRow <= frame->segmented)
+    return;
 
-  model->jump = (uint32_t*)malloc(size * sizeof(*(model->jump)));
-  assert(model->jump != NULL);
+  model->lastHistoryImageSwapped = frame->swapped;
 
-  model->neighbor = (int*)malloc(size * sizeof(*(model->neighbor)));
-  assert(model->neighbor != NULL);
+  steps->rows(model, frame->image_data, frame->map, frame->segmented, lastRow, frame->updated, height - 1, &frame->random);
 
-  model->position = (uint32_t*)malloc(size * sizeof(*(model->position)));
-  assert(model->position != NULL);
+  frame->segmented = lastRow;
 
-  for (int i = 0; i < size; ++i) {
-    model->jump[i] = (rand() % (2 * model->updateFactor)) + 1;            // Values between 1 and 2 * updateFactor.
-    model->neighbor[i] = ((rand() % 3) - 1) + ((rand() % 3) - 1) * width; // Values between { width - 1, ... , width + 1 }.
-    model->position[i] = rand() % (model->numberOfSamples);               // Values between 0 and numberOfSamples - 1.
-  }
+  if (lastRow - 1 > frame->updated)
+    frame->updated = lastRow - 1;
 
-  return(0);
+  if (!frame->drawn)
+    drawBorders(model, frame, next);
+
+  /* The border of a row is updated once its neighbors are. */
+  uint32_t bordered = (lastRow == height) ? height : frame->updated - 1;
+
+  if (bordered > frame->bordered)
+    updateBorderRows(model, steps, frame, bordered);
 }
 
 // -----------------------------------------------------------------------------
-// Segmentation of a C3R model
+// Segmentation and update of several frames of a model
 // -----------------------------------------------------------------------------
-int32_t libvibeModel_Sequential_Segmentation_8u_C3R(
+int32_t libvibeModel_Sequential_ProcessFrames(
   vibeModel_Sequential_t *model,
-  const uint8_t *image_data,
-  uint8_t *segmentation_map
+  const uint8_t **images,
+  uint8_t **segmentation_maps,
+  const uint32_t numberOfFrames
 ) {
   /* Basic checks. */
-  assert((image_data != NULL) && (model != NULL) && (segmentation_map != NULL));
-  assert((model->width > 0) && (model->height > 0));
-  assert(model->historyBuffer != NULL);
-  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+  assert((model != NULL) && (images != NULL) && (segmentation_maps != NULL));
+  assert((model->historyBuffer != NULL) && (model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
 
-  /* Some variables. */
-  uint32_t width = model->width;
+  const vibeProcessSteps_t *steps = processSteps(model);
   uint32_t height = model->height;
-  uint32_t matchingNumber = model->matchingNumber;
-  uint32_t matchingThreshold = model->matchingThreshold;
 
-  uint8_t *historyImage = model->historyImage;
-  uint8_t *historyBuffer = model->historyBuffer;
+  /* The bands of several threads, the static blocks and the samples shared by blocks of pixels (a set
+   * written by rows more than two rows apart) are processed frame by frame.
+   */
+  if (isBanded(model) || hasStaticBlocks(model) || (model->sampleBlockSize > 1) || (height < 3) || (numberOfFrames < 2)) {
+    for (uint32_t t = 0; t < numberOfFrames; ++t) {
+      assert((images[t] != NULL) && (segmentation_maps[t] != NULL));
 
-  /* Segmentation. */
-  memset(segmentation_map, matchingNumber - 1, width * height);
-
-  /* First history Image structure. */
-  uint8_t *first = historyImage;
-
-  for (int index = width * height - 1; index >= 0; --index) {
-    if (
-      !distance_is_close_8u_C3R( 
-        image_data[3 * index], image_data[3 * index + 1], image_data[3 * index + 2],
-        first[3 * index], first[3 * index + 1], first[3 * index + 2], matchingThreshold
-      )
-    )
-      segmentation_map[index] = matchingNumber;
-  }
-
-  /* Next historyImages. */
-  for (int i = 1; i < NUMBER_OF_HISTORY_IMAGES; ++i) {
-    uint8_t *pels = historyImage + i * (3 * width) * height;
-
-    for (int index = width * height - 1; index >= 0; --index) {
-      if (
-        distance_is_close_8u_C3R( 
-          image_data[3 * index], image_data[3 * index + 1], image_data[3 * index + 2],
-          pels[3 * index], pels[3 * index + 1], pels[3 * index + 2], matchingThreshold
-        )
-      )
-        --segmentation_map[index];
+      process(model, images[t], segmentation_maps[t], steps);
     }
+
+    return(0);
   }
 
-  // For swapping
-  model->lastHistoryImageSwapped = (model->lastHistoryImageSwapped + 1) % NUMBER_OF_HISTORY_IMAGES;
-  uint8_t *swappingImageBuffer = historyImage + (model->lastHistoryImageSwapped) * (3 * width) * height;
+  vibeFrameJob_t *frames = (vibeFrameJob_t *)calloc(numberOfFrames, sizeof(*frames));
+  assert(frames != NULL);
 
-  // Now, we move in the buffer and leave the historyImages
-  int numberOfTests = (model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES);
+  for (uint32_t t = 0; t < numberOfFrames; ++t) {
+    assert((images[t] != NULL) && (segmentation_maps[t] != NULL));
 
-  for (int index = width * height - 1; index >= 0; --index) {
-    if (segmentation_map[index] > 0) {
-      /* We need to check the full border and swap values with the first or second historyImage.
-       * We still need to find a match before we can stop our search.
-       */
-      uint32_t indexHistoryBuffer = (3 * index) * numberOfTests;
-
-      for (int i = numberOfTests; i > 0; --i, indexHistoryBuffer += 3) {
-        if (
-          distance_is_close_8u_C3R( 
-            image_data[(3 * index)], image_data[(3 * index) + 1], image_data[(3 * index) + 2], 
-            historyBuffer[indexHistoryBuffer], historyBuffer[indexHistoryBuffer + 1], historyBuffer[indexHistoryBuffer + 2], 
-            matchingThreshold
-          )
-        )
-          --segmentation_map[index]; 
+    frames[t].image_data = images[t];
+    frames[t].map = segmentation_maps[t];
+    frames[t].swapped = (model->lastHistoryImageSwapped + 1 + t) % model->numberOfHistoryImages;
+    frames[t].updated = 1;
+  }
 
-        /* Swaping: Putting found value in history image buffer. */
-        uint8_t temp_r = swappingImageBuffer[(3 * index)];
-        uint8_t temp_g = swappingImageBuffer[(3 * index) + 1];
-        uint8_t temp_b = swappingImageBuffer[(3 * index) + 2];
+  frames[0].random = model->random;
 
-        swappingImageBuffer[(3 * index)]     = historyBuffer[indexHistoryBuffer];
-        swappingImageBuffer[(3 * index) + 1] = historyBuffer[indexHistoryBuffer + 1];
-        swappingImageBuffer[(3 * index) + 2] = historyBuffer[indexHistoryBuffer + 2];
+  /* A strip of the first frame at a time, the other frames following the border of the previous frame. */
+  uint32_t rows = stripRows(model, (model->inputChannels == 1) ? 1 : 3);
 
-        historyBuffer[indexHistoryBuffer]     = temp_r;
-        historyBuffer[indexHistoryBuffer + 1] = temp_g;
-        historyBuffer[indexHistoryBuffer + 2] = temp_b;
+  while (frames[numberOfFrames - 1].bordered < height) {
+    for (uint32_t t = 0; t < numberOfFrames; ++t) {
+      uint32_t lastRow = (height - frames[0].segmented > rows) ? frames[0].segmented + rows : height;
 
-        /* Exit inner loop. */
-        if (segmentation_map[index] <= 0) break;
-      } // for
-    } // if
-  } // for
+      if (t > 0)
+        lastRow = frames[t - 1].bordered;
+
+      advanceFrame(model, steps, &frames[t], (t + 1 < numberOfFrames) ? &frames[t + 1].random : &model->random, lastRow);
+    }
+  }
+
+  model->lastHistoryImageSwapped = frames[numberOfFrames - 1].swapped;
 
-  /* Produces the output. Note that this step is application-dependent. */
-  for (uint8_t *mask = segmentation_map; mask < segmentation_map + (width * height); ++mask)
-    if (*mask > 0) *mask = COLOR_FOREGROUND;
+  free(frames);
 
   return(0);
 }
 
 // ----------------------------------------------------------------------------
-// Update a C3R model
+// ----------------------------- Snapshots of models --------------------------
 // ----------------------------------------------------------------------------
-int32_t libvibeModel_Sequential_Update_8u_C3R(
-  vibeModel_Sequential_t *model,
-  const uint8_t *image_data,
-  uint8_t *updating_mask
-) {
-  /* Basic checks. */
-  assert((image_data != NULL) && (model != NULL) && (updating_mask != NULL));
-  assert((model->width > 0) && (model->height > 0));
-  assert(model->historyBuffer != NULL);
-  assert((model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
-
-  /* Some variables. */
-  uint32_t width = model->width;
-  uint32_t height = model->height;
-
-  uint8_t *historyImage = model->historyImage;
-  uint8_t *historyBuffer = model->historyBuffer;
-
-  /* Some utility variable. */
-  int numberOfTests = (model->numberOfSamples - NUMBER_OF_HISTORY_IMAGES);
-
-  /* Updating. */
-  uint32_t *jump = model->jump;
-  int *neighbor = model->neighbor;
-  uint32_t *position = model->position;
+//
+// A snapshot file holds a vibeModelFile_t header (parameters, state of the
+// random stream, and offset and size of every section), followed by the
+// historyImages, the historyBuffer and the jump, neighbor and position
+// buffers. The sections start on a VIBE_FILE_ALIGNMENT boundary, so that a
+// loaded model is used in place: the file is mapped privately, its pages are
+// read on demand and copied on their first write, and the file itself is
+// never modified. The values are stored in the byte order of the machine.
+
+#define VIBE_FILE_VERSION 4
+#define VIBE_FILE_BYTE_ORDER 0x01020304u
+#define VIBE_FILE_ALIGNMENT 4096
+#define VIBE_FILE_SECTIONS 5
+
+static const char vibeFileMagic[8] = { 'V', 'i', 'B', 'e', 'M', 'o', 'd', 'l' };
+
+typedef struct
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t headerSize;
 
-  /* All the frame, except the border. */
-  uint32_t shift, indX, indY;
-  int x, y;
+  /* Parameters and layout of the model. */
+  uint32_t width;
+  uint32_t height;
+  uint32_t numberOfSamples;
+  uint32_t matchingThreshold;
+  uint32_t matchingNumber;
+  uint32_t updateFactor;
+  uint32_t numberOfHistoryImages;
+  uint32_t sampleSize;
+  uint32_t lastHistoryImageSwapped;
+  uint32_t layout;
+  uint32_t bufferLayout;
+  uint32_t imagePixelStride;
+  uint32_t imageChannelStride;
+  uint32_t bufferPixelStride;
+  uint32_t bufferSampleStride;
+  uint32_t bufferChannelStride;
+  uint32_t inputChannels;
+  uint32_t chromaFormat;
+  uint32_t sampleBlockSize;
+  uint32_t sampleFormat;
+
+  /* Random numbers: seed and state of the stream of the model. */
+  uint32_t seed;
+  uint32_t random[4];
+
+  /* historyImage, historyBuffer, jump, neighbor and position: offsets from the start of the file, and sizes, in bytes. */
+  uint64_t offset[VIBE_FILE_SECTIONS];
+  uint64_t size[VIBE_FILE_SECTIONS];
+} vibeModelFile_t;
+
+/* Sizes (in bytes) of the sections of an allocated model (see vibeModelFile_t). */
+static void sectionSizes(const vibeModel_Sequential_t *model, uint64_t *size)
+{
+  uint64_t pixels = (uint64_t)model->width * model->height;
+  uint32_t channels = (model->inputChannels == 4) ? 3 : model->inputChannels;
+  uint64_t plane = (model->chromaFormat != 0) ? pixels * 3 / 2 : pixels * channels * model->sampleSize;
+  uint64_t set = (model->sampleFormat != VIBE_SAMPLE_RGB888) ? (uint64_t)bufferPixels(model) * sizeof(uint16_t) :
+                 ((model->sampleBlockSize == 1) ? plane : (uint64_t)bufferPixels(model) * channels);
+  uint32_t numberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
+
+  size[0] = model->numberOfHistoryImages * plane;
+  size[1] = set * ((numberOfTests > 0) ? numberOfTests : 1);
+  size[2] = tableSize(model) * sizeof(*(model->jump));
+  size[3] = tableSize(model) * sizeof(*(model->neighbor));
+  size[4] = tableSize(model) * sizeof(*(model->position));
+}
 
-  for (y = 1; y < height - 1; ++y) {
-    shift = rand() % width;
-    indX = jump[shift]; // index_jump should never be zero (> 1).
+/* Strides of a loaded model, computed from its type and layouts as by its AllocInit function. */
+static void setLoadedStrides(vibeModel_Sequential_t *model)
+{
+  uint32_t numberOfTests = model->numberOfSamples - model->numberOfHistoryImages;
 
-    while (indX < width - 1) {
-      int index = indX + y * width;
+  model->imagePixelStride    = 0;
+  model->imageChannelStride  = 0;
+  model->bufferChannelStride = 0;
 
-      if (updating_mask[index] == COLOR_BACKGROUND) {
-        /* In-place substitution. */
-        uint8_t r = image_data[3 * index];
-        uint8_t g = image_data[3 * index + 1];
-        uint8_t b = image_data[3 * index + 2];
+  if (model->chromaFormat != 0) {
+    model->imagePixelStride = 1;
+    setBufferStrides_8u_420(model, numberOfTests);
+  }
+  else if (model->sampleSize == 2)
+    setStrides_16u(model, model->inputChannels, numberOfTests);
+  else if (model->inputChannels == 1)
+    setBufferStrides_8u(model, 1, numberOfTests);
+  else {
+    setImageStrides_8u_C3R(model);
+    setBufferStrides_8u(model, 3, numberOfTests);
+  }
+}
 
-        int index_neighbor = 3 * (index + neighbor[shift]);
+/* Whether the buffers with random values of a loaded model only hold values that newTables draws. */
+static int validTables(const vibeModel_Sequential_t *model, const uint32_t *jump, const int *neighbor, const uint32_t *position)
+{
+  int width = (int)model->width;
 
-        if (position[shift] < NUMBER_OF_HISTORY_IMAGES) {
-          historyImage[3 * index + position[shift] * (3 * width) * height    ] = r;
-          historyImage[3 * index + position[shift] * (3 * width) * height + 1] = g;
-          historyImage[3 * index + position[shift] * (3 * width) * height + 2] = b;
+  for (uint32_t i = 0; i < tableSize(model); ++i) {
+    int adjacent = 0;
 
-          historyImage[index_neighbor + position[shift] * (3 * width) * height    ] = r;
-          historyImage[index_neighbor + position[shift] * (3 * width) * height + 1] = g;
-          historyImage[index_neighbor + position[shift] * (3 * width) * height + 2] = b;
-        }
-        else {
-          int pos = position[shift] - NUMBER_OF_HISTORY_IMAGES;
+    for (int dy = -1; dy <= 1; ++dy)
+      for (int dx = -1; dx <= 1; ++dx)
+        adjacent = adjacent || (neighbor[i] == dx + dy * width);
 
-          historyBuffer[(3 * index) * numberOfTests + 3 * pos    ] = r;
-          historyBuffer[(3 * index) * numberOfTests + 3 * pos + 1] = g;
-          historyBuffer[(3 * index) * numberOfTests + 3 * pos + 2] = b;
+    if (!adjacent || (jump[i] == 0) || ((uint64_t)jump[i] > 2 * (uint64_t)model->updateFactor) || (position[i] >= model->numberOfSamples))
+      return(0);
+  }
 
-          historyBuffer[index_neighbor * numberOfTests + 3 * pos    ] = r;
-          historyBuffer[index_neighbor * numberOfTests + 3 * pos + 1] = g;
-          historyBuffer[index_neighbor * numberOfTests + 3 * pos + 2] = b;
-        }
-      }
+  return(1);
+}
 
-      ++shift;
-      indX += jump[shift];
-    }
+// -----------------------------------------------------------------------------
+// Saves a model to a snapshot file
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Save(const vibeModel_Sequential_t *model, const char *filename)
+{
+  /* Basic checks. */
+  assert((model != NULL) && (filename != NULL));
+  assert((model->historyBuffer != NULL) && (model->jump != NULL) && (model->neighbor != NULL) && (model->position != NULL));
+
+  vibeModelFile_t header;
+  memset(&header, 0, sizeof(header));
+
+  memcpy(header.magic, vibeFileMagic, sizeof(header.magic));
+  header.version                 = VIBE_FILE_VERSION;
+  header.byteOrder               = VIBE_FILE_BYTE_ORDER;
+  header.headerSize              = sizeof(header);
+  header.width                   = model->width;
+  header.height                  = model->height;
+  header.numberOfSamples         = model->numberOfSamples;
+  header.matchingThreshold       = model->matchingThreshold;
+  header.matchingNumber          = model->matchingNumber;
+  header.updateFactor            = model->updateFactor;
+  header.numberOfHistoryImages   = model->numberOfHistoryImages;
+  header.sampleSize              = model->sampleSize;
+  header.lastHistoryImageSwapped = model->lastHistoryImageSwapped;
+  header.layout                  = model->layout;
+  header.bufferLayout            = model->bufferLayout;
+  header.imagePixelStride        = model->imagePixelStride;
+  header.imageChannelStride      = model->imageChannelStride;
+  header.bufferPixelStride       = model->bufferPixelStride;
+  header.bufferSampleStride      = model->bufferSampleStride;
+  header.bufferChannelStride     = model->bufferChannelStride;
+  header.inputChannels           = model->inputChannels;
+  header.chromaFormat            = model->chromaFormat;
+  header.sampleBlockSize         = model->sampleBlockSize;
+  header.sampleFormat            = model->sampleFormat;
+  header.seed                    = model->seed;
+  memcpy(header.random, model->random.s, sizeof(header.random));
+
+  const void *section[VIBE_FILE_SECTIONS] = { model->historyImage, model->historyBuffer, model->jump, model->neighbor, model->position };
+  uint64_t offset = sizeof(header);
+
+  sectionSizes(model, header.size);
+
+  for (int i = 0; i < VIBE_FILE_SECTIONS; ++i) {
+    offset = (offset + VIBE_FILE_ALIGNMENT - 1) / VIBE_FILE_ALIGNMENT * VIBE_FILE_ALIGNMENT;
+    header.offset[i] = offset;
+    offset += header.size[i];
   }
 
-  /* First row. */
-  y = 0;
-  shift = rand() % width;
-  indX = jump[shift]; // index_jump should never be zero (> 1).
-
-  while (indX <= width - 1) {
-    int index = indX + y * width;
+  FILE *file = fopen(filename, "wb");
 
-    uint8_t r = image_data[3 * index];
-    uint8_t g = image_data[3 * index + 1];
-    uint8_t b = image_data[3 * index + 2];
+  if (file == NULL)
+    return(-1);
 
-    if (updating_mask[index] == COLOR_BACKGROUND) {
-      if (position[shift] < NUMBER_OF_HISTORY_IMAGES) {
-        historyImage[3 * index + position[shift] * (3 * width) * height    ] = r;
-        historyImage[3 * index + position[shift] * (3 * width) * height + 1] = g;
-        historyImage[3 * index + position[shift] * (3 * width) * height + 2] = b;
-      }
-      else {
-        int pos = position[shift] - NUMBER_OF_HISTORY_IMAGES;
+  int ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+  uint64_t position = sizeof(header);
 
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos    ] = r;
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos + 1] = g;
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos + 2] = b;
-      }
-    }
+  for (int i = 0; ok && (i < VIBE_FILE_SECTIONS); ++i) {
+    /* Zeros up to the start of the section. */
+    for (; ok && (position < header.offset[i]); ++position)
+      ok = (fputc(0, file) != EOF);
 
-    ++shift;
-    indX += jump[shift];
+    ok = ok && (fwrite(section[i], 1, header.size[i], file) == header.size[i]);
+    position += header.size[i];
   }
 
-  /* Last row. */
-  y = height - 1;
-  shift = rand() % width;
-  indX = jump[shift]; // index_jump should never be zero (> 1).
-
-  while (indX <= width - 1) {
-    int index = indX + y * width;
+  if (fclose(file) != 0)
+    ok = 0;
 
-    uint8_t r = image_data[3 * index];
-    uint8_t g = image_data[3 * index + 1];
-    uint8_t b = image_data[3 * index + 2];
-
-    if (updating_mask[index] == COLOR_BACKGROUND) {
-      if (position[shift] < NUMBER_OF_HISTORY_IMAGES) {
-        historyImage[3 * index + position[shift] * (3 * width) * height    ] = r;
-        historyImage[3 * index + position[shift] * (3 * width) * height + 1] = g;
-        historyImage[3 * index + position[shift] * (3 * width) * height + 2] = b;
-      }
-      else {
-        int pos = position[shift] - NUMBER_OF_HISTORY_IMAGES;
+  return(ok ? 0 : -1);
+}
 
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos    ] = r;
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos + 1] = g;
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos + 2] = b;
-      }
-    }
+// -----------------------------------------------------------------------------
+// Loads a model from a snapshot file, in place of the AllocInit functions
+// -----------------------------------------------------------------------------
+int32_t libvibeModel_Sequential_Load(vibeModel_Sequential_t *model, const char *filename)
+{
+  /* Basic checks: the model is not allocated yet. */
+  assert((model != NULL) && (filename != NULL));
+  assert(model->historyBuffer == NULL);
 
-    ++shift;
-    indX += jump[shift];
-  }
+  int fd = open(filename, O_RDONLY);
 
-  /* First column. */
-  x = 0;
-  shift = rand() % height;
-  indY = jump[shift]; // index_jump should never be zero (> 1).
+  if (fd < 0)
+    return(-1);
 
-  while (indY <= height - 1) {
-    int index = x + indY * width;
+  struct stat status;
+  void *mapping = MAP_FAILED;
 
-    uint8_t r = image_data[3 * index];
-    uint8_t g = image_data[3 * index + 1];
-    uint8_t b = image_data[3 * index + 2];
+  if ((fstat(fd, &status) == 0) && ((uint64_t)status.st_size >= sizeof(vibeModelFile_t)))
+    mapping = mmap(NULL, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
 
-    if (updating_mask[index] == COLOR_BACKGROUND) {
-      if (position[shift] < NUMBER_OF_HISTORY_IMAGES) {
-        historyImage[3 * index + position[shift] * (3 * width) * height    ] = r;
-        historyImage[3 * index + position[shift] * (3 * width) * height + 1] = g;
-        historyImage[3 * index + position[shift] * (3 * width) * height + 2] = b;
-      }
-      else {
-        int pos = position[shift] - NUMBER_OF_HISTORY_IMAGES;
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos    ] = r;
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos + 1] = g;
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos + 2] = b;
-      }
-    }
+  /* The whole model is read by the first frame: the file is read ahead. */
+  if (mapping != MAP_FAILED)
+    posix_madvise(mapping, status.st_size, POSIX_MADV_WILLNEED);
 
-    ++shift;
-    indY += jump[shift];
-  }
+  /* The mapping stays valid once the file is closed. */
+  close(fd);
 
-  /* Last column. */
-  x = width - 1;
-  shift = rand() % height;
-  indY = jump[shift]; // index_jump should never be zero (> 1).
+  if (mapping == MAP_FAILED)
+    return(-1);
 
-  while (indY <= height - 1) {
-    int index = x + indY * width;
+  /* Checks the header against the rules of New, the setters and the AllocInit
+   * functions, then the sections, the strides and the buffers with random values
+   * against the parameters: nothing is used before it is checked.
+   */
+  const vibeModelFile_t *header = (const vibeModelFile_t *)mapping;
+  int ok = (memcmp(header->magic, vibeFileMagic, sizeof(header->magic)) == 0) &&
+           (header->version == VIBE_FILE_VERSION) &&
+           (header->byteOrder == VIBE_FILE_BYTE_ORDER) &&
+           (header->headerSize == sizeof(vibeModelFile_t)) &&
+           (header->width > 0) && (header->width < (1u << 30)) &&
+           (header->height > 0) && (header->height < (1u << 30)) &&
+           ((uint64_t)header->width * header->height * header->numberOfSamples <= UINT32_MAX) &&
+           (header->numberOfHistoryImages > 0) && (header->numberOfHistoryImages <= header->matchingNumber) && (header->matchingNumber <= header->numberOfSamples) &&
+           (header->matchingThreshold > 0) && (header->updateFactor > 0) &&
+           (header->lastHistoryImageSwapped < header->numberOfHistoryImages) &&
+           (header->layout <= VIBE_LAYOUT_PLANAR) && (header->bufferLayout <= VIBE_BUFFER_SAMPLE_MAJOR) &&
+           ((header->random[0] | header->random[1] | header->random[2] | header->random[3]) != 0) &&
+           /* 8u C1R, C3R or C4R, 16u C1R or interleaved C3R, or 8u 4:2:0 models. */
+           ((header->chromaFormat == 0) ?
+             (((header->sampleSize == 1) && (header->inputChannels != 2)) ||
+              ((header->sampleSize == 2) && ((header->inputChannels == 1) || ((header->inputChannels == 3) && (header->layout == VIBE_LAYOUT_INTERLEAVED))))) :
+             ((header->chromaFormat <= VIBE_CHROMA_NV12) && (header->sampleSize == 1) && (header->inputChannels == 1) && (header->width % 2 == 0) && (header->height % 2 == 0))) &&
+           (header->inputChannels >= 1) && (header->inputChannels <= 4) &&
+           (header->sampleBlockSize > 0) && ((header->sampleBlockSize == 1) || ((header->sampleSize == 1) && (header->chromaFormat == 0) && (header->bufferLayout == VIBE_BUFFER_PIXEL_MAJOR))) &&
+           (header->sampleFormat <= VIBE_SAMPLE_RGB555) &&
+           ((header->sampleFormat == VIBE_SAMPLE_RGB888) || ((header->sampleSize == 1) && (header->chromaFormat == 0) && (header->inputChannels >= 3) && (header->bufferLayout == VIBE_BUFFER_PIXEL_MAJOR)));
+
+  vibeModel_Sequential_t loaded = *model;
+
+  if (ok) {
+    uint64_t size[VIBE_FILE_SECTIONS];
+
+    loaded.width                   = header->width;
+    loaded.height                  = header->height;
+    loaded.numberOfSamples         = header->numberOfSamples;
+    loaded.numberOfHistoryImages   = header->numberOfHistoryImages;
+    loaded.sampleSize              = header->sampleSize;
+    loaded.inputChannels           = header->inputChannels;
+    loaded.chromaFormat            = header->chromaFormat;
+    loaded.sampleBlockSize         = header->sampleBlockSize;
+    loaded.sampleFormat            = (vibeSampleFormat_t)header->sampleFormat;
+    loaded.matchingThreshold       = header->matchingThreshold;
+    loaded.matchingNumber          = header->matchingNumber;
+    loaded.updateFactor            = header->updateFactor;
+    loaded.lastHistoryImageSwapped = header->lastHistoryImageSwapped;
+    loaded.layout                  = (vibeModelLayout_t)header->layout;
+    loaded.bufferLayout            = (vibeBufferLayout_t)header->bufferLayout;
+    loaded.seed                    = header->seed;
+    memcpy(loaded.random.s, header->random, sizeof(header->random));
+
+    sectionSizes(&loaded, size);
+
+    for (int i = 0; i < VIBE_FILE_SECTIONS; ++i) {
+      ok = ok && (header->size[i] == size[i]) && (header->offset[i] % VIBE_FILE_ALIGNMENT == 0);
+      ok = ok && (header->offset[i] >= sizeof(vibeModelFile_t)) && (header->offset[i] <= (uint64_t)status.st_size) && (size[i] <= (uint64_t)status.st_size - header->offset[i]);
+    }
 
-    uint8_t r = image_data[3 * index];
-    uint8_t g = image_data[3 * index + 1];
-    uint8_t b = image_data[3 * index + 2];
+    /* The strides are those of the AllocInit function, not those of the file: a saved model always has them. */
+    setLoadedStrides(&loaded);
 
-    if (updating_mask[index] == COLOR_BACKGROUND) {
-      if (position[shift] < NUMBER_OF_HISTORY_IMAGES) {
-        historyImage[3 * index + position[shift] * (3 * width) * height    ] = r;
-        historyImage[3 * index + position[shift] * (3 * width) * height + 1] = g;
-        historyImage[3 * index + position[shift] * (3 * width) * height + 2] = b;
-      }
-      else {
-        int pos = position[shift] - NUMBER_OF_HISTORY_IMAGES;
+    ok = ok && (header->imagePixelStride == loaded.imagePixelStride) && (header->imageChannelStride == loaded.imageChannelStride) &&
+         (header->bufferPixelStride == loaded.bufferPixelStride) && (header->bufferSampleStride == loaded.bufferSampleStride) &&
+         (header->bufferChannelStride == loaded.bufferChannelStride);
 
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos    ] = r;
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos + 1] = g;
-        historyBuffer[(3 * index) * numberOfTests + 3 * pos + 2] = b;
-      }
-    }
+    ok = ok && validTables(&loaded,
+                           (const uint32_t *)((uint8_t *)mapping + header->offset[2]),
+                           (const int *)((uint8_t *)mapping + header->offset[3]),
+                           (const uint32_t *)((uint8_t *)mapping + header->offset[4]));
+  }
 
-    ++shift;
-    indY += jump[shift];
+  if (!ok) {
+    munmap(mapping, status.st_size);
+    return(-1);
   }
 
-  /* The first pixel! */
-  if (rand() % model->updateFactor == 0) {
-    if (updating_mask[0] == 0) {
-      int position = rand() % model->numberOfSamples;
+  /* Finish model alloc - parameters values cannot be changed anymore; the number of threads and the image step stay those of the caller. */
+  *model = loaded;
 
-      uint8_t r = image_data[0];
-      uint8_t g = image_data[1];
-      uint8_t b = image_data[2];
+  /* The history and the buffers with random values are used in place. */
+  uint8_t *base = (uint8_t *)mapping;
 
-      if (position < NUMBER_OF_HISTORY_IMAGES) {
-        historyImage[position * (3 * width) * height    ] = r;
-        historyImage[position * (3 * width) * height + 1] = g;
-        historyImage[position * (3 * width) * height + 2] = b;
-      }
-      else {
-        int pos = position - NUMBER_OF_HISTORY_IMAGES;
+  model->historyImage  = base + header->offset[0];
+  model->historyBuffer = base + header->offset[1];
+  model->jump          = (const uint32_t *)(base + header->offset[2]);
+  model->neighbor      = (const int *)(base + header->offset[3]);
+  model->position      = (const uint32_t *)(base + header->offset[4]);
+  model->mapping       = mapping;
+  model->mappingSize   = status.st_size;
 
-        historyBuffer[3 * pos    ] = r;
-        historyBuffer[3 * pos + 1] = g;
-        historyBuffer[3 * pos + 2] = b;
-      }
-    }
-  }
+  /* List of the pixels that still need the historyBuffer search. */
+  model->tailIndex = (uint32_t*)allocStorage(model, model->width * model->height * sizeof(*(model->tailIndex)));
+  assert(model->tailIndex != NULL);
 
   return(0);
 }
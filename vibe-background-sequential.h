@@ -62,6 +62,129 @@ extern "C"
  */
 typedef struct vibeModel_Sequential vibeModel_Sequential_t;
 
+/**
+ * \typedef struct vibeBatch_t
+ * \brief Pool of threads shared by several models (see \ref libvibeModel_Sequential_ProcessBatch).
+ */
+typedef struct vibeBatch vibeBatch_t;
+
+/**
+ * \typedef enum vibeModelLayout_t
+ * \brief Memory layout of the samples of a color (C3R) model.
+ *
+ * The layout only changes how the model is stored in memory, not the results
+ * of ViBe. The input images are always RGBRGB...
+ */
+typedef enum
+{
+  VIBE_LAYOUT_INTERLEAVED = 0, /*!< Samples stored as RGBRGB... (default). */
+  VIBE_LAYOUT_PLANAR      = 1  /*!< Samples stored as separate R, G and B planes; the input frame is deinterleaved once per frame. */
+} vibeModelLayout_t;
+
+/**
+ * \typedef enum vibeBufferLayout_t
+ * \brief Order of the samples stored in the history buffer (all the samples
+ * of a model but the first two).
+ *
+ * As for \ref vibeModelLayout_t, the results of ViBe do not depend on it.
+ */
+typedef enum
+{
+  VIBE_BUFFER_PIXEL_MAJOR  = 0, /*!< The samples of a pixel are contiguous (default). */
+  VIBE_BUFFER_SAMPLE_MAJOR = 1  /*!< Sample i of all the pixels is contiguous, like the history images. */
+} vibeBufferLayout_t;
+
+/**
+ * \typedef enum vibeSampleFormat_t
+ * \brief Storage of the samples of the history buffer of a color (C3R) model.
+ *
+ * Unlike \ref vibeModelLayout_t, the formats of 16 bits change the results of
+ * ViBe: the samples lose the low bits of their channels.
+ */
+typedef enum
+{
+  VIBE_SAMPLE_RGB888 = 0, /*!< 3 bytes per sample (default). */
+  VIBE_SAMPLE_RGB565 = 1, /*!< 16 bits per sample: 5 bits of red, 6 of green and 5 of blue. */
+  VIBE_SAMPLE_RGB555 = 2  /*!< 16 bits per sample: 5 bits per channel (the top bit is unused). */
+} vibeSampleFormat_t;
+
+/**
+ * \typedef enum vibeSampleOrdering_t
+ * \brief Order of the samples of a pixel in the history buffer, as kept by the
+ * segmentation (see \ref libvibeModel_Sequential_SetSampleOrdering).
+ *
+ * The samples held by the model are the same; only the samples tested before
+ * a pixel is decided, and therefore the samples swapped, change.
+ */
+typedef enum
+{
+  VIBE_ORDERING_SWAP          = 0, /*!< A matching sample is swapped with a historyImage and the buffer keeps its order (default). */
+  VIBE_ORDERING_MOVE_TO_FRONT = 1  /*!< In addition, the sample left in its place moves to the front of the buffer. */
+} vibeSampleOrdering_t;
+
+/**
+ * \typedef struct vibeRectangle_t
+ * \brief Rectangle of pixels of a region of interest (see \ref libvibeModel_Sequential_SetROIRectangles).
+ */
+typedef struct
+{
+  int32_t x;       /*!< First column (may be outside the frame). */
+  int32_t y;       /*!< First row (may be outside the frame). */
+  uint32_t width;  /*!< Number of columns. */
+  uint32_t height; /*!< Number of rows. */
+} vibeRectangle_t;
+
+/**
+ * \typedef struct vibePoint_t
+ * \brief Vertex of a polygon of a region of interest (see \ref libvibeModel_Sequential_SetROIPolygons).
+ */
+typedef struct
+{
+  int32_t x;
+  int32_t y;
+} vibePoint_t;
+
+/**
+ * \typedef struct vibeAllocator_t
+ * \brief Allocator of the storage of a model (see \ref libvibeModel_Sequential_SetAllocator).
+ *
+ * alloc returns a block of size bytes aligned on alignment bytes (a power of
+ * two, at least 64), or NULL on failure; free releases a block returned by
+ * alloc. Both get the context of the allocator.
+ */
+typedef struct
+{
+  void *(*alloc)(void *context, size_t size, size_t alignment);
+  void (*free)(void *context, void *pointer);
+  void *context;
+} vibeAllocator_t;
+
+/**
+ * \typedef struct vibeStats_t
+ * \brief Counters of the segmentation and the update (see \ref libvibeModel_Sequential_GetStats).
+ *
+ * The average number of samples tested per pixel is testedSamples /
+ * segmentedPixels. Pixels outside of the regions of interest or in skipped
+ * static blocks are not segmented and not counted.
+ *
+ * swappedSamples follows the swapping of each type of model: the grayscale
+ * (8u and 16u C1R) and 4:2:0 models swap the matching samples of the tail,
+ * while the color (8u and 16u C3R/C4R, 16-bit samples included) models swap
+ * every tested sample of the tail, and only the matching ones with the
+ * move-to-front ordering. The samples shared by a block of pixels are never
+ * swapped.
+ */
+typedef struct
+{
+  uint64_t segmentedPixels; /*!< Pixels compared to their samples. */
+  uint64_t tailPixels;      /*!< Pixels that reached the historyBuffer (the tail). */
+  uint64_t testedSamples;   /*!< Samples compared to the pixels. */
+  uint64_t swappedSamples;  /*!< Samples of the tail swapped into the historyImages (see above). */
+  uint64_t movedSamples;    /*!< Samples of the tail moved to the front of the historyBuffer (see \ref vibeSampleOrdering_t). */
+  uint64_t updateWrites;    /*!< Samples replaced by the update, neighbors included. */
+  uint64_t neighborWrites;  /*!< Samples of a neighbor replaced by the update (spatial diffusion). */
+} vibeStats_t;
+
 /**
  * Allocation of a new data structure where the background model will be stored.
  * Please note that this function only creates the structure to host the data.
@@ -83,7 +206,8 @@ vibeModel_Sequential_t *libvibeModel_Sequential_New();
 uint32_t libvibeModel_Sequential_PrintParameters(const vibeModel_Sequential_t *model);
 
 /**
- * Setter.
+ * Setter. Once the model is allocated, the samples are kept: see
+ * \ref libvibeModel_Sequential_Resize.
  *
  * @param model The data structure with ViBe's background subtraction model and parameters.
  * @param numberOfSamples
@@ -123,7 +247,8 @@ int32_t libvibeModel_Sequential_SetMatchingThreshold(
 uint32_t libvibeModel_Sequential_GetMatchingThreshold(const vibeModel_Sequential_t *model);
 
 /**
- * Setter.
+ * Setter. Once the model is allocated, see \ref libvibeModel_Sequential_Resize
+ * (the matching number cannot go below the number of historyImages).
  *
  * @param model The data structure with ViBe's background subtraction model and parameters.
  * @param matchingNumber
@@ -135,7 +260,11 @@ int32_t libvibeModel_Sequential_SetMatchingNumber(
 );
 
 /**
- * Setter.
+ * Setter. The buffers with random values of the update only depend on the
+ * width, the height, the update factor, the number of samples and the seed of
+ * a model: the models of the same configuration share a single read-only copy,
+ * and a model changing its update factor moves to the copy of its new
+ * configuration.
  *
  * @param model The data structure with ViBe's background subtraction model and parameters.
  * @param updateFactor New value for the update factor. Please note that the update factor is to be understood as a probability of updating. More specifically, an update factor of 16 means that 1 out of every 16 background pixels is updated. Likewise, an update factor of 1 means that every background pixel is updated.
@@ -164,127 +293,1131 @@ uint32_t libvibeModel_Sequential_GetMatchingNumber(const vibeModel_Sequential_t
 uint32_t libvibeModel_Sequential_GetUpdateFactor(const vibeModel_Sequential_t *model);
 
 /**
- * \brief Frees all the memory used by the <tt>model</tt> and deallocates the structure.
+ * Setter. Chooses the memory layout of a color model. It must be called
+ * before \ref libvibeModel_Sequential_AllocInit_8u_C3R.
+ *
+ * With the planar layout, the comparisons with the historyImages no longer
+ * need to shuffle the samples, but each update writes to three distant
+ * places. Which layout is faster depends on the processor and on the update
+ * factor: both give the same results.
  *
- * This function frees all the memory allocated by \ref libvibeModel_SequentialNew and
- * \ref libvibeModel_Sequential_AllocInit_8u_C1R or \ref libvibeModel_Sequential_AllocInit_8u_C3R.
  * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param layout
  * @return
  */
-int32_t libvibeModel_Sequential_Free(vibeModel_Sequential_t *model);
+int32_t libvibeModel_Sequential_SetLayout(
+  vibeModel_Sequential_t *model,
+  const vibeModelLayout_t layout
+);
 
 /**
- * The two following functions allocate the required memory according to the
- * model parameters and the dimensions of the input images.
- * You must use the "C1R" function for grayscale images and the "C3R" for color
- * images. 
- * These 2 functions also initialize the background model using the content
- * of *image_data which is the pixel buffer of the first image of your stream.
+ * Getter.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return
  */
-// -------------------------  Single channel images ----------------------------
+vibeModelLayout_t libvibeModel_Sequential_GetLayout(const vibeModel_Sequential_t *model);
+
 /**
+ * Setter. Chooses the order of the samples in the history buffer. It must be
+ * called before the model is allocated (AllocInit_8u_C1R or AllocInit_8u_C3R).
+ *
+ * With the sample-major order, the pixels that are not decided by the first
+ * two samples are searched sample by sample, several pixels at a time. This
+ * pays off when many pixels need the full search (foreground, water, foliage,
+ * rain...); the pixel-major order is better when there are few of them.
  *
  * @param model The data structure with ViBe's background subtraction model and parameters.
- * @param image_data
- * @param width
- * @param height
+ * @param bufferLayout
  * @return
  */
-int32_t libvibeModel_Sequential_AllocInit_8u_C1R(
+int32_t libvibeModel_Sequential_SetBufferLayout(
   vibeModel_Sequential_t *model,
-  const uint8_t *image_data,
-  const uint32_t width,
-  const uint32_t height
+  const vibeBufferLayout_t bufferLayout
 );
 
-/* These 2 functions perform 2 operations:
- *   - they classify the pixels *image_data using the provided model and store
- *     the results in *segmentation_map.
- *   - they update *model according to these results and the content of
- *     *image_data.
- * You must use the "C1R" function for grayscale images and the "C3R" for color
- * images.
+/**
+ * Getter.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return
  */
+vibeBufferLayout_t libvibeModel_Sequential_GetBufferLayout(const vibeModel_Sequential_t *model);
+
 /**
+ * Setter. Shares the samples of the historyBuffer among the pixels of blocks
+ * of sampleBlockSize x sampleBlockSize pixels (1, the default, for a set of
+ * samples per pixel). It must be called before the AllocInit function of an
+ * 8u C1R, C3R or C4R model with the pixel-major order of the buffer.
+ *
+ * The historyImages keep a sample per pixel and every pixel is still
+ * classified on its own, but the samples it searches next are those of its
+ * block, and the update writes into them: with blocks of 2 x 2 pixels, the
+ * historyBuffer takes 4 times less memory and memory traffic. The samples of
+ * a block are not swapped with the historyImages, and a frame is processed in
+ * a single band of rows (see \ref libvibeModel_Sequential_ProcessBatch to
+ * spread such models on several threads). The results are not those of a
+ * model with a set of samples per pixel.
  *
  * @param model The data structure with ViBe's background subtraction model and parameters.
- * @param image_data
- * @param segmentation_map
+ * @param sampleBlockSize
  * @return
  */
-int32_t libvibeModel_Sequential_Segmentation_8u_C1R(
+int32_t libvibeModel_Sequential_SetSampleBlockSize(
   vibeModel_Sequential_t *model,
-  const uint8_t *image_data,
-  uint8_t *segmentation_map
+  const uint32_t sampleBlockSize
 );
 
 /**
+ * Getter.
  *
  * @param model The data structure with ViBe's background subtraction model and parameters.
- * @param image_data
- * @param updating_mask
  * @return
  */
-int32_t libvibeModel_Sequential_Update_8u_C1R(
+uint32_t libvibeModel_Sequential_GetSampleBlockSize(const vibeModel_Sequential_t *model);
+
+/**
+ * Setter. Stores the samples of the historyBuffer of a color model on 16 bits
+ * (see \ref vibeSampleFormat_t). It must be called before the AllocInit
+ * function of an 8u C3R or C4R model with the pixel-major order of the buffer.
+ *
+ * The historyImages keep 3 bytes per sample, so that the first samples of a
+ * pixel are still compared exactly; the samples of the historyBuffer are
+ * compared through the center of their quantization bin (at most 4 away from
+ * the quantized values in every channel, far below 4.5 times the usual
+ * matching thresholds). With 20 samples per pixel, the model takes 30% less
+ * memory and memory traffic. The number of samples of such a model cannot be
+ * changed once it is allocated.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param sampleFormat
+ * @return
+ */
+int32_t libvibeModel_Sequential_SetSampleFormat(
   vibeModel_Sequential_t *model,
-  const uint8_t *image_data,
-  uint8_t *updating_mask
+  const vibeSampleFormat_t sampleFormat
 );
 
-// -------------------------  Three channel images -----------------------------
 /**
- * The pixel values of color images are arranged in the following order
- * RGBRGBRGB... (or HSVHSVHSVHSVHSVHSV...)
+ * Getter.
  *
  * @param model The data structure with ViBe's background subtraction model and parameters.
- * @param image_data
- * @param width
- * @param height
  * @return
  */
-int32_t libvibeModel_Sequential_AllocInit_8u_C3R(
+vibeSampleFormat_t libvibeModel_Sequential_GetSampleFormat(const vibeModel_Sequential_t *model);
+
+/**
+ * Setter. Keeps the samples of the historyBuffer of every pixel in the order
+ * of their last match (see \ref vibeSampleOrdering_t). It may be called at
+ * any time, between two frames; it only applies to the 8u C1R, C3R and C4R
+ * models with the pixel-major order of the buffer, and is not saved with the
+ * model.
+ *
+ * With VIBE_ORDERING_MOVE_TO_FRONT, when a sample of the historyBuffer matches
+ * a pixel, it is swapped with the historyImage as usual (but for the samples
+ * shared by blocks of pixels), and the sample left in its place, which
+ * matched that pixel before, moves to the front of the samples of the pixel.
+ * A pixel whose background has several modes (waving trees, flickering
+ * signs) then finds its other modes among its first samples instead of
+ * deep in the buffer: see the samples tested per pixel in
+ * \ref libvibeModel_Sequential_GetStats. The color models then swap the
+ * matching samples only, like the grayscale models.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param sampleOrdering
+ * @return
+ */
+int32_t libvibeModel_Sequential_SetSampleOrdering(
   vibeModel_Sequential_t *model,
-  const uint8_t *image_data,
-  const uint32_t width,
-  const uint32_t height
+  const vibeSampleOrdering_t sampleOrdering
 );
 
-/* These 2 functions perform 2 operations:
- *   - they classify the pixels *image_data using the provided model and store
- *     the results in *segmentation_map.
- *   - they update *model according to these results and the content of
- *     *image_data.
- * You must use the "C1R" function for grayscale images and the "C3R" for color
- * images.
+/**
+ * Getter.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return
  */
+vibeSampleOrdering_t libvibeModel_Sequential_GetSampleOrdering(const vibeModel_Sequential_t *model);
+
 /**
- * The pixel values of color images are arranged in the following order
- * RGBRGBRGB... (or HSVHSVHSVHSVHSVHSV...)
+ * Setter. Sets the number of historyImages, i.e. of samples that are stored
+ * like images and tested for every pixel in a single sweep before the search
+ * in the historyBuffer. With 0 (the default), the model uses matchingNumber
+ * historyImages, so that most background pixels are decided without the
+ * historyBuffer; the segmentation kernels are specialized for 1 to 4
+ * historyImages. It must be called before the AllocInit function, and the
+ * value is limited to matchingNumber (a pixel matching every historyImage must
+ * not count more matches than needed) and to numberOfSamples.
  *
  * @param model The data structure with ViBe's background subtraction model and parameters.
- * @param image_data
- * @param segmentation_map
+ * @param numberOfHistoryImages
  * @return
  */
-int32_t libvibeModel_Sequential_Segmentation_8u_C3R(
+int32_t libvibeModel_Sequential_SetNumberOfHistoryImages(
   vibeModel_Sequential_t *model,
-  const uint8_t *image_data,
-  uint8_t *segmentation_map
+  const uint32_t numberOfHistoryImages
 );
 
 /**
- * The pixel values of color images are arranged in the following order
- * RGBRGBRGB... (or HSVHSVHSVHSVHSVHSV...)
+ * Getter.
  *
  * @param model The data structure with ViBe's background subtraction model and parameters.
- * @param image_data
- * @param updating_mask
+ * @return The number of historyImages of the model (0 before the AllocInit function if it was not set).
+ */
+uint32_t libvibeModel_Sequential_GetNumberOfHistoryImages(const vibeModel_Sequential_t *model);
+
+/**
+ * Setter. Sets the row pitch of the input images, i.e. the number of bytes
+ * from the first pixel of a row to the first pixel of the next one (0, the
+ * default, for rows without padding: width * channels bytes, or twice as many
+ * for the 16u functions). Images whose rows are padded, such as the frames of
+ * decoders, of capture devices or of aligned buffers, are then read in place,
+ * without a copy. It can be called at any time, and applies to the image_data
+ * of all the functions (AllocInit included); the segmentation maps and the
+ * updating masks are never padded.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param imageStep
  * @return
  */
-int32_t libvibeModel_Sequential_Update_8u_C3R(
+int32_t libvibeModel_Sequential_SetImageStep(
   vibeModel_Sequential_t *model,
-  const uint8_t *image_data,
-  uint8_t *updating_mask
+  const uint32_t imageStep
+);
+
+/**
+ * Getter.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return The row pitch given to \ref libvibeModel_Sequential_SetImageStep (0 for rows without padding).
+ */
+uint32_t libvibeModel_Sequential_GetImageStep(const vibeModel_Sequential_t *model);
+
+/**
+ * Setter. Sets the number of threads used by the segmentation and the update
+ * (1 by default). It can be called at any time.
+ *
+ * The frame is split into horizontal bands of rows, one per thread. The
+ * segmentation does not depend on the number of threads. The update does:
+ * each band draws from its own random stream (seeded from the stream of the
+ * model), and the rows at the edges of the bands are updated after the
+ * others, in the band order. For a given seed (see
+ * \ref libvibeModel_Sequential_SetSeed) and a given number of threads, the
+ * results are always the same; with 1 thread, they are those of the
+ * sequential code. The threads are started at the first multi-threaded call.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param numberOfThreads
+ * @return
+ */
+int32_t libvibeModel_Sequential_SetNumberOfThreads(
+  vibeModel_Sequential_t *model,
+  const uint32_t numberOfThreads
+);
+
+/**
+ * Getter.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return
+ */
+uint32_t libvibeModel_Sequential_GetNumberOfThreads(const vibeModel_Sequential_t *model);
+
+/**
+ * Setter. Enables the skipping of the static blocks of the 8u C1R, C3R and C4R
+ * models (-1, the default, disables it). It can be called at any time.
+ *
+ * The frame is split into blocks of 16 x 16 pixels, and every row of a block
+ * into groups of 8 bytes (all the bytes of the pixels, the fourth one of the
+ * C4R images included). Before a segmentation, a block whose pixels were all
+ * background at its last segmentation is compared with the input image of
+ * that segmentation: if the sum over its groups of the absolute difference
+ * of their sums of bytes (a lower bound of the SAD of the block) is at most
+ * staticBlockThreshold, the block is skipped, i.e. its pixels are background
+ * and its samples are neither tested nor swapped. With 0, only the blocks
+ * whose sums did not change are skipped. Slow changes of a skipped block add
+ * up until it is segmented again. The update is not changed. On scenes with
+ * little activity, most of the segmentation is saved, at the cost of a pass
+ * over the input image and over the segmentation map.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param staticBlockThreshold
+ * @return
+ */
+int32_t libvibeModel_Sequential_SetStaticBlockThreshold(
+  vibeModel_Sequential_t *model,
+  const int32_t staticBlockThreshold
+);
+
+/**
+ * Getter.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return The threshold set with \ref libvibeModel_Sequential_SetStaticBlockThreshold (-1 when disabled).
+ */
+int32_t libvibeModel_Sequential_GetStaticBlockThreshold(const vibeModel_Sequential_t *model);
+
+/**
+ * Setter. Sets the seed of the random numbers of the model (0 by default) and
+ * restarts its stream. Every model owns its stream: the libc rand() is not
+ * used, and two models created with the same seed, parameters and frames give
+ * the same results. Call it before the AllocInit function to also reproduce
+ * the initial samples.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param seed
+ * @return
+ */
+int32_t libvibeModel_Sequential_SetSeed(
+  vibeModel_Sequential_t *model,
+  const uint32_t seed
+);
+
+/**
+ * Getter.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return The last seed given to \ref libvibeModel_Sequential_SetSeed.
+ */
+uint32_t libvibeModel_Sequential_GetSeed(const vibeModel_Sequential_t *model);
+
+/**
+ * Setter. Sets the allocator of the storage of the model: historyImages,
+ * historyBuffer and the other buffers sized by the frame, e.g. to place the
+ * model in an arena or in shared memory (the buffers with random values are
+ * shared by the models of the same configuration, and stay on the heap). NULL
+ * restores the default allocator, which returns blocks aligned on 64 bytes.
+ * Call it before the AllocInit function: the storage is freed by
+ * \ref libvibeModel_Sequential_Free with the same allocator.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param allocator
+ * @return
+ */
+int32_t libvibeModel_Sequential_SetAllocator(
+  vibeModel_Sequential_t *model,
+  const vibeAllocator_t *allocator
+);
+
+/**
+ * Setter. Requests huge pages (0 by default, 1 to request them) for the
+ * historyImages and the historyBuffer of at least 2 MB: they are then
+ * aligned on 2 MB and advised to the kernel with madvise(MADV_HUGEPAGE),
+ * which saves most of the TLB misses of the large models (e.g. a 4K C3R
+ * model with 20 samples). This is a hint: it is ignored where transparent
+ * huge pages are not available. Call it before the AllocInit function.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param hugePages
+ * @return
+ */
+int32_t libvibeModel_Sequential_SetHugePages(
+  vibeModel_Sequential_t *model,
+  const uint32_t hugePages
+);
+
+/**
+ * Getter.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return 1 when huge pages are requested, 0 otherwise.
+ */
+uint32_t libvibeModel_Sequential_GetHugePages(const vibeModel_Sequential_t *model);
+
+/**
+ * Getter. Copies the counters accumulated since the creation of the model or the
+ * last call to \ref libvibeModel_Sequential_ResetStats. The counters are
+ * only compiled in with -DVIBE_STATS: otherwise stats is zeroed and the
+ * function returns -1.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param stats
+ * @return 0 when the counters are compiled in, -1 otherwise.
+ */
+int32_t libvibeModel_Sequential_GetStats(
+  const vibeModel_Sequential_t *model,
+  vibeStats_t *stats
+);
+
+/**
+ * Setter. Zeroes the counters (see \ref libvibeModel_Sequential_GetStats).
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return
+ */
+int32_t libvibeModel_Sequential_ResetStats(vibeModel_Sequential_t *model);
+
+/**
+ * Changes the number of samples and the matching number of an allocated model
+ * between two frames, without learning the background again: the samples kept
+ * are copied to a historyBuffer of the new size (on the threads of the model),
+ * the new samples are noisy copies of the historyImages, and the positions of
+ * the update are drawn among the new samples. The number of historyImages does
+ * not change, and bounds the number of samples and the matching number from
+ * below (a pixel matching every historyImage must not count more matches than
+ * the matching number). When the samples
+ * are stored sample-major (see \ref libvibeModel_Sequential_SetBufferLayout),
+ * dropping samples neither copies nor allocates anything.
+ *
+ * Only the 8u C1R and C3R models with a set of samples per pixel, of 3 bytes
+ * each, change their number of samples; the matching number changes for all
+ * the models.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param numberOfSamples
+ * @param matchingNumber At least the number of historyImages, at most numberOfSamples.
+ * @return 0, or -1 if the model or the parameters do not allow the change.
+ */
+int32_t libvibeModel_Sequential_Resize(
+  vibeModel_Sequential_t *model,
+  const uint32_t numberOfSamples,
+  const uint32_t matchingNumber
+);
+
+/**
+ * \brief Frees all the memory used by the <tt>model</tt> and deallocates the structure.
+ *
+ * This function frees all the memory allocated by \ref libvibeModel_SequentialNew and
+ * \ref libvibeModel_Sequential_AllocInit_8u_C1R or \ref libvibeModel_Sequential_AllocInit_8u_C3R.
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return
+ */
+int32_t libvibeModel_Sequential_Free(vibeModel_Sequential_t *model);
+
+/**
+ * Saves an allocated model (parameters, samples, buffers with random values
+ * and state of the random stream) to a snapshot file, e.g. before a restart.
+ * The file is versioned, and is only meant to be loaded on a machine with the
+ * same byte order.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param filename
+ * @return 0, or -1 if the file could not be written.
+ */
+int32_t libvibeModel_Sequential_Save(const vibeModel_Sequential_t *model, const char *filename);
+
+/**
+ * Getter.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return The width of the images of an allocated (or loaded) model, 0 before.
+ */
+uint32_t libvibeModel_Sequential_GetWidth(const vibeModel_Sequential_t *model);
+
+/**
+ * Getter.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return The height of the images of an allocated (or loaded) model, 0 before.
+ */
+uint32_t libvibeModel_Sequential_GetHeight(const vibeModel_Sequential_t *model);
+
+/**
+ * Getter.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @return The number of channels (1, 3 or 4) of the 8-bit interleaved images of an
+ *         allocated (or loaded) model, 0 before and for the models of 16-bit or 4:2:0 images.
+ */
+uint32_t libvibeModel_Sequential_GetInputChannels(const vibeModel_Sequential_t *model);
+
+/**
+ * Loads a model saved by \ref libvibeModel_Sequential_Save, in place of the
+ * AllocInit function: the model carries on exactly as the saved one would
+ * have done, without learning the background again. It must then be used
+ * with the functions of the saved model (same type and number of channels).
+ *
+ * The model must come from \ref libvibeModel_Sequential_New; its parameters
+ * are replaced by those of the file, but not its number of threads nor its
+ * image step (see \ref libvibeModel_Sequential_SetImageStep), which describe
+ * the caller and its input images. Every parameter of the file is checked
+ * against the rules of the setters and of the AllocInit functions, the strides
+ * against those of the AllocInit function, and the buffers with random values
+ * against the values they are drawn from, before anything is used. The file
+ * is mapped in memory and used in place (its pages are read on demand, and
+ * copied when first written, the file itself being left unchanged), so that
+ * loading even a large model only takes a few milliseconds.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param filename
+ * @return 0, or -1 if the file could not be read or is not a valid snapshot (the model is then left unchanged).
+ */
+int32_t libvibeModel_Sequential_Load(vibeModel_Sequential_t *model, const char *filename);
+
+/**
+ * The two following functions allocate the required memory according to the
+ * model parameters and the dimensions of the input images.
+ * You must use the "C1R" function for grayscale images and the "C3R" for color
+ * images. 
+ * These 2 functions also initialize the background model using the content
+ * of *image_data which is the pixel buffer of the first image of your stream.
+ */
+// -------------------------  Single channel images ----------------------------
+/**
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param width
+ * @param height
+ * @return
+ */
+int32_t libvibeModel_Sequential_AllocInit_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+);
+
+/* These 2 functions perform 2 operations:
+ *   - they classify the pixels *image_data using the provided model and store
+ *     the results in *segmentation_map.
+ *   - they update *model according to these results and the content of
+ *     *image_data.
+ * You must use the "C1R" function for grayscale images and the "C3R" for color
+ * images.
+ */
+/**
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_map
+ * @return
+ */
+int32_t libvibeModel_Sequential_Segmentation_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+);
+
+/**
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param updating_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Update_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *updating_mask
+);
+
+/**
+ * Segmentation and update in a single pass: the results (segmentation_map and
+ * model) are exactly those of \ref libvibeModel_Sequential_Segmentation_8u_C1R
+ * followed by \ref libvibeModel_Sequential_Update_8u_C1R with segmentation_map
+ * as the updating mask. The frame is processed by strips of rows sized for the
+ * L2 cache (-DVIBE_L2_CACHE_SIZE, 1 MB by default), and every strip is updated
+ * while its samples are still in cache. Use the two separate calls when the
+ * updating mask is not the segmentation map (e.g. post-processed).
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_map
+ * @return
+ */
+int32_t libvibeModel_Sequential_Process_8u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Segmentation_8u_C1R, but the result is
+ * written as a mask of bits: pixel index (= x + y * width) belongs to the
+ * foreground if bit (index & 7) of segmentation_mask[index / 8] is set. The
+ * mask holds (width * height + 7) / 8 bytes, with no padding between the rows,
+ * and the unused bits of its last byte are cleared. Such masks can be combined
+ * with bitwise operations, and their foreground pixels counted with popcount.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Segmentation_8u1u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_mask
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Update_8u_C1R, with a mask of bits (see
+ * \ref libvibeModel_Sequential_Segmentation_8u1u_C1R) as updating mask.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param updating_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Update_8u1u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask
+);
+
+// -------------------------  Three channel images -----------------------------
+/**
+ * The pixel values of color images are arranged in the following order
+ * RGBRGBRGB... (or HSVHSVHSVHSVHSVHSV...)
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param width
+ * @param height
+ * @return
+ */
+int32_t libvibeModel_Sequential_AllocInit_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+);
+
+/* These 2 functions perform 2 operations:
+ *   - they classify the pixels *image_data using the provided model and store
+ *     the results in *segmentation_map.
+ *   - they update *model according to these results and the content of
+ *     *image_data.
+ * You must use the "C1R" function for grayscale images and the "C3R" for color
+ * images.
+ */
+/**
+ * The pixel values of color images are arranged in the following order
+ * RGBRGBRGB... (or HSVHSVHSVHSVHSVHSV...)
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_map
+ * @return
+ */
+int32_t libvibeModel_Sequential_Segmentation_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+);
+
+/**
+ * The pixel values of color images are arranged in the following order
+ * RGBRGBRGB... (or HSVHSVHSVHSVHSVHSV...)
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param updating_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Update_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *updating_mask
+);
+
+/**
+ * C3R counterpart of \ref libvibeModel_Sequential_Process_8u_C1R: same results
+ * as \ref libvibeModel_Sequential_Segmentation_8u_C3R followed by
+ * \ref libvibeModel_Sequential_Update_8u_C3R, in a single cache-friendly pass.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_map
+ * @return
+ */
+int32_t libvibeModel_Sequential_Process_8u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+);
+
+/**
+ * C3R counterpart of \ref libvibeModel_Sequential_Segmentation_8u1u_C1R: the
+ * segmentation is written as a mask of bits.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Segmentation_8u1u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_mask
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Update_8u_C3R, with a mask of bits (see
+ * \ref libvibeModel_Sequential_Segmentation_8u1u_C1R) as updating mask.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param updating_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Update_8u1u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask
+);
+
+// -------------------------  Four channel images ------------------------------
+/**
+ * Same as \ref libvibeModel_Sequential_AllocInit_8u_C3R for images whose
+ * pixels have a fourth byte, which is ignored: RGBXRGBX... (RGBA, or BGRA
+ * with a BGR model). The model is a C3R model, but it must be used with the
+ * C4R functions below, which read the same RGBX images without repacking them.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param width
+ * @param height
+ * @return
+ */
+int32_t libvibeModel_Sequential_AllocInit_8u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Segmentation_8u_C3R, for a model
+ * initialized by \ref libvibeModel_Sequential_AllocInit_8u_C4R.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_map
+ * @return
+ */
+int32_t libvibeModel_Sequential_Segmentation_8u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Update_8u_C3R, for a model initialized
+ * by \ref libvibeModel_Sequential_AllocInit_8u_C4R.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param updating_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Update_8u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *updating_mask
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Process_8u_C3R, for a model initialized
+ * by \ref libvibeModel_Sequential_AllocInit_8u_C4R.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_map
+ * @return
+ */
+int32_t libvibeModel_Sequential_Process_8u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Segmentation_8u1u_C3R, for a model
+ * initialized by \ref libvibeModel_Sequential_AllocInit_8u_C4R.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Segmentation_8u1u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_mask
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Update_8u1u_C3R, for a model
+ * initialized by \ref libvibeModel_Sequential_AllocInit_8u_C4R.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param updating_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Update_8u1u_C4R(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint8_t *updating_mask
+);
+
+// -------------------------  16-bit images -----------------------------------
+/**
+ * 16u counterparts of the functions above, for images with 16-bit samples
+ * (e.g. 12 to 16-bit thermal or HDR cameras): the historyImages and the
+ * historyBuffer store 16-bit samples, so that the full dynamic range is kept.
+ * The matching threshold is in the units of the samples, and the noise added
+ * to the initial samples spans [-matchingThreshold / 2, matchingThreshold / 2)
+ * (as the [-10, 10) noise of the 8u models for the default threshold of 20).
+ * The segmentation map and the updating mask still hold one byte per pixel.
+ *
+ * A model initialized by a 16u function must only be used with the 16u
+ * functions with the same number of channels. The 16u C3R models always use
+ * the interleaved layout (\ref VIBE_LAYOUT_INTERLEAVED); both buffer layouts
+ * are supported.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param width
+ * @param height
+ * @return
+ */
+int32_t libvibeModel_Sequential_AllocInit_16u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Segmentation_8u_C1R, for a model
+ * initialized by \ref libvibeModel_Sequential_AllocInit_16u_C1R.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_map
+ * @return
+ */
+int32_t libvibeModel_Sequential_Segmentation_16u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  uint8_t *segmentation_map
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Update_8u_C1R, for a model initialized
+ * by \ref libvibeModel_Sequential_AllocInit_16u_C1R.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param updating_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Update_16u_C1R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  uint8_t *updating_mask
+);
+
+/**
+ * The pixel values of color images are arranged in the following order
+ * RGBRGBRGB..., with 16-bit samples (see \ref libvibeModel_Sequential_AllocInit_16u_C1R).
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param width
+ * @param height
+ * @return
+ */
+int32_t libvibeModel_Sequential_AllocInit_16u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Segmentation_8u_C3R, for a model
+ * initialized by \ref libvibeModel_Sequential_AllocInit_16u_C3R.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_map
+ * @return
+ */
+int32_t libvibeModel_Sequential_Segmentation_16u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  uint8_t *segmentation_map
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Update_8u_C3R, for a model initialized
+ * by \ref libvibeModel_Sequential_AllocInit_16u_C3R.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param updating_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Update_16u_C3R(
+  vibeModel_Sequential_t *model,
+  const uint16_t *image_data,
+  uint8_t *updating_mask
+);
+
+// -------------------------  YUV 4:2:0 images --------------------------------
+/**
+ * YUV 4:2:0 counterparts of the C3R functions, for the planar I420 images of
+ * video decoders (a width x height luma plane, then the U and V planes of
+ * (width / 2) x (height / 2) bytes). The model keeps a luma sample per pixel
+ * and a chroma sample (U and V) per 2x2 block of pixels, that is half the
+ * memory of a C3R model, and the input images are read in place, without any
+ * color conversion. A pixel matches a sample when
+ * |Y - Y'| + |U - U'| + |V - V'| is at most the bound of the C3R models (about
+ * 4.5 * matchingThreshold).
+ *
+ * The width and the height must be even. With \ref libvibeModel_Sequential_SetImageStep,
+ * the step is the one of the luma rows; the U and V rows then have step / 2
+ * bytes, and follow the height luma rows. Both buffer layouts are supported;
+ * the layout set with \ref libvibeModel_Sequential_SetLayout is ignored.
+ *
+ * A model initialized by this function must only be used with the I420
+ * functions below.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param width
+ * @param height
+ * @return
+ */
+int32_t libvibeModel_Sequential_AllocInit_8u_I420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Segmentation_8u_C3R, for a model
+ * initialized by \ref libvibeModel_Sequential_AllocInit_8u_I420.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_map
+ * @return
+ */
+int32_t libvibeModel_Sequential_Segmentation_8u_I420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Update_8u_C3R, for a model initialized
+ * by \ref libvibeModel_Sequential_AllocInit_8u_I420.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param updating_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Update_8u_I420(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *updating_mask
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_AllocInit_8u_I420 for NV12 images: the
+ * luma plane is followed by a single plane of (height / 2) rows of interleaved
+ * UV pairs (UVUV..., with the step of the luma rows).
+ *
+ * A model initialized by this function must only be used with the NV12
+ * functions below.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param width
+ * @param height
+ * @return
+ */
+int32_t libvibeModel_Sequential_AllocInit_8u_NV12(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  const uint32_t width,
+  const uint32_t height
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Segmentation_8u_C3R, for a model
+ * initialized by \ref libvibeModel_Sequential_AllocInit_8u_NV12.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param segmentation_map
+ * @return
+ */
+int32_t libvibeModel_Sequential_Segmentation_8u_NV12(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *segmentation_map
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_Update_8u_C3R, for a model initialized
+ * by \ref libvibeModel_Sequential_AllocInit_8u_NV12.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param image_data
+ * @param updating_mask
+ * @return
+ */
+int32_t libvibeModel_Sequential_Update_8u_NV12(
+  vibeModel_Sequential_t *model,
+  const uint8_t *image_data,
+  uint8_t *updating_mask
+);
+
+// -------------------------  Region of interest -----------------------------
+/**
+ * Setter. Restricts the segmentation and the update of an allocated model to
+ * a region of interest, e.g. a doorway or a lane. The segmentation only
+ * classifies the pixels of the region, and the other pixels of the
+ * segmentation maps get a fixed label (see
+ * \ref libvibeModel_Sequential_SetROILabel); the update only updates the
+ * pixels of the region (and, by neighbor diffusion, the pixels next to it),
+ * whatever the updating mask. The samples of the pixels outside are neither
+ * read nor written, so that the work of a frame is about that of the region.
+ *
+ * The region is compiled into spans of pixels, row by row. It can be changed
+ * at any time; the pixels that enter the region keep the samples they had
+ * when they left it (or since the initialization). With the whole frame as
+ * region, the results are those of a model without region. For the YUV
+ * 4:2:0 models, the region is made of the whole 2x2 blocks with a pixel in
+ * it. The region is not saved by \ref libvibeModel_Sequential_Save.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param roi_mask width * height bytes, non-zero for the pixels of the region (NULL for the whole frame).
+ * @return
+ */
+int32_t libvibeModel_Sequential_SetROI(vibeModel_Sequential_t *model, const uint8_t *roi_mask);
+
+/**
+ * Same as \ref libvibeModel_Sequential_SetROI, for the region made of the
+ * pixels of the rectangles (clipped to the frame).
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param rectangles
+ * @param numberOfRectangles
+ * @return
+ */
+int32_t libvibeModel_Sequential_SetROIRectangles(
+  vibeModel_Sequential_t *model,
+  const vibeRectangle_t *rectangles,
+  const uint32_t numberOfRectangles
+);
+
+/**
+ * Same as \ref libvibeModel_Sequential_SetROI, for the region made of the
+ * pixels of the polygons. The vertices of polygon p are the numberOfPoints[p]
+ * points that follow those of polygon p - 1, in pixel coordinates (pixel
+ * (x, y) covers [x, x + 1) x [y, y + 1)); a pixel is in a polygon when its
+ * center is (even-odd rule), so that the polygon (0, 0), (w, 0), (w, h),
+ * (0, h) is the rectangle of w x h pixels at (0, 0).
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param points
+ * @param numberOfPoints
+ * @param numberOfPolygons
+ * @return
+ */
+int32_t libvibeModel_Sequential_SetROIPolygons(
+  vibeModel_Sequential_t *model,
+  const vibePoint_t *points,
+  const uint32_t *numberOfPoints,
+  const uint32_t numberOfPolygons
+);
+
+/**
+ * Setter. Sets the label of the pixels outside the region of interest in
+ * the segmentation maps (COLOR_BACKGROUND by default; in the packed masks,
+ * any other label is a foreground bit).
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param label
+ * @return
+ */
+int32_t libvibeModel_Sequential_SetROILabel(vibeModel_Sequential_t *model, const uint8_t label);
+
+// -------------------------  Batches of models ------------------------------
+/**
+ * Creates a batch: a pool of numberOfThreads threads (the calling thread
+ * included) that processes several models at once, e.g. one model per camera
+ * in a single process.
+ *
+ * @param numberOfThreads
+ * @return A pointer to the batch, to be freed with \ref libvibeModel_Sequential_FreeBatch.
+ */
+vibeBatch_t *libvibeModel_Sequential_NewBatch(const uint32_t numberOfThreads);
+
+/**
+ * Same as calling \ref libvibeModel_Sequential_Process_8u_C1R (or the C3R or
+ * C4R function, depending on how the model was initialized) on
+ * (models[i], images[i], segmentation_maps[i]) for every i, with the threads
+ * of the batch. The models may have different sizes and types (8u C1R, C3R
+ * or C4R), but a model must not appear twice.
+ *
+ * The rows of every model are split into the bands set with
+ * \ref libvibeModel_Sequential_SetNumberOfThreads (a single band by default)
+ * and the bands of all the models are shared out among the threads: set more
+ * bands than one for the models of a batch with fewer models than threads.
+ * The threads of the models are not used (nor even started), and the
+ * results are those of the Process functions.
+ *
+ * @param batch
+ * @param models
+ * @param images
+ * @param segmentation_maps
+ * @param numberOfModels
+ * @return
+ */
+int32_t libvibeModel_Sequential_ProcessBatch(
+  vibeBatch_t *batch,
+  vibeModel_Sequential_t **models,
+  const uint8_t **images,
+  uint8_t **segmentation_maps,
+  const uint32_t numberOfModels
+);
+
+/**
+ * Stops the threads and frees the batch (the models are not freed).
+ *
+ * @param batch
+ * @return
+ */
+int32_t libvibeModel_Sequential_FreeBatch(vibeBatch_t *batch);
+
+// -------------------------  Batches of frames ------------------------------
+/**
+ * Same as calling \ref libvibeModel_Sequential_Process_8u_C1R (or the C3R or
+ * C4R function, depending on how the model was initialized) on
+ * (model, images[t], segmentation_maps[t]) for t = 0, 1, ..., numberOfFrames - 1,
+ * for jobs that have all the frames at hand (e.g. a sequence read from files).
+ *
+ * The frames are processed strip of rows by strip of rows, every frame two rows
+ * behind the previous one, so that the model stays in cache from a frame to
+ * the next instead of going through the memory at every frame. The results
+ * (masks, model and random stream) are those of the Process functions. A model
+ * with several threads (see \ref libvibeModel_Sequential_SetNumberOfThreads),
+ * static blocks or samples shared by blocks of pixels (see
+ * \ref libvibeModel_Sequential_SetSampleBlockSize) processes the frames one
+ * after the other.
+ *
+ * @param model The data structure with ViBe's background subtraction model and parameters.
+ * @param images
+ * @param segmentation_maps
+ * @param numberOfFrames
+ * @return
+ */
+int32_t libvibeModel_Sequential_ProcessFrames(
+  vibeModel_Sequential_t *model,
+  const uint8_t **images,
+  uint8_t **segmentation_maps,
+  const uint32_t numberOfFrames
 );
 
 #ifdef __cplusplus
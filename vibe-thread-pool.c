@@ -0,0 +1,156 @@
+/**
+    @file vibe-thread-pool.c
+    @brief Implementation of vibe-thread-pool.h (POSIX threads)
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "vibe-thread-pool.h"
+
+struct vibeThreadPool
+{
+  uint32_t numberOfThreads;
+  pthread_t *workers;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t started;
+  pthread_cond_t finished;
+
+  /* Current job, protected by the mutex. */
+  uint32_t generation;
+  int quit;
+  vibeTask_fn task;
+  void *context;
+  uint32_t numberOfTasks;
+  uint32_t nextTask;
+  uint32_t pendingTasks;
+};
+
+// -----------------------------------------------------------------------------
+// Runs the tasks of the current job that are not taken yet. Called with the
+// mutex locked, returns with the mutex locked.
+// -----------------------------------------------------------------------------
+static void runTasks(vibeThreadPool_t *pool)
+{
+  while (pool->nextTask < pool->numberOfTasks) {
+    uint32_t task = pool->nextTask++;
+
+    pthread_mutex_unlock(&pool->mutex);
+    pool->task(pool->context, task);
+    pthread_mutex_lock(&pool->mutex);
+
+    if (--pool->pendingTasks == 0)
+      pthread_cond_broadcast(&pool->finished);
+  }
+}
+
+// -----------------------------------------------------------------------------
+static void *worker(void *arg)
+{
+  vibeThreadPool_t *pool = (vibeThreadPool_t *)arg;
+  uint32_t generation = 0;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  for (;;) {
+    while (!pool->quit && (pool->generation == generation))
+      pthread_cond_wait(&pool->started, &pool->mutex);
+
+    if (pool->quit)
+      break;
+
+    generation = pool->generation;
+    runTasks(pool);
+  }
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  return(NULL);
+}
+
+// -----------------------------------------------------------------------------
+vibeThreadPool_t *libvibeThreadPool_New(uint32_t numberOfThreads)
+{
+  assert(numberOfThreads > 0);
+
+  vibeThreadPool_t *pool = (vibeThreadPool_t *)calloc(1, sizeof(*pool));
+  assert(pool != NULL);
+
+  pool->numberOfThreads = numberOfThreads;
+  pool->workers = (pthread_t *)malloc(numberOfThreads * sizeof(*(pool->workers)));
+  assert(pool->workers != NULL);
+
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->started, NULL);
+  pthread_cond_init(&pool->finished, NULL);
+
+  /* The calling thread is the first thread of the pool. */
+  for (uint32_t i = 1; i < numberOfThreads; ++i) {
+    int error = pthread_create(&pool->workers[i], NULL, worker, pool);
+    assert(error == 0);
+    (void)error;
+  }
+
+  return(pool);
+}
+
+// -----------------------------------------------------------------------------
+uint32_t libvibeThreadPool_GetNumberOfThreads(const vibeThreadPool_t *pool)
+{
+  assert(pool != NULL); return(pool->numberOfThreads);
+}
+
+// -----------------------------------------------------------------------------
+void libvibeThreadPool_Run(vibeThreadPool_t *pool, vibeTask_fn task, void *context, uint32_t numberOfTasks)
+{
+  assert((pool != NULL) && (task != NULL));
+
+  if ((pool->numberOfThreads == 1) || (numberOfTasks <= 1)) {
+    for (uint32_t i = 0; i < numberOfTasks; ++i)
+      task(context, i);
+
+    return;
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+
+  pool->task = task;
+  pool->context = context;
+  pool->numberOfTasks = numberOfTasks;
+  pool->nextTask = 0;
+  pool->pendingTasks = numberOfTasks;
+  ++pool->generation;
+  pthread_cond_broadcast(&pool->started);
+
+  runTasks(pool);
+
+  while (pool->pendingTasks > 0)
+    pthread_cond_wait(&pool->finished, &pool->mutex);
+
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+// -----------------------------------------------------------------------------
+void libvibeThreadPool_Free(vibeThreadPool_t *pool)
+{
+  if (pool == NULL)
+    return;
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->quit = 1;
+  pthread_cond_broadcast(&pool->started);
+  pthread_mutex_unlock(&pool->mutex);
+
+  for (uint32_t i = 1; i < pool->numberOfThreads; ++i)
+    pthread_join(pool->workers[i], NULL);
+
+  pthread_cond_destroy(&pool->finished);
+  pthread_cond_destroy(&pool->started);
+  pthread_mutex_destroy(&pool->mutex);
+  free(pool->workers);
+  free(pool);
+}
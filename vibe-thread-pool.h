@@ -0,0 +1,51 @@
+/**
+    @file vibe-thread-pool.h
+    @brief Internal pool of worker threads used by vibe-background-sequential.c
+
+    @details
+
+  This header is private to the ViBe library. A pool runs a set of independent
+  tasks (e.g. the row bands of a frame) on its threads and on the calling
+  thread, and returns once all of them are done. The tasks are handed out in
+  any order, so the result of a task must only depend on its number.
+*/
+
+#ifndef _VIBE_THREAD_POOL_H_
+#define _VIBE_THREAD_POOL_H_
+
+#include <stdint.h>
+
+/**
+ * \typedef struct vibeThreadPool_t
+ * \brief Opaque pool of worker threads.
+ */
+typedef struct vibeThreadPool vibeThreadPool_t;
+
+/**
+ * Task run by the pool: task goes from 0 to numberOfTasks - 1.
+ */
+typedef void (*vibeTask_fn)(void *context, uint32_t task);
+
+/**
+ * Creates a pool that runs the tasks on numberOfThreads threads, the calling
+ * thread included (numberOfThreads - 1 workers are started).
+ */
+vibeThreadPool_t *libvibeThreadPool_New(uint32_t numberOfThreads);
+
+/**
+ * Number of threads of the pool, the calling thread included.
+ */
+uint32_t libvibeThreadPool_GetNumberOfThreads(const vibeThreadPool_t *pool);
+
+/**
+ * Runs task(context, 0), ..., task(context, numberOfTasks - 1) and waits for
+ * all of them to finish.
+ */
+void libvibeThreadPool_Run(vibeThreadPool_t *pool, vibeTask_fn task, void *context, uint32_t numberOfTasks);
+
+/**
+ * Stops the workers and frees the pool.
+ */
+void libvibeThreadPool_Free(vibeThreadPool_t *pool);
+
+#endif